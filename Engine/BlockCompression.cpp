@@ -0,0 +1,719 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// One 4x4 block as RGBA, row by row
+	typedef uint8_t BlockPixels[16][4];
+
+	// --------------------------------------------------------
+	// Gathers a block starting at (x, y), repeating the edge
+	// for pixels past the right or bottom of the image
+	// --------------------------------------------------------
+	void LoadBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, uint32_t x, uint32_t y, BlockPixels& block)
+	{
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			uint32_t sy = std::min(y + row, height - 1);
+			for (uint32_t column = 0; column < 4; column++)
+			{
+				uint32_t sx = std::min(x + column, width - 1);
+				const uint8_t* source = pixels + ((size_t)sy * width + sx) * channels;
+				uint8_t* destination = block[row * 4 + column];
+
+				if (channels == 1)
+				{
+					destination[0] = destination[1] = destination[2] = source[0];
+					destination[3] = 255;
+				}
+				else
+				{
+					memcpy(destination, source, 4);
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// The principal axis of a set of points (their direction of
+	// greatest spread) by power iteration on the covariance,
+	// and their mean.  Returns false if they're all the same.
+	// --------------------------------------------------------
+	template<int Dimensions>
+	bool PrincipalAxis(const float (*points)[4], int count, float* mean, float* axis)
+	{
+		for (int d = 0; d < Dimensions; d++)
+		{
+			mean[d] = 0.0f;
+			for (int i = 0; i < count; i++)
+				mean[d] += points[i][d];
+			mean[d] /= count;
+		}
+
+		float covariance[Dimensions][Dimensions] = {};
+		for (int i = 0; i < count; i++)
+			for (int a = 0; a < Dimensions; a++)
+				for (int b = 0; b < Dimensions; b++)
+					covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+		// Start along the diagonal of the bounding box, which is close for most blocks
+		float trace = 0.0f;
+		for (int d = 0; d < Dimensions; d++)
+		{
+			float low = points[0][d], high = points[0][d];
+			for (int i = 1; i < count; i++)
+			{
+				low = std::min(low, points[i][d]);
+				high = std::max(high, points[i][d]);
+			}
+			axis[d] = high - low;
+			trace += covariance[d][d];
+		}
+		if (trace < 1e-6f)
+			return false;
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[Dimensions] = {};
+			for (int a = 0; a < Dimensions; a++)
+				for (int b = 0; b < Dimensions; b++)
+					next[a] += covariance[a][b] * axis[b];
+
+			float length = 0.0f;
+			for (int d = 0; d < Dimensions; d++)
+				length += next[d] * next[d];
+			if (length < 1e-12f)
+				break;
+
+			length = 1.0f / std::sqrt(length);
+			for (int d = 0; d < Dimensions; d++)
+				axis[d] = next[d] * length;
+		}
+
+		float length = 0.0f;
+		for (int d = 0; d < Dimensions; d++)
+			length += axis[d] * axis[d];
+		if (length < 1e-12f)
+			return false;
+
+		length = 1.0f / std::sqrt(length);
+		for (int d = 0; d < Dimensions; d++)
+			axis[d] *= length;
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Endpoints at either end of the points' spread along
+	// their principal axis
+	// --------------------------------------------------------
+	template<int Dimensions>
+	void FitEndpoints(const float (*points)[4], int count, float* low, float* high)
+	{
+		float mean[Dimensions];
+		float axis[Dimensions];
+		if (!PrincipalAxis<Dimensions>(points, count, mean, axis))
+		{
+			for (int d = 0; d < Dimensions; d++)
+				low[d] = high[d] = points[0][d];
+			return;
+		}
+
+		float minT = 0.0f, maxT = 0.0f;
+		for (int i = 0; i < count; i++)
+		{
+			float t = 0.0f;
+			for (int d = 0; d < Dimensions; d++)
+				t += (points[i][d] - mean[d]) * axis[d];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		for (int d = 0; d < Dimensions; d++)
+		{
+			low[d] = std::min(255.0f, std::max(0.0f, mean[d] + axis[d] * minT));
+			high[d] = std::min(255.0f, std::max(0.0f, mean[d] + axis[d] * maxT));
+		}
+	}
+
+	// --------------------------------------------------------
+	// Least squares endpoints for points whose palette indices
+	// (and so interpolation weights) are already chosen.  Each
+	// point is (1 - weight) * first + weight * second.  Returns
+	// false when every point has the same weight.
+	// --------------------------------------------------------
+	template<int Dimensions>
+	bool RefineEndpoints(const float (*points)[4], int count, const float* weights, float* first, float* second)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[Dimensions] = {};
+		float bx[Dimensions] = {};
+		for (int i = 0; i < count; i++)
+		{
+			float b = weights[i];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int d = 0; d < Dimensions; d++)
+			{
+				ax[d] += a * points[i][d];
+				bx[d] += b * points[i][d];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+
+		float inverse = 1.0f / determinant;
+		for (int d = 0; d < Dimensions; d++)
+		{
+			first[d] = std::min(255.0f, std::max(0.0f, (bb * ax[d] - ab * bx[d]) * inverse));
+			second[d] = std::min(255.0f, std::max(0.0f, (aa * bx[d] - ab * ax[d]) * inverse));
+		}
+		return true;
+	}
+
+	// Writes bits into a block, least significant first
+	struct BitWriter
+	{
+		uint8_t* bytes;
+		uint32_t position;
+
+		void Write(uint32_t value, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; i++, position++)
+				if (value & (1u << i))
+					bytes[position >> 3] |= (uint8_t)(1u << (position & 7));
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t* bytes;
+		uint32_t position;
+
+		uint32_t Read(uint32_t count)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < count; i++, position++)
+				value |= (uint32_t)((bytes[position >> 3] >> (position & 7)) & 1) << i;
+			return value;
+		}
+	};
+
+	// ---------------------------------------------------------------
+	// BC1
+	// ---------------------------------------------------------------
+
+	uint16_t Pack565(const float* color)
+	{
+		uint32_t r = (uint32_t)std::lround(color[0] * 31.0f / 255.0f);
+		uint32_t g = (uint32_t)std::lround(color[1] * 63.0f / 255.0f);
+		uint32_t b = (uint32_t)std::lround(color[2] * 31.0f / 255.0f);
+		return (uint16_t)(r << 11 | g << 5 | b);
+	}
+
+	void Unpack565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	// The four colors a BC1 block in four color mode can use
+	void BC1Palette(uint16_t first, uint16_t second, int palette[4][3])
+	{
+		Unpack565(first, palette[0]);
+		Unpack565(second, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+	}
+
+	// Picks the nearest palette color for each pixel, returning the total squared error
+	int AssignBC1Indices(const float (*points)[4], const int palette[4][3], uint32_t& indices)
+	{
+		int total = 0;
+		indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestError = 1 << 30;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int difference = (int)points[i][c] - palette[p][c];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+			total += bestError;
+		}
+		return total;
+	}
+
+	// --------------------------------------------------------
+	// Color endpoints from the principal axis, then a couple of
+	// rounds of least squares once the indices are known.  The
+	// block always uses four color mode (first endpoint larger),
+	// which is also the only mode BC3's color block has.
+	// --------------------------------------------------------
+	void CompressBC1Block(const BlockPixels& block, uint8_t* out)
+	{
+		float points[16][4];
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 4; c++)
+				points[i][c] = block[i][c];
+
+		float low[3], high[3];
+		FitEndpoints<3>(points, 16, low, high);
+
+		// Palette index -> weight of the second endpoint
+		static const float Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		uint16_t bestFirst = 0, bestSecond = 0;
+		uint32_t bestIndices = 0;
+		int bestError = 1 << 30;
+		for (int round = 0; round < 3; round++)
+		{
+			uint16_t first = Pack565(high);
+			uint16_t second = Pack565(low);
+			if (first < second)
+				std::swap(first, second);
+
+			int palette[4][3];
+			BC1Palette(first, second, palette);
+
+			uint32_t indices = 0;
+			int error = first == second ? 0 : AssignBC1Indices(points, palette, indices);
+			if (first == second)
+			{
+				// Equal endpoints would switch to three color mode, so index 0 everywhere
+				for (int i = 0; i < 16; i++)
+					for (int c = 0; c < 3; c++)
+						error += (int)((points[i][c] - palette[0][c]) * (points[i][c] - palette[0][c]));
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				bestFirst = first;
+				bestSecond = second;
+				bestIndices = indices;
+			}
+			if (error == 0 || first == second)
+				break;
+
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = Weights[(indices >> (i * 2)) & 3];
+			if (!RefineEndpoints<3>(points, 16, weights, high, low))
+				break;
+		}
+
+		memcpy(out, &bestFirst, 2);
+		memcpy(out + 2, &bestSecond, 2);
+		memcpy(out + 4, &bestIndices, 4);
+	}
+
+	void DecompressBC1Block(const uint8_t* in, BlockPixels& block)
+	{
+		uint16_t first, second;
+		uint32_t indices;
+		memcpy(&first, in, 2);
+		memcpy(&second, in + 2, 2);
+		memcpy(&indices, in + 4, 4);
+
+		int palette[4][4];
+		Unpack565(first, palette[0]);
+		Unpack565(second, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		for (int c = 0; c < 3; c++)
+		{
+			if (first > second)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				// Three color mode: a midpoint and transparent black
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[3][3] = first > second ? 255 : 0;
+
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 4; c++)
+				block[i][c] = (uint8_t)palette[(indices >> (i * 2)) & 3][c];
+	}
+
+	// ---------------------------------------------------------------
+	// BC4 (also BC3's alpha and both halves of BC5)
+	// ---------------------------------------------------------------
+
+	// The eight values a BC4 block can use
+	void BC4Palette(int first, int second, int palette[8])
+	{
+		palette[0] = first;
+		palette[1] = second;
+		if (first > second)
+		{
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * first + (i - 1) * second + 3) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+				palette[i] = ((6 - i) * first + (i - 1) * second + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// --------------------------------------------------------
+	// One channel of a block (the given byte of each pixel),
+	// with the block's extremes as endpoints and the eight
+	// value mode between them
+	// --------------------------------------------------------
+	void CompressBC4Block(const BlockPixels& block, int channel, uint8_t* out)
+	{
+		int low = 255, high = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			low = std::min(low, (int)block[i][channel]);
+			high = std::max(high, (int)block[i][channel]);
+		}
+
+		int palette[8];
+		BC4Palette(high, low, palette);
+
+		memset(out, 0, 8);
+		out[0] = (uint8_t)high;
+		out[1] = (uint8_t)low;
+		BitWriter writer = { out, 16 };
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestError = 256;
+			for (int p = 0; p < 8 && high != low; p++)
+			{
+				int error = std::abs((int)block[i][channel] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			writer.Write(best, 3);
+		}
+	}
+
+	void DecompressBC4Block(const uint8_t* in, int channel, BlockPixels& block)
+	{
+		int palette[8];
+		BC4Palette(in[0], in[1], palette);
+
+		BitReader reader = { in, 16 };
+		for (int i = 0; i < 16; i++)
+			block[i][channel] = (uint8_t)palette[reader.Read(3)];
+	}
+
+	// ---------------------------------------------------------------
+	// BC7 (mode 6 only: one subset, RGBA endpoints of 7 bits plus
+	// a shared low bit each, and 16 weights)
+	// ---------------------------------------------------------------
+
+	const int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// --------------------------------------------------------
+	// Quantizes an endpoint to 7 bits per channel plus its low
+	// bit, trying both low bits since one is shared by all four
+	// channels
+	// --------------------------------------------------------
+	void QuantizeBC7Endpoint(const float* endpoint, int* quantized, int& lowBit)
+	{
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; p++)
+		{
+			int q[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				q[c] = std::min(127, std::max(0, (int)std::lround((endpoint[c] - p) * 0.5f)));
+				float difference = (q[c] * 2 + p) - endpoint[c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				lowBit = p;
+				memcpy(quantized, q, sizeof(q));
+			}
+		}
+	}
+
+	void BC7Palette(const int* first, int firstLowBit, const int* second, int secondLowBit, int palette[16][4])
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int e0 = first[c] << 1 | firstLowBit;
+			int e1 = second[c] << 1 | secondLowBit;
+			for (int i = 0; i < 16; i++)
+				palette[i][c] = ((64 - BC7Weights[i]) * e0 + BC7Weights[i] * e1 + 32) >> 6;
+		}
+	}
+
+	int AssignBC7Indices(const float (*points)[4], const int palette[16][4], uint8_t* indices)
+	{
+		int total = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestError = 1 << 30;
+			for (int p = 0; p < 16; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					int difference = (int)points[i][c] - palette[p][c];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+			indices[i] = (uint8_t)best;
+			total += bestError;
+		}
+		return total;
+	}
+
+	// --------------------------------------------------------
+	// Fits RGBA endpoints along the block's principal axis and
+	// refines them with least squares, keeping whichever round
+	// quantizes best.  The first pixel's index must have a 0
+	// top bit (it's stored in 3 bits), so the endpoints swap
+	// when it doesn't.
+	// --------------------------------------------------------
+	void CompressBC7Block(const BlockPixels& block, uint8_t* out)
+	{
+		float points[16][4];
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 4; c++)
+				points[i][c] = block[i][c];
+
+		float first[4], second[4];
+		FitEndpoints<4>(points, 16, first, second);
+
+		int bestFirst[4] = {}, bestSecond[4] = {};
+		int bestFirstLowBit = 0, bestSecondLowBit = 0;
+		uint8_t bestIndices[16] = {};
+		int bestError = 1 << 30;
+		for (int round = 0; round < 3; round++)
+		{
+			int q0[4], q1[4], p0, p1;
+			QuantizeBC7Endpoint(first, q0, p0);
+			QuantizeBC7Endpoint(second, q1, p1);
+
+			int palette[16][4];
+			BC7Palette(q0, p0, q1, p1, palette);
+
+			uint8_t indices[16];
+			int error = AssignBC7Indices(points, palette, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestFirst, q0, sizeof(q0));
+				memcpy(bestSecond, q1, sizeof(q1));
+				bestFirstLowBit = p0;
+				bestSecondLowBit = p1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0)
+				break;
+
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = BC7Weights[indices[i]] / 64.0f;
+			if (!RefineEndpoints<4>(points, 16, weights, first, second))
+				break;
+		}
+
+		if (bestIndices[0] & 8)
+		{
+			for (int c = 0; c < 4; c++)
+				std::swap(bestFirst[c], bestSecond[c]);
+			std::swap(bestFirstLowBit, bestSecondLowBit);
+			for (int i = 0; i < 16; i++)
+				bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.Write(1 << 6, 7);	// Mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(bestFirst[c], 7);
+			writer.Write(bestSecond[c], 7);
+		}
+		writer.Write(bestFirstLowBit, 1);
+		writer.Write(bestSecondLowBit, 1);
+		writer.Write(bestIndices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writer.Write(bestIndices[i], 4);
+	}
+
+	bool DecompressBC7Block(const uint8_t* in, BlockPixels& block)
+	{
+		BitReader reader = { in, 0 };
+		if (reader.Read(7) != 1 << 6)
+			return false;
+
+		int first[4], second[4];
+		for (int c = 0; c < 4; c++)
+		{
+			first[c] = reader.Read(7);
+			second[c] = reader.Read(7);
+		}
+		int firstLowBit = reader.Read(1);
+		int secondLowBit = reader.Read(1);
+
+		int palette[16][4];
+		BC7Palette(first, firstLowBit, second, secondLowBit, palette);
+
+		for (int i = 0; i < 16; i++)
+		{
+			uint32_t index = reader.Read(i == 0 ? 3 : 4);
+			for (int c = 0; c < 4; c++)
+				block[i][c] = (uint8_t)palette[index][c];
+		}
+		return true;
+	}
+}
+
+uint32_t GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat_BC1 || format == BlockFormat_BC4 ? 8 : 16;
+}
+
+size_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+// --------------------------------------------------------
+// Compresses an image block by block, rows of blocks top to
+// bottom.
+//
+// pixels - The image, rows packed tightly
+// width, height - Its size (any size; edges are padded)
+// channels - 1 (gray) or 4 (RGBA)
+// format - What to compress to
+// blocks - Room for GetCompressedSize() bytes
+// --------------------------------------------------------
+void CompressBlocks(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, BlockFormat format, uint8_t* blocks)
+{
+	uint32_t blockBytes = GetBlockBytes(format);
+	for (uint32_t y = 0; y < height; y += 4)
+	{
+		for (uint32_t x = 0; x < width; x += 4, blocks += blockBytes)
+		{
+			BlockPixels block;
+			LoadBlock(pixels, width, height, channels, x, y, block);
+
+			switch (format)
+			{
+			case BlockFormat_BC1:
+				CompressBC1Block(block, blocks);
+				break;
+
+			case BlockFormat_BC3:
+				CompressBC4Block(block, 3, blocks);
+				CompressBC1Block(block, blocks + 8);
+				break;
+
+			case BlockFormat_BC4:
+				CompressBC4Block(block, 0, blocks);
+				break;
+
+			case BlockFormat_BC5:
+				CompressBC4Block(block, 0, blocks);
+				CompressBC4Block(block, 1, blocks + 8);
+				break;
+
+			case BlockFormat_BC7:
+				CompressBC7Block(block, blocks);
+				break;
+			}
+		}
+	}
+}
+
+bool DecompressBlocks(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t* rgba)
+{
+	bool supported = true;
+	uint32_t blockBytes = GetBlockBytes(format);
+	for (uint32_t y = 0; y < height; y += 4)
+	{
+		for (uint32_t x = 0; x < width; x += 4, blocks += blockBytes)
+		{
+			BlockPixels block;
+			for (int i = 0; i < 16; i++)
+			{
+				block[i][0] = block[i][1] = block[i][2] = 0;
+				block[i][3] = 255;
+			}
+
+			switch (format)
+			{
+			case BlockFormat_BC1:
+				DecompressBC1Block(blocks, block);
+				break;
+
+			case BlockFormat_BC3:
+				DecompressBC1Block(blocks + 8, block);
+				DecompressBC4Block(blocks, 3, block);
+				break;
+
+			case BlockFormat_BC4:
+				DecompressBC4Block(blocks, 0, block);
+				break;
+
+			case BlockFormat_BC5:
+				DecompressBC4Block(blocks, 0, block);
+				DecompressBC4Block(blocks + 8, 1, block);
+				break;
+
+			case BlockFormat_BC7:
+				supported = DecompressBC7Block(blocks, block) && supported;
+				break;
+			}
+
+			// Only the part of the block inside the image
+			for (uint32_t row = 0; row < 4 && y + row < height; row++)
+				for (uint32_t column = 0; column < 4 && x + column < width; column++)
+					memcpy(rgba + ((size_t)(y + row) * width + x + column) * 4, block[row * 4 + column], 4);
+		}
+	}
+	return supported;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// CPU encoders (and decoders, for measuring them) for the
+// block compressed formats textures are cooked to.  Every
+// format stores 4x4 pixel blocks; partial blocks at the
+// right and bottom edges repeat the last row or column.
+// --------------------------------------------------------
+
+enum BlockFormat
+{
+	BlockFormat_BC1,	// RGB, 4 bits per pixel
+	BlockFormat_BC3,	// RGBA, 8 bits per pixel (BC1 color plus a BC4 alpha)
+	BlockFormat_BC4,	// One channel, 4 bits per pixel
+	BlockFormat_BC5,	// Two channels (like a normal's x and y), 8 bits per pixel
+	BlockFormat_BC7,	// RGBA, 8 bits per pixel, best quality
+};
+
+// Bytes in one 4x4 block
+uint32_t GetBlockBytes(BlockFormat format);
+
+// Bytes for a whole image (of any size) in blocks
+size_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// Compresses an image with 1 channel (as gray) or 4 (RGBA).  BC4
+// keeps just red and BC5 red and green, like sampling them does.
+void CompressBlocks(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, BlockFormat format, uint8_t* blocks);
+
+// Decompresses to RGBA the way the GPU would sample it (missing
+// channels are 0, missing alpha 1).  Only handles the BC7 mode
+// CompressBlocks() writes, returning false for any other.
+bool DecompressBlocks(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t* rgba);
@@ -4,14 +4,22 @@
 #include <DirectXMath.h>
 
 // Must match vertex shader definition!
-struct VertexShaderExternalData
+// (Uploaded once per frame for every G-buffer draw)
+struct GBufferPerFrameData
 {
-	DirectX::XMFLOAT4X4 world;
-	DirectX::XMFLOAT4X4 worldInverseTranspose;
 	DirectX::XMFLOAT4X4 view;
 	DirectX::XMFLOAT4X4 projection;
 };
 
+// Must match vertex shader definition!
+// (One per G-buffer draw, in a structured buffer indexed by draw ID)
+struct GBufferObjectData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInverseTranspose;
+	DirectX::XMFLOAT4 color;
+};
+
 // Must match pixel shader definition!
 struct PixelShaderExternalData
 {
@@ -22,11 +30,6 @@ struct PixelShaderExternalData
 	Light lights[MAX_LIGHTS];
 };
 
-struct GBufferPixelShaderExternalData
-{
-	DirectX::XMFLOAT4 color;
-};
-
 struct PerFrameData 
 {
 	DirectX::XMFLOAT4X4 InvViewProj;
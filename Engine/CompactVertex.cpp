@@ -0,0 +1,216 @@
+#include "CompactVertex.h"
+
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	float Clamp(float value, float low, float high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	// Matches how the GPU reads UNORM and SNORM formats
+	uint16_t ToUnorm16(float value) { return (uint16_t)(Clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f); }
+	float FromUnorm16(uint16_t value) { return value / 65535.0f; }
+	int16_t ToSnorm16(float value) { return (int16_t)roundf(Clamp(value, -1.0f, 1.0f) * 32767.0f); }
+	float FromSnorm16(int16_t value) { return Clamp(value / 32767.0f, -1.0f, 1.0f); }
+
+	float SignNotZero(float value) { return value >= 0.0f ? 1.0f : -1.0f; }
+
+	// --------------------------------------------------------
+	// Octahedral encoding: projects a unit vector onto an
+	// octahedron, then unfolds the bottom half over the top
+	// half's corners, giving two values in [-1, 1].
+	// See "A Survey of Efficient Representations for
+	// Independent Unit Vectors" (Cigolle et al.)
+	// --------------------------------------------------------
+	void EncodeOctahedral(float x, float y, float z, int16_t out[2])
+	{
+		float sum = fabsf(x) + fabsf(y) + fabsf(z);
+		if (sum == 0.0f)
+		{
+			out[0] = out[1] = 0;
+			return;
+		}
+
+		float u = x / sum;
+		float v = y / sum;
+		if (z < 0.0f)
+		{
+			float foldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+			float foldedV = (1.0f - fabsf(u)) * SignNotZero(v);
+			u = foldedU;
+			v = foldedV;
+		}
+
+		out[0] = ToSnorm16(u);
+		out[1] = ToSnorm16(v);
+	}
+
+	XMFLOAT3 DecodeOctahedral(const int16_t in[2])
+	{
+		float x = FromSnorm16(in[0]);
+		float y = FromSnorm16(in[1]);
+		float z = 1.0f - fabsf(x) - fabsf(y);
+
+		// Unfold the bottom half
+		float t = Clamp(-z, 0.0f, 1.0f);
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		float length = sqrtf(x * x + y * y + z * z);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		return XMFLOAT3(x * scale, y * scale, z * scale);
+	}
+
+	// Angle between two (roughly unit) vectors, in degrees
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		float lengths = sqrtf((a.x * a.x + a.y * a.y + a.z * a.z) * (b.x * b.x + b.y * b.y + b.z * b.z));
+		if (lengths == 0.0f)
+			return 0.0f;
+
+		float cosine = Clamp((a.x * b.x + a.y * b.y + a.z * b.z) / lengths, -1.0f, 1.0f);
+		return acosf(cosine) * (180.0f / XM_PI);
+	}
+}
+
+
+// --------------------------------------------------------
+// Finds the axis-aligned box around a mesh's positions
+//
+// verts - The mesh's vertices
+// count - How many vertices
+// --------------------------------------------------------
+CompactVertexBounds CalculateCompactVertexBounds(const Vertex* verts, size_t count)
+{
+	CompactVertexBounds bounds = {};
+	if (count == 0)
+		return bounds;
+
+	XMFLOAT3 low = verts[0].Position;
+	XMFLOAT3 high = verts[0].Position;
+	for (size_t i = 1; i < count; i++)
+	{
+		const XMFLOAT3& p = verts[i].Position;
+		low.x = fminf(low.x, p.x); high.x = fmaxf(high.x, p.x);
+		low.y = fminf(low.y, p.y); high.y = fmaxf(high.y, p.y);
+		low.z = fminf(low.z, p.z); high.z = fmaxf(high.z, p.z);
+	}
+
+	bounds.min = low;
+	bounds.extent = XMFLOAT3(high.x - low.x, high.y - low.y, high.z - low.z);
+	return bounds;
+}
+
+
+// --------------------------------------------------------
+// Quantizes vertices into the compact layout
+//
+// verts - Full vertices to encode (tangents already calculated)
+// count - How many vertices
+// bounds - Box to quantize positions within (usually from
+//          CalculateCompactVertexBounds())
+// compact - Receives count compact vertices
+// --------------------------------------------------------
+void EncodeCompactVertices(const Vertex* verts, size_t count, const CompactVertexBounds& bounds, CompactVertex* compact)
+{
+	// Flat axes (like a floor's height) quantize to zero
+	XMFLOAT3 scale(
+		bounds.extent.x > 0.0f ? 1.0f / bounds.extent.x : 0.0f,
+		bounds.extent.y > 0.0f ? 1.0f / bounds.extent.y : 0.0f,
+		bounds.extent.z > 0.0f ? 1.0f / bounds.extent.z : 0.0f);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = verts[i];
+		CompactVertex& c = compact[i];
+
+		c.Position[0] = ToUnorm16((v.Position.x - bounds.min.x) * scale.x);
+		c.Position[1] = ToUnorm16((v.Position.y - bounds.min.y) * scale.y);
+		c.Position[2] = ToUnorm16((v.Position.z - bounds.min.z) * scale.z);
+		c.Position[3] = v.Tangent.w < 0.0f ? 0 : 0xFFFF;
+
+		c.UV[0] = XMConvertFloatToHalf(v.UV.x);
+		c.UV[1] = XMConvertFloatToHalf(v.UV.y);
+
+		EncodeOctahedral(v.Normal.x, v.Normal.y, v.Normal.z, c.Normal);
+		EncodeOctahedral(v.Tangent.x, v.Tangent.y, v.Tangent.z, c.Tangent);
+	}
+}
+
+
+// --------------------------------------------------------
+// Expands compact vertices back into full ones, exactly as
+// a vertex shader reading the compact layout would
+//
+// compact - Compact vertices to decode
+// count - How many vertices
+// bounds - The box the positions were quantized within
+// verts - Receives count full vertices
+// --------------------------------------------------------
+void DecodeCompactVertices(const CompactVertex* compact, size_t count, const CompactVertexBounds& bounds, Vertex* verts)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const CompactVertex& c = compact[i];
+		Vertex& v = verts[i];
+
+		v.Position = XMFLOAT3(
+			bounds.min.x + FromUnorm16(c.Position[0]) * bounds.extent.x,
+			bounds.min.y + FromUnorm16(c.Position[1]) * bounds.extent.y,
+			bounds.min.z + FromUnorm16(c.Position[2]) * bounds.extent.z);
+
+		v.UV = XMFLOAT2(XMConvertHalfToFloat(c.UV[0]), XMConvertHalfToFloat(c.UV[1]));
+		v.Normal = DecodeOctahedral(c.Normal);
+
+		XMFLOAT3 tangent = DecodeOctahedral(c.Tangent);
+		v.Tangent = XMFLOAT4(tangent.x, tangent.y, tangent.z, FromUnorm16(c.Position[3]) > 0.5f ? 1.0f : -1.0f);
+	}
+}
+
+
+// --------------------------------------------------------
+// Decodes each compact vertex and measures how far it ended
+// up from the original
+//
+// verts - The original vertices
+// compact - Their compact versions
+// count - How many vertices
+// bounds - The box the positions were quantized within
+// --------------------------------------------------------
+CompactVertexError MeasureCompactVertexError(const Vertex* verts, const CompactVertex* compact, size_t count, const CompactVertexBounds& bounds)
+{
+	CompactVertexError error = {};
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& original = verts[i];
+		Vertex decoded;
+		DecodeCompactVertices(&compact[i], 1, bounds, &decoded);
+
+		float dx = decoded.Position.x - original.Position.x;
+		float dy = decoded.Position.y - original.Position.y;
+		float dz = decoded.Position.z - original.Position.z;
+		error.maxPosition = fmaxf(error.maxPosition, sqrtf(dx * dx + dy * dy + dz * dz));
+
+		error.maxUV = fmaxf(error.maxUV, fmaxf(fabsf(decoded.UV.x - original.UV.x), fabsf(decoded.UV.y - original.UV.y)));
+		error.maxNormalDegrees = fmaxf(error.maxNormalDegrees, AngleDegrees(decoded.Normal, original.Normal));
+
+		// Degenerate (zero) tangents have no direction to lose
+		XMFLOAT3 originalTangent(original.Tangent.x, original.Tangent.y, original.Tangent.z);
+		XMFLOAT3 decodedTangent(decoded.Tangent.x, decoded.Tangent.y, decoded.Tangent.z);
+		error.maxTangentDegrees = fmaxf(error.maxTangentDegrees, AngleDegrees(decodedTangent, originalTangent));
+
+		if ((decoded.Tangent.w < 0.0f) != (original.Tangent.w < 0.0f))
+			error.signMismatches++;
+	}
+
+	const XMFLOAT3& e = bounds.extent;
+	float diagonal = sqrtf(e.x * e.x + e.y * e.y + e.z * e.z);
+	error.maxPositionRelative = diagonal > 0.0f ? error.maxPosition / diagonal : 0.0f;
+	return error;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A quantized version of Vertex, at 20 bytes instead of 48.
+// Each member maps directly to a DXGI format, so a vertex
+// shader can read it without any unpacking of its own:
+//  - Position: R16G16B16A16_UNORM, xyz relative to the mesh's
+//    CompactVertexBounds, w = bitangent sign (1 is +1, 0 is -1)
+//  - UV: R16G16_FLOAT
+//  - Normal, Tangent: R16G16_SNORM, octahedral encoded
+// --------------------------------------------------------
+struct CompactVertex
+{
+	uint16_t Position[4];
+	DirectX::PackedVector::HALF UV[2];
+	int16_t Normal[2];
+	int16_t Tangent[2];
+};
+
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must match its DXGI formats");
+
+// --------------------------------------------------------
+// The box compact positions are quantized within.  A
+// decoded position is min + (unorm position * extent).
+// --------------------------------------------------------
+struct CompactVertexBounds
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 extent;
+};
+
+// --------------------------------------------------------
+// The largest differences between a mesh's original vertices
+// and its decoded compact ones
+// --------------------------------------------------------
+struct CompactVertexError
+{
+	float maxPosition;			// Object space distance
+	float maxPositionRelative;	// maxPosition as a fraction of the bounds' diagonal
+	float maxUV;
+	float maxNormalDegrees;
+	float maxTangentDegrees;
+	size_t signMismatches;		// Vertices whose bitangent sign changed
+};
+
+// Finds the bounds to quantize a mesh's positions within
+CompactVertexBounds CalculateCompactVertexBounds(const Vertex* verts, size_t count);
+
+// Converts full vertices to compact ones, and back
+void EncodeCompactVertices(const Vertex* verts, size_t count, const CompactVertexBounds& bounds, CompactVertex* compact);
+void DecodeCompactVertices(const CompactVertex* compact, size_t count, const CompactVertexBounds& bounds, Vertex* verts);
+
+// Compares original vertices to their decoded compact versions
+CompactVertexError MeasureCompactVertexError(const Vertex* verts, const CompactVertex* compact, size_t count, const CompactVertexBounds& bounds);
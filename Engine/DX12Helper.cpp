@@ -1,13 +1,223 @@
 #include "DX12Helper.h"
 
+#include "TextureProcessing.h"
 #include "WICTextureLoader.h"
 #include "ResourceUploadBatch.h"
 
+#include <algorithm>
+#include <cstdio>
+
 using namespace DirectX;
 
 // Singleton requirement
 DX12Helper* DX12Helper::instance;
 
+// --------------------------------------------------------
+// Static buffers are ranges of shared buffers that other
+// meshes are drawn from, so rather than transitioning after
+// each upload, every buffer copied to is transitioned once
+// after all of a submission's copies.  (Buffers decay back
+// to the common state after every submission, and the first
+// copy promotes them to copy dest.)
+//
+// commandList - Where the copies were recorded
+// copied - Every buffer copied to, emptied afterwards
+// --------------------------------------------------------
+static void TransitionCopiedBuffers(ID3D12GraphicsCommandList* commandList, std::vector<ID3D12Resource*>& copied)
+{
+	for (ID3D12Resource* buffer : copied)
+	{
+		D3D12_RESOURCE_BARRIER rb = {};
+		rb.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		rb.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		rb.Transition.pResource = buffer;
+		rb.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		rb.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
+		rb.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		commandList->ResourceBarrier(1, &rb);
+	}
+	copied.clear();
+}
+
+// Remembers a buffer for TransitionCopiedBuffers()
+static void AddCopiedBuffer(std::vector<ID3D12Resource*>& copied, ID3D12Resource* buffer)
+{
+	if (std::find(copied.begin(), copied.end(), buffer) == copied.end())
+		copied.push_back(buffer);
+}
+
+// --------------------------------------------------------
+// Lets the frame pacer submit our command list, signal and
+// wait on our fence, and move the list between allocators
+// --------------------------------------------------------
+class DX12FrameQueueBackend : public FrameQueueBackend
+{
+public:
+	DX12FrameQueueBackend(DX12Helper& helper) : helper(helper) {}
+
+	void Execute(unsigned int)
+	{
+		helper.commandList->Close();
+		ID3D12CommandList* lists[] = { helper.commandList.Get() };
+		helper.commandQueue->ExecuteCommandLists(1, lists);
+	}
+
+	void Signal(uint64_t fenceValue)
+	{
+		helper.commandQueue->Signal(helper.waitFence.Get(), fenceValue);
+	}
+
+	uint64_t GetCompletedFenceValue()
+	{
+		return helper.waitFence->GetCompletedValue();
+	}
+
+	void WaitForFenceValue(uint64_t fenceValue)
+	{
+		helper.WaitForFenceValue(fenceValue);
+	}
+
+	// Allocators CANNOT be reset while the GPU is using their commands,
+	// but the pacer only gets here once it's done with them
+	// See: https://docs.microsoft.com/en-us/windows/desktop/api/d3d12/nf-d3d12-id3d12commandallocator-reset
+	void Reset(unsigned int frame)
+	{
+		helper.commandAllocators[frame]->Reset();
+		helper.commandList->Reset(helper.commandAllocators[frame].Get(), 0);
+	}
+
+	// A closed list can be reset right away, even while the GPU runs it;
+	// only its allocator has to wait
+	void Reopen(unsigned int frame)
+	{
+		helper.commandList->Reset(helper.commandAllocators[frame].Get(), 0);
+	}
+
+private:
+	DX12Helper& helper;
+};
+
+// --------------------------------------------------------
+// Lets the upload streamer record its copies on our
+// command list, out of one persistently mapped upload
+// buffer that holds the whole staging ring
+// --------------------------------------------------------
+class DX12UploadBackend : public UploadBackend
+{
+public:
+	DX12UploadBackend(
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
+		Microsoft::WRL::ComPtr<ID3D12Resource> stagingBuffer) :
+		commandList(commandList),
+		stagingBuffer(stagingBuffer),
+		stagingAddress(0)
+	{
+		// Keep mapped!
+		D3D12_RANGE range{ 0, 0 };
+		stagingBuffer->Map(0, &range, (void**)&stagingAddress);
+	}
+
+	uint8_t* GetStagingMemory() { return stagingAddress; }
+
+	void RecordCopy(void* destination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size)
+	{
+		AddCopiedBuffer(copied, (ID3D12Resource*)destination);
+		commandList->CopyBufferRegion(
+			(ID3D12Resource*)destination,
+			destinationOffset,
+			stagingBuffer.Get(),
+			stagingOffset,
+			size);
+	}
+
+	// Nothing per buffer; see FinishCopies()
+	void RecordFinished(void*) {}
+
+	// Makes everything copied this frame readable
+	void FinishCopies() { TransitionCopiedBuffers(commandList.Get(), copied); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList;
+	Microsoft::WRL::ComPtr<ID3D12Resource> stagingBuffer;
+	uint8_t* stagingAddress;
+	std::vector<ID3D12Resource*> copied;
+};
+
+// --------------------------------------------------------
+// Lets upload batches stage into committed upload buffers
+// and record their copies on our command list.  Submitting
+// doesn't wait: the batch keeps its arenas until the GPU
+// reaches the fence value it returns, and anything drawn
+// with the buffers is queued after the copies anyway.
+// --------------------------------------------------------
+class DX12UploadBatchBackend : public UploadBatchBackend
+{
+public:
+	DX12UploadBatchBackend(DX12Helper& helper) : helper(helper) {}
+
+	void* CreateArena(uint64_t size, uint8_t*& memory)
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> arena =
+			helper.CreateBufferResource(D3D12_HEAP_TYPE_UPLOAD, size, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+		D3D12_RANGE range{ 0, 0 };
+		arena->Map(0, &range, (void**)&memory);
+
+		// The batch owns this reference until ReleaseArena()
+		return arena.Detach();
+	}
+
+	void ReleaseArena(void* arena)
+	{
+		((ID3D12Resource*)arena)->Release();
+	}
+
+	void RecordCopy(void* destination, uint64_t destinationOffset, void* arena, uint64_t arenaOffset, uint64_t size)
+	{
+		AddCopiedBuffer(copied, (ID3D12Resource*)destination);
+		helper.commandList->CopyBufferRegion(
+			(ID3D12Resource*)destination,
+			destinationOffset,
+			(ID3D12Resource*)arena,
+			arenaOffset,
+			size);
+	}
+
+	// Nothing per buffer; everything copied is transitioned in Submit()
+	void RecordFinished(void*) {}
+
+	uint64_t Submit()
+	{
+		TransitionCopiedBuffers(helper.commandList.Get(), copied);
+		return helper.CloseAndExecuteCommandList();
+	}
+
+	uint64_t GetCompletedFenceValue()
+	{
+		return helper.waitFence->GetCompletedValue();
+	}
+
+private:
+	DX12Helper& helper;
+	std::vector<ID3D12Resource*> copied;
+};
+
+// What a streamed upload holds on to until its data is staged:
+// the destination range and whatever owns the source data
+struct StreamedBufferSource
+{
+	std::shared_ptr<BufferRange> buffer;
+	std::shared_ptr<const void> dataOwner;
+};
+
+// --------------------------------------------------------
+// Gives the range back to its buffer (once the GPU is done)
+// --------------------------------------------------------
+BufferRange::~BufferRange()
+{
+	DX12Helper::GetInstance().FreeBufferRange(heap, allocation);
+}
+
 // --------------------------------------------------------
 // Destructor doesn't have much to do since we're using
 // ComPtrs for all DX12 objects
@@ -23,22 +233,36 @@ void DX12Helper::Initialize(
 	Microsoft::WRL::ComPtr<ID3D12Device> device, 
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList, 
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue, 
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator)
+	const std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>& commandAllocators)
 {
 	// Save objects
 	this->device = device;
 	this->commandList = commandList;
 	this->commandQueue = commandQueue;
-	this->commandAllocator = commandAllocator;
+	this->commandAllocators = commandAllocators;
 
 	// Create the fence for basic synchronization
 	device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(waitFence.GetAddressOf()));
 	waitFenceEvent = CreateEventEx(0, 0, 0, EVENT_ALL_ACCESS);
-	waitFenceCounter = 0;
+
+	// The command list starts out recording with the first allocator
+	frameQueueBackend.reset(new DX12FrameQueueBackend(*this));
+	framePacer.reset(new FramePacer(*frameQueueBackend, (unsigned int)commandAllocators.size()));
 
 	// Create the constant buffer upload heap
 	CreateConstantBufferUploadHeap();
 	CreateCBVSRVDescriptorHeap();
+	CreateTextureStagingHeap();
+
+	// Set up the staging ring for streamed buffers
+	streamingBackend.reset(new DX12UploadBackend(
+		commandList,
+		CreateBufferResource(D3D12_HEAP_TYPE_UPLOAD, StreamingRingSizeInBytes, D3D12_RESOURCE_STATE_GENERIC_READ)));
+	streamer.reset(new UploadStreamer(*streamingBackend, StreamingRingSizeInBytes, StreamingBudgetInBytesPerFrame));
+
+	// And the arenas for batched static buffers
+	uploadBatchBackend.reset(new DX12UploadBatchBackend(*this));
+	uploadBatch.reset(new UploadBatch(*uploadBatchBackend, UploadBatchArenaSizeInBytes, UploadBatchPooledArenaCount));
 
 	// Create the RTV descriptor heap
 	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
@@ -55,165 +279,303 @@ void DX12Helper::Initialize(
 
 
 // --------------------------------------------------------
-// Loads a texture using the DirectX Toolkit and creates a
-// non-shader-visible SRV descriptor heap to hold its SRV.  
-// The handle to this descriptor is returned so materials
-// can copy this texture's SRV to the overall heap later.
+// The DXGI format for a cooked texture's pixels.  Uncompressed
+// ones match what WIC would pick: grayscale stays one channel.
+// --------------------------------------------------------
+static DXGI_FORMAT GetTextureFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat_R8: return DXGI_FORMAT_R8_UNORM;
+	case TextureFormat_BC1: return DXGI_FORMAT_BC1_UNORM;
+	case TextureFormat_BC3: return DXGI_FORMAT_BC3_UNORM;
+	case TextureFormat_BC4: return DXGI_FORMAT_BC4_UNORM;
+	case TextureFormat_BC5: return DXGI_FORMAT_BC5_UNORM;
+	case TextureFormat_BC7: return DXGI_FORMAT_BC7_UNORM;
+	default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+// --------------------------------------------------------
+// Loads a single texture (see LoadTextures).  The handle to
+// its SRV descriptor is returned so materials can copy this
+// texture's SRV to the overall heap later.
 // 
 // file - The image file to attempt to load
 // generateMips - Should mip maps be generated? (defaults to true)
 // --------------------------------------------------------
 D3D12_CPU_DESCRIPTOR_HANDLE DX12Helper::LoadTexture(const wchar_t* file, bool generateMips)
 {
-	// Helper function from DXTK for uploading a resource
-	// (like a texture) to the appropriate GPU memory
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = {};
+	TextureSource<wchar_t> source = { file, 0 };
+	LoadTextures(&source, 1, &cpuHandle, generateMips);
+	return cpuHandle;
+}
+
+// --------------------------------------------------------
+// Loads a set of textures at once.  PNGs are block compressed
+// (BC7, BC5 or BC4, by their names) and cached as DDS files
+// the first time, and every later run maps the cached file
+// instead of decoding.  Either way that happens on worker
+// threads, then every texture goes to the GPU in one DirectX
+// Toolkit upload batch, with a single wait at the end.
+// Anything the engine's decoder can't handle goes through
+// WIC in the same batch instead.  A source with a metal map
+// is packed with its roughness map into one texture (see
+// PackRoughnessMetalTexture()), which WIC can't fall back to.
+// 
+// Each texture's SRV is created in the next slot of the
+// CPU-side staging heap, in the order the files are given,
+// so a material's textures loaded together can be copied
+// all at once.  A texture that can't get a slot, or can't
+// be loaded at all, gets a null handle and is counted in
+// the returned stats.
+// 
+// sources - The image files (or pairs of maps to pack) to attempt to load
+// count - How many textures
+// cpuHandles - Receives the handle to each texture's SRV
+// generateMips - Should mip maps be generated? (defaults to true)
+// --------------------------------------------------------
+TextureLoadStats DX12Helper::LoadTextures(const TextureSource<wchar_t>* sources, unsigned int count, D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, bool generateMips)
+{
+	TextureLoadStats stats = {};
+
+	// Reserve the slots first, so there's nothing to undo if the heap is full
+	std::vector<DescriptorHandle> slots(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		cpuHandles[i] = {};
+		if (!stagingDescriptors->Allocate(1, slots[i]))
+			stats.outOfSlots++;
+	}
+
+	// Decode (or load from the cache) everything on the CPU first, in parallel
+	std::vector<CookedTexture> cooked;
+	CookTextures(sources, count, cooked, generateMips, TextureCache_Use, &stats.cook);
+
+	// Helper from DXTK for uploading resources
+	// (like textures) to the appropriate GPU memory
 	ResourceUploadBatch upload(device.Get());
 	upload.Begin();
 
-	// Attempt to create the texture
-	Microsoft::WRL::ComPtr<ID3D12Resource> texture;
-	CreateWICTextureFromFile(device.Get(), upload, file, texture.GetAddressOf(), generateMips);
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> loaded(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (slots[i].generation == 0)
+			continue;
+
+		// Fall back to WIC (which does its own mips on the GPU),
+		// though only for plain images
+		const CookedTexture& texture = cooked[i];
+		if (!texture.IsValid())
+		{
+			if (!sources[i].metal)
+				CreateWICTextureFromFile(device.Get(), upload, sources[i].file, loaded[i].GetAddressOf(), generateMips);
+			continue;
+		}
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		desc.Width = texture.mips[0].width;
+		desc.Height = texture.mips[0].height;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = (UINT16)texture.mips.size();
+		desc.Format = GetTextureFormat(texture.format);
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_DEFAULT;
+		props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		props.CreationNodeMask = 1;
+		props.VisibleNodeMask = 1;
+
+		if (FAILED(device->CreateCommittedResource(
+			&props,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			0,
+			IID_PPV_ARGS(loaded[i].GetAddressOf()))))
+			continue;
+
+		// The batch copies every mip into its own staging memory right away
+		std::vector<D3D12_SUBRESOURCE_DATA> subresources(texture.mips.size());
+		for (size_t m = 0; m < texture.mips.size(); m++)
+		{
+			subresources[m].pData = texture.pixels.data() + texture.mips[m].offset;
+			subresources[m].RowPitch = (LONG_PTR)texture.GetRowPitch(m);
+			subresources[m].SlicePitch = (LONG_PTR)texture.GetSlicePitch(m);
+		}
+
+		upload.Upload(loaded[i].Get(), 0, subresources.data(), (UINT)subresources.size());
+		upload.Transition(loaded[i].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	}
 
-	// Perform the upload and wait for it to finish before returning the texture
+	// Perform the uploads and wait for them all to finish before returning the textures
 	auto finish = upload.End(commandQueue.Get());
 	finish.wait();
 
-	// Now that we have the texture, add to our list and make a CPU-side descriptor heap
-	// just for this texture's SRV.  Note that it would probably be better to put all 
-	// texture SRVs into the same descriptor heap, but we don't know how many we'll need
-	// until they're all loaded and this is a quick and dirty implementation!
-	textures.push_back(texture);
-
-	// Create the CPU-SIDE descriptor heap for our descriptor
-	D3D12_DESCRIPTOR_HEAP_DESC dhDesc = {};
-	dhDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // Non-shader visible for CPU-side-only descriptor heap!
-	dhDesc.NodeMask = 0;
-	dhDesc.NumDescriptors = 1;
-	dhDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descHeap;
-	device->CreateDescriptorHeap(&dhDesc, IID_PPV_ARGS(descHeap.GetAddressOf()));
-	cpuSideTextureDescriptorHeaps.push_back(descHeap);
-
-	// Create the SRV on this descriptor heap
-	// Note: Using a null description results in the "default" SRV (same format, all mips, all array slices, etc.)
-	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = descHeap->GetCPUDescriptorHandleForHeapStart();
-	device->CreateShaderResourceView(texture.Get(), 0, cpuHandle);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (slots[i].generation == 0)
+			continue;
+
+		// Nothing will ever use this one's slot, and the staging
+		// heap is never read by the GPU, so it's free right away
+		if (!loaded[i])
+		{
+			stagingDescriptors->Free(slots[i], 0);
+			stats.failed++;
+			continue;
+		}
+
+		// Now that we have the texture, add to our list
+		textures.push_back(loaded[i]);
+
+		// Create the SRV in the texture's staging slot
+		// Note: Using a null description results in the "default" SRV (same format, all mips, all array slices, etc.)
+		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = textureStagingHeap->GetCPUDescriptorHandleForHeapStart();
+		cpuHandle.ptr += (SIZE_T)slots[i].index * cbvSrvDescriptorHeapIncrementSize;
+		device->CreateShaderResourceView(loaded[i].Get(), 0, cpuHandle);
+
+		// Return the CPU descriptor handle, which can be used to
+		// copy the descriptor to a shader-visible heap later
+		cpuHandles[i] = cpuHandle;
+		stats.loaded++;
+	}
 
-	// Return the CPU descriptor handle, which can be used to
-	// copy the descriptor to a shader-visible heap later
-	return cpuHandle;
+	stagingDescriptors->ReleaseCompleted(0);
+	return stats;
 }
 
 // --------------------------------------------------------
 // Helper for creating a static buffer that will get
-// data once and remain immutable
+// data once and remain immutable.  Inside an upload batch
+// the data is only staged, and arrives when the batch ends;
+// otherwise its upload is submitted right away.
 // 
 // dataStride - The size of one piece of data in the buffer (like a vertex)
 // dataCount - How many pieces of data (like how many vertices)
 // data - Pointer to the data itself
 // --------------------------------------------------------
-Microsoft::WRL::ComPtr<ID3D12Resource> DX12Helper::CreateStaticBuffer(unsigned int dataStride, unsigned int dataCount, void* data)
+std::shared_ptr<BufferRange> DX12Helper::CreateStaticBuffer(unsigned int dataStride, unsigned int dataCount, const void* data)
 {
-	// Set up the resource pointer
-	Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+	// The data lives in a range of one of the shared buffers in GPU memory
+	std::shared_ptr<BufferRange> buffer = AllocateBufferRange((UINT64)dataStride * dataCount);
 
-	// We first need to make an upload heap where we can copy data to the GPU
-	D3D12_HEAP_PROPERTIES props = {};
-	props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-	props.CreationNodeMask = 1;
-	props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-	props.Type = D3D12_HEAP_TYPE_DEFAULT;
-	props.VisibleNodeMask = 1;
+	// A buffer on its own is just a batch of one
+	BeginUploadBatch();
+	uploadBatch->Stage(buffer->GetResource(), buffer->GetOffset(), data, (uint64_t)dataStride * dataCount);
+	EndUploadBatch();
+	return buffer;
+}
 
-	D3D12_RESOURCE_DESC desc = {};
-	desc.Alignment = 0;
-	desc.DepthOrArraySize = 1;
-	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-	desc.Flags = D3D12_RESOURCE_FLAG_NONE;
-	desc.Format = DXGI_FORMAT_UNKNOWN;
-	desc.Height = 1; // Assuming this is a regular buffer, not a texture
-	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-	desc.MipLevels = 1;
-	desc.SampleDesc.Count = 1;
-	desc.SampleDesc.Quality = 0;
-	desc.Width = dataStride * dataCount; // Size of the buffer
+// --------------------------------------------------------
+// Starts (or nests inside) an upload batch.  Static buffers
+// created before the matching EndUploadBatch() all share
+// one submission, rather than one each.
+// --------------------------------------------------------
+void DX12Helper::BeginUploadBatch()
+{
+	uploadBatch->Begin();
+}
 
-	device->CreateCommittedResource(
-		&props,
-		D3D12_HEAP_FLAG_NONE,
-		&desc,
-		D3D12_RESOURCE_STATE_COPY_DEST, // Will eventually be "common", but we're copying to it first!
-		0,
-		IID_PPV_ARGS(buffer.GetAddressOf()));
+// --------------------------------------------------------
+// Ends an upload batch.  The outermost end submits every
+// staged buffer without waiting, and the staging arenas are
+// reused (or released) once the GPU is done with them.
+// --------------------------------------------------------
+void DX12Helper::EndUploadBatch()
+{
+	uploadBatch->End();
+}
 
-	// Now create an intermediate upload heap for copying initial data
-	D3D12_HEAP_PROPERTIES uploadProps = {};
-	uploadProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-	uploadProps.CreationNodeMask = 1;
-	uploadProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-	uploadProps.Type = D3D12_HEAP_TYPE_UPLOAD; // Can only ever be Generic_Read state
-	uploadProps.VisibleNodeMask = 1;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> uploadHeap;
-	device->CreateCommittedResource(
-		&uploadProps,
-		D3D12_HEAP_FLAG_NONE,
-		&desc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		0,
-		IID_PPV_ARGS(uploadHeap.GetAddressOf()));
-
-
-	// Do a straight map/memcpy/unmap
-	void* gpuAddress = 0;
-	uploadHeap->Map(0, 0, &gpuAddress);
-	memcpy(gpuAddress, data, dataStride * dataCount);
-	uploadHeap->Unmap(0, 0);
-
-	// Copy the whole buffer from uploadheap to vert buffer
-	commandList->CopyResource(buffer.Get(), uploadHeap.Get());
-
-	// Transition the buffer to generic read for the rest of the app lifetime (presumable)
-	D3D12_RESOURCE_BARRIER rb = {};
-	rb.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	rb.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	rb.Transition.pResource = buffer.Get();
-	rb.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-	rb.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
-	rb.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	commandList->ResourceBarrier(1, &rb);
-
-	// Execute the command list and return the buffer
-	CloseExecuteAndResetCommandList();
-	return buffer;
+// --------------------------------------------------------
+// Creates a buffer in GPU memory like CreateStaticBuffer(),
+// but queues its data to stream in over the next few frames
+// instead of uploading it right away.  The buffer can't be
+// used until IsUploadComplete() says its ticket is done.
+// 
+// dataStride - The size of one piece of data in the buffer (like a vertex)
+// dataCount - How many pieces of data (like how many vertices)
+// data - Pointer to the data itself
+// dataOwner - Keeps data alive until it has been staged
+// ticket - Receives the ticket to check for completion
+// --------------------------------------------------------
+std::shared_ptr<BufferRange> DX12Helper::CreateStreamedBuffer(
+	unsigned int dataStride,
+	unsigned int dataCount,
+	const void* data,
+	std::shared_ptr<const void> dataOwner,
+	UploadTicket& ticket)
+{
+	// The range can't go back to its buffer while data is still on its way
+	std::shared_ptr<StreamedBufferSource> source = std::make_shared<StreamedBufferSource>();
+	source->buffer = AllocateBufferRange((UINT64)dataStride * dataCount);
+	source->dataOwner = dataOwner;
+
+	ticket = streamer->Queue(
+		source->buffer->GetResource(),
+		source->buffer->GetOffset(),
+		data,
+		(uint64_t)dataStride * dataCount,
+		source);
+	return source->buffer;
 }
 
-D3D12_GPU_DESCRIPTOR_HANDLE DX12Helper::CreateGBufferSRV(Microsoft::WRL::ComPtr<ID3D12Resource> gBufferTexture, DXGI_FORMAT format)
+// --------------------------------------------------------
+// Has a streamed buffer's data finished arriving on the GPU?
+// --------------------------------------------------------
+bool DX12Helper::IsUploadComplete(UploadTicket ticket)
 {
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-
-	// Grab the actual heap start on both sides and offset to the next open SRV portion
-	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = cbvSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = cbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	return streamer->IsComplete(ticket);
+}
 
-	cpuHandle.ptr += (SIZE_T)srvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
-	gpuHandle.ptr += (SIZE_T)srvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
+// --------------------------------------------------------
+// Records this frame's share of the streamed uploads.  Call
+// at the start of the frame, before anything reads from the
+// static buffers, so the copies finish with the frame's
+// fence value and everything drawn sees them.
+// --------------------------------------------------------
+void DX12Helper::RecordStreamingUploads()
+{
+	streamer->RecordUploads(waitFence->GetCompletedValue(), framePacer->GetNextFenceValue());
+	static_cast<DX12UploadBackend*>(streamingBackend.get())->FinishCopies();
+}
 
-	device->CreateShaderResourceView(gBufferTexture.Get(), &srvDesc, cpuHandle);
+// --------------------------------------------------------
+// Creates SRVs for G-buffer textures in one range of the
+// final CBV/SRV heap, so they can be bound as a table.
+// Free the range (FreeSRVs) before creating new ones when
+// the textures are recreated.
+// 
+// gBufferTextures - The textures to make SRVs for
+// formats - The format to view each texture as
+// count - How many textures
+// --------------------------------------------------------
+DescriptorHandle DX12Helper::CreateGBufferSRVs(const Microsoft::WRL::ComPtr<ID3D12Resource>* gBufferTextures, const DXGI_FORMAT* formats, unsigned int count)
+{
+	DescriptorHandle srvs = AllocateSRVs(count);
+	if (srvs.generation == 0)
+		return srvs;
 
-	//// We know where to copy these descriptors, so copy all of them and remember the new offset
-	//device->CopyDescriptorsSimple(1, cpuHandle, firstDescriptorToCopy, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	srvDescriptorOffset += 1;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = formats[i];
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = 1;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+
+		device->CreateShaderResourceView(gBufferTextures[i].Get(), &srvDesc, GetSRVCPUHandle(srvs, i));
+	}
 
-	// Pass back the GPU handle to the start of this section
-	// in the final CBV/SRV heap so the caller can use it later
-	return gpuHandle;
+	return srvs;
 }
 
 //Microsoft::WRL::ComPtr<ID3D12Resource> DX12Helper::CreateGBufferTexture(ID3D12Device* device, UINT width, UINT height, DXGI_FORMAT format, UINT offset)
@@ -278,7 +640,9 @@ Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DX12Helper::GetCBVSRVDescriptorHeap
 // it like a ring buffer).  Then creates a CBV in the next
 // "unused" spot in the CBV heap that points to the 
 // aforementioned spot in the upload heap and returns that 
-// CBV (a GPU descriptor handle)
+// CBV (a GPU descriptor handle).  Spots only count as
+// unused once the GPU has finished the frame that used them.
+// Returns a null handle if this frame has used them all up.
 // 
 // data - The data to copy to the GPU
 // dataSizeInBytes - The byte size of the data to copy
@@ -292,29 +656,11 @@ D3D12_GPU_DESCRIPTOR_HANDLE DX12Helper::FillNextConstantBufferAndGetGPUDescripto
 	reservationSize = (reservationSize + 255); // Add 255 so we can drop last few bits
 	reservationSize = reservationSize & ~255;  // Flip 255 and then use it to mask 
 
-	// Ensure this upload will fit in the remaining space.  If not, reset to beginning.
-	if (cbUploadHeapOffsetInBytes + reservationSize >= cbUploadHeapSizeInBytes)
-		cbUploadHeapOffsetInBytes = 0;
-
-	// Where in the upload heap will this data go?
-	D3D12_GPU_VIRTUAL_ADDRESS virtualGPUAddress =
-		cbUploadHeap->GetGPUVirtualAddress() + cbUploadHeapOffsetInBytes;
-
-	// === Copy data to the upload heap ===
-	{
-		// Calculate the actual upload address (which we got from mapping the buffer)
-		// Note that this is different than the GPU virtual address needed for the CBV below
-		void* uploadAddress = reinterpret_cast<void*>((SIZE_T)cbUploadHeapStartAddress + cbUploadHeapOffsetInBytes);
-
-		// Perform the mem copy to put new data into this part of the heap
-		memcpy(uploadAddress, data, dataSizeInBytes);
-
-		// Increment the offset and loop back to the beginning if necessary,
-		// allowing us to treat the upload heap like a ring buffer
-		cbUploadHeapOffsetInBytes += reservationSize;
-		if (cbUploadHeapOffsetInBytes >= cbUploadHeapSizeInBytes)
-			cbUploadHeapOffsetInBytes = 0;
-	}
+	// Copy the data to the upload heap and reserve a descriptor for this frame
+	D3D12_GPU_VIRTUAL_ADDRESS virtualGPUAddress = FillNextConstantBuffer(data, dataSizeInBytes);
+	UINT64 cbvDescriptorOffset = 0;
+	if (virtualGPUAddress == 0 || !ReserveFrameRingSpace(*cbvDescriptorRing, 1, cbvDescriptorOffset))
+		return D3D12_GPU_DESCRIPTOR_HANDLE{};
 
 	// Create a CBV for this section of the heap
 	{
@@ -337,12 +683,6 @@ D3D12_GPU_DESCRIPTOR_HANDLE DX12Helper::FillNextConstantBufferAndGetGPUDescripto
 		// Create the CBV, which is a lightweight operation in DX12
 		device->CreateConstantBufferView(&cbvDesc, cpuHandle);
 
-		// Increment the offset and loop back to the beginning if necessary
-		// which allows us to treat the descriptor heap as a ring buffer
-		cbvDescriptorOffset++;
-		if (cbvDescriptorOffset >= maxConstantBuffers)
-			cbvDescriptorOffset = 0;
-
 		// Now that the CBV is ready, we return the GPU handle to it
 		// so it can be set as part of the root signature during drawing
 		return gpuHandle;
@@ -350,54 +690,221 @@ D3D12_GPU_DESCRIPTOR_HANDLE DX12Helper::FillNextConstantBufferAndGetGPUDescripto
 }
 
 
+// --------------------------------------------------------
+// Reserves a range of SRVs in the final CBV/SRV descriptor
+// heap, reusing ranges freed earlier.  Returns a handle with
+// a generation of 0 if the heap is full.
+// 
+// count - How many SRVs
+// --------------------------------------------------------
+DescriptorHandle DX12Helper::AllocateSRVs(unsigned int count)
+{
+	srvDescriptors->ReleaseCompleted(waitFence->GetCompletedValue());
+
+	DescriptorHandle srvs = {};
+	if (!srvDescriptors->Allocate(count, srvs))
+		printf("Out of SRV descriptors (%u requested)\n", count);
+	return srvs;
+}
+
+// --------------------------------------------------------
+// Gives a range of SRVs back, once the GPU has finished
+// everything that could be using it (everything up to the
+// next fence value signaled).  Freeing a handle with a
+// generation of 0, or one that's already free, does nothing.
+// --------------------------------------------------------
+void DX12Helper::FreeSRVs(const DescriptorHandle& srvs)
+{
+	if (srvs.generation != 0)
+		srvDescriptors->Free(srvs, framePacer->GetNextFenceValue());
+}
+
 // --------------------------------------------------------
 // Copies one or more SRVs starting at the given CPU handle
-// to the final CBV/SRV descriptor heap, and returns
-// the GPU handle to the beginning of this section.
+// into a range of the final CBV/SRV descriptor heap.
 // 
+// srvs - The range to copy into
+// firstSRV - Where in the range the first one goes
 // firstDescriptorToCopy - The handle to the first descriptor
 // numDescriptorsToCopy - How many to copy
 // --------------------------------------------------------
-D3D12_GPU_DESCRIPTOR_HANDLE DX12Helper::CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptorToCopy, unsigned int numDescriptorsToCopy)
+void DX12Helper::CopySRVs(const DescriptorHandle& srvs, unsigned int firstSRV, D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptorToCopy, unsigned int numDescriptorsToCopy)
 {
-	// Grab the actual heap start on both sides and offset to the next open SRV portion
-	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = cbvSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = cbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-	
-	cpuHandle.ptr += (SIZE_T)srvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
-	gpuHandle.ptr += (SIZE_T)srvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
+	if (!srvDescriptors->IsValid(srvs) || firstSRV + numDescriptorsToCopy > srvs.count)
+		return;
+
+	device->CopyDescriptorsSimple(numDescriptorsToCopy, GetSRVCPUHandle(srvs, firstSRV), firstDescriptorToCopy, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	descriptorCopyCalls++;
+	descriptorsCopied += numDescriptorsToCopy;
+}
+
+// --------------------------------------------------------
+// Copies a whole range's worth of SRVs, one per CPU handle,
+// into a range of the final CBV/SRV descriptor heap.  Runs
+// of handles that are next to each other in their heap
+// (like textures loaded one after another) are copied with
+// a single call.  Null handles are skipped.
+// 
+// srvs - The range to copy into
+// descriptorsToCopy - The handle for each SRV in the range
+// numDescriptorsToCopy - How many handles
+// --------------------------------------------------------
+void DX12Helper::CopySRVs(const DescriptorHandle& srvs, const D3D12_CPU_DESCRIPTOR_HANDLE* descriptorsToCopy, unsigned int numDescriptorsToCopy)
+{
+	unsigned int first = 0;
+	while (first < numDescriptorsToCopy)
+	{
+		if (descriptorsToCopy[first].ptr == 0)
+		{
+			first++;
+			continue;
+		}
+
+		// Extend the run while each handle follows the one before it
+		unsigned int count = 1;
+		while (first + count < numDescriptorsToCopy &&
+			descriptorsToCopy[first + count].ptr == descriptorsToCopy[first].ptr + count * cbvSrvDescriptorHeapIncrementSize)
+			count++;
+
+		CopySRVs(srvs, first, descriptorsToCopy[first], count);
+		first += count;
+	}
+}
 
-	// We know where to copy these descriptors, so copy all of them and remember the new offset
-	device->CopyDescriptorsSimple(numDescriptorsToCopy, cpuHandle, firstDescriptorToCopy, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	srvDescriptorOffset += numDescriptorsToCopy;
+// --------------------------------------------------------
+// Totals for texture descriptors so far, for reporting
+// --------------------------------------------------------
+DescriptorStats DX12Helper::GetDescriptorStats()
+{
+	DescriptorAllocatorStats staging = stagingDescriptors->GetStats();
+	DescriptorAllocatorStats shaderVisible = srvDescriptors->GetStats();
+
+	DescriptorStats stats = {};
+	stats.stagingDescriptors = staging.used;
+	stats.stagingCapacity = staging.capacity;
+	stats.srvRanges = shaderVisible.liveRanges;
+	stats.srvsUsed = shaderVisible.used - shaderVisible.pending;
+	stats.srvCapacity = shaderVisible.capacity;
+	stats.copyCalls = descriptorCopyCalls;
+	stats.descriptorsCopied = descriptorsCopied;
+	return stats;
+}
 
-	// Pass back the GPU handle to the start of this section
-	// in the final CBV/SRV heap so the caller can use it later
+// --------------------------------------------------------
+// The GPU handle of one SRV in a range (the first by
+// default, which is the start of its table)
+// --------------------------------------------------------
+D3D12_GPU_DESCRIPTOR_HANDLE DX12Helper::GetSRVGPUHandle(const DescriptorHandle& srvs, unsigned int srv)
+{
+	// SRVs are after all possible CBVs
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = cbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	gpuHandle.ptr += (SIZE_T)(maxConstantBuffers + srvs.index + srv) * cbvSrvDescriptorHeapIncrementSize;
 	return gpuHandle;
 }
 
+D3D12_CPU_DESCRIPTOR_HANDLE DX12Helper::GetSRVCPUHandle(const DescriptorHandle& srvs, unsigned int srv)
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = cbvSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	cpuHandle.ptr += (SIZE_T)(maxConstantBuffers + srvs.index + srv) * cbvSrvDescriptorHeapIncrementSize;
+	return cpuHandle;
+}
+
+
+
+// --------------------------------------------------------
+// Copies the given data into the next "unused" spot in
+// the CBV upload heap, like the function above, but skips
+// the CBV and returns the GPU address of the data instead,
+// for binding directly as a root CBV (0 if there's no room).
+// 
+// data - The data to copy to the GPU
+// dataSizeInBytes - The byte size of the data to copy
+// --------------------------------------------------------
+D3D12_GPU_VIRTUAL_ADDRESS DX12Helper::FillNextConstantBuffer(void* data, unsigned int dataSizeInBytes)
+{
+	D3D12_GPU_VIRTUAL_ADDRESS virtualGPUAddress = 0;
+	void* uploadAddress = ReserveFrameUpload(dataSizeInBytes, virtualGPUAddress);
+	if (!uploadAddress)
+		return 0;
+
+	// Perform the mem copy to put new data into this part of the heap
+	memcpy(uploadAddress, data, dataSizeInBytes);
+	return virtualGPUAddress;
+}
+
+// --------------------------------------------------------
+// Reserves room in the CBV upload heap for data this frame
+// writes itself (like a whole structured buffer of
+// per-object data), so it doesn't need copying first.  The
+// room starts on a multiple of 256 bytes and stays reserved
+// until the GPU finishes this frame.
+// Note: The heap is write-combined memory, so write it in
+//       order and never read it back.
+// 
+// sizeInBytes - How much room is needed
+// gpuAddress - Receives the GPU address of the room
+// Returns the CPU address to write the data to, or null if
+// this frame has used up the whole heap
+// --------------------------------------------------------
+void* DX12Helper::ReserveFrameUpload(UINT64 sizeInBytes, D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress)
+{
+	// Keeping every reservation a multiple of 256 keeps the next one aligned too
+	UINT64 reservationSize = (sizeInBytes + 255) & ~255ull;
+	if (reservationSize == 0)
+		reservationSize = 256;
 
+	// Where in the upload heap will this data go?
+	UINT64 cbUploadHeapOffsetInBytes = 0;
+	gpuAddress = 0;
+	if (!ReserveFrameRingSpace(*cbUploadRing, reservationSize, cbUploadHeapOffsetInBytes))
+		return 0;
+	gpuAddress = cbUploadHeap->GetGPUVirtualAddress() + cbUploadHeapOffsetInBytes;
+
+	// The actual upload address (which we got from mapping the buffer)
+	// Note that this is different than the GPU virtual address
+	return reinterpret_cast<void*>((SIZE_T)cbUploadHeapStartAddress + cbUploadHeapOffsetInBytes);
+}
+
+// --------------------------------------------------------
+// Closes the current command list at the end of a frame and
+// tells the GPU to start executing those commands, then
+// resets the list to record the next frame with the next
+// allocator.  This only waits if the GPU is still running
+// the last frame that used that allocator, so the CPU can
+// get FramesInFlight frames ahead.
+// --------------------------------------------------------
+void DX12Helper::CloseExecuteAndMoveToNextFrame()
+{
+	FinishFrameRings();
+	framePacer->EndFrame();
+
+	// Upload arenas don't have to wait for the next batch to come free
+	uploadBatch->ReleaseCompleted();
+}
 
 // --------------------------------------------------------
 // Closes the current command list and tells the GPU to
 // start executing those commands.  We also wait for
-// the GPU to finish this work so we can reset the
-// command allocator (which CANNOT be reset while the
-// GPU is using its commands) and the command list itself.
+// the GPU to finish this work (and every frame before it)
+// before resetting the command list, for anything that
+// needs its results straight away.
 // --------------------------------------------------------
 void DX12Helper::CloseExecuteAndResetCommandList()
 {
-	// Close the current list and execute it as our only list
-	commandList->Close();
-	ID3D12CommandList* lists[] = { commandList.Get() };
-	commandQueue->ExecuteCommandLists(1, lists);
+	FinishFrameRings();
+	framePacer->SubmitAndWait();
+}
 
-	// Always wait before reseting command allocator, as it should not
-	// be reset while the GPU is processing a command list
-	// See: https://docs.microsoft.com/en-us/windows/desktop/api/d3d12/nf-d3d12-id3d12commandallocator-reset
-	WaitForGPU();
-	commandAllocator->Reset();
-	commandList->Reset(commandAllocator.Get(), 0);
+// --------------------------------------------------------
+// Closes the current command list and tells the GPU to
+// start executing those commands, but doesn't wait: the
+// list carries on recording the same frame.  Returns the
+// fence value that's signaled once the GPU is done.
+// --------------------------------------------------------
+UINT64 DX12Helper::CloseAndExecuteCommandList()
+{
+	FinishFrameRings();
+	return framePacer->SubmitAndContinue();
 }
 
 
@@ -407,23 +914,174 @@ void DX12Helper::CloseExecuteAndResetCommandList()
 // --------------------------------------------------------
 void DX12Helper::WaitForGPU()
 {
-	// Update our ongoing fence value (a unique index for each "stop sign")
-	// and then place that value into the GPU's command queue
-	waitFenceCounter++;
-	int add = 10;
-	commandQueue->Signal(waitFence.Get(), waitFenceCounter);
+	// Submits whatever's recorded, places the next fence value
+	// (a unique index for each "stop sign") into the GPU's
+	// command queue after it and waits for it
+	FinishFrameRings();
+	framePacer->SubmitAndWait();
+}
+
+// --------------------------------------------------------
+// Constant buffers used by the commands about to be
+// submitted stay reserved until the fence value signaled
+// after them is reached
+// --------------------------------------------------------
+void DX12Helper::FinishFrameRings()
+{
+	cbUploadRing->FinishFrame(framePacer->GetNextFenceValue());
+	cbvDescriptorRing->FinishFrame(framePacer->GetNextFenceValue());
+}
 
+// --------------------------------------------------------
+// Makes our C++ code wait until the GPU reaches a fence
+// value that has already been signaled
+// --------------------------------------------------------
+void DX12Helper::WaitForFenceValue(UINT64 fenceValue)
+{
 	// Check to see if the most recently completed fence value
-	// is less than the one we just set.
-	if (waitFence->GetCompletedValue() < waitFenceCounter)
+	// is less than the one we're after.
+	if (waitFence->GetCompletedValue() < fenceValue)
 	{
 		// Tell the fence to let us know when it's hit, and then
 		// sit an wait until that fence is hit.
-		waitFence->SetEventOnCompletion(waitFenceCounter, waitFenceEvent);
+		waitFence->SetEventOnCompletion(fenceValue, waitFenceEvent);
 		WaitForSingleObject(waitFenceEvent, INFINITE);
 	}
 }
 
+// --------------------------------------------------------
+// Reserves space in one of the per-frame rings.  If the GPU
+// is still using all of it, waits for the oldest unfinished
+// frame (one at a time) until there's room.  Returns false
+// if this frame has filled the ring by itself: everything
+// in it is still waiting to be submitted, so nothing can be
+// reused and the caller has to go without.
+// 
+// ring - The ring to reserve from
+// size - How much space (in the ring's units)
+// offset - Receives where the space starts
+// --------------------------------------------------------
+bool DX12Helper::ReserveFrameRingSpace(FrameRing& ring, UINT64 size, UINT64& offset)
+{
+	offset = 0;
+	if (ring.AllocateWaiting(size, waitFence->GetCompletedValue(), [this](UINT64 fenceValue) { WaitForFenceValue(fenceValue); }, offset))
+		return true;
+
+	printf("Per-frame ring of %llu is too small for this frame (%llu more needed), skipping\n",
+		(unsigned long long)ring.GetCapacity(),
+		(unsigned long long)size);
+	return false;
+}
+
+
+
+// --------------------------------------------------------
+// Finds room for static data in one of the shared buffers,
+// making a new one if none has room
+// 
+// sizeInBytes - How much room is needed
+// --------------------------------------------------------
+std::shared_ptr<BufferRange> DX12Helper::AllocateBufferRange(UINT64 sizeInBytes)
+{
+	ReleaseCompletedBufferRanges();
+
+	TlsfAllocation allocation;
+	for (unsigned int i = 0; i < bufferHeaps.size(); i++)
+	{
+		if (bufferHeaps[i] && bufferHeaps[i]->allocator.Allocate(sizeInBytes, StaticBufferAlignment, allocation))
+			return std::make_shared<BufferRange>(i, bufferHeaps[i]->buffer.Get(), allocation);
+	}
+
+	// Data too big for a shared buffer gets one to itself (with
+	// a little extra, since the allocator wants room to align)
+	UINT64 heapSize = StaticBufferHeapSizeInBytes;
+	if (sizeInBytes + StaticBufferAlignment > heapSize)
+		heapSize = (sizeInBytes + 2 * StaticBufferAlignment - 1) & ~(StaticBufferAlignment - 1);
+
+	// Reuse the slot of a released heap if there is one
+	unsigned int index = 0;
+	while (index < bufferHeaps.size() && bufferHeaps[index])
+		index++;
+	if (index == bufferHeaps.size())
+		bufferHeaps.emplace_back();
+
+	bufferHeaps[index].reset(new BufferHeap(heapSize));
+	bufferHeaps[index]->buffer = CreateBufferResource(D3D12_HEAP_TYPE_DEFAULT, heapSize, D3D12_RESOURCE_STATE_COMMON);
+	bufferHeaps[index]->allocator.Allocate(sizeInBytes, StaticBufferAlignment, allocation);
+	return std::make_shared<BufferRange>(index, bufferHeaps[index]->buffer.Get(), allocation);
+}
+
+// --------------------------------------------------------
+// Queues a range to go back to its buffer once the GPU has
+// finished everything that could be using it, which is
+// everything up to the next fence value signaled
+// --------------------------------------------------------
+void DX12Helper::FreeBufferRange(unsigned int heap, const TlsfAllocation& allocation)
+{
+	PendingBufferFree pending = { framePacer->GetNextFenceValue(), heap, allocation };
+	pendingBufferFrees.push_back(pending);
+}
+
+// --------------------------------------------------------
+// Returns ranges the GPU is done with to their buffers, and
+// releases buffers made for one big piece of data once
+// they're empty
+// --------------------------------------------------------
+void DX12Helper::ReleaseCompletedBufferRanges()
+{
+	UINT64 completed = waitFence->GetCompletedValue();
+	while (!pendingBufferFrees.empty() && pendingBufferFrees.front().fenceValue <= completed)
+	{
+		std::unique_ptr<BufferHeap>& heap = bufferHeaps[pendingBufferFrees.front().heap];
+		heap->allocator.Free(pendingBufferFrees.front().allocation);
+		if (heap->allocator.IsEmpty() && heap->allocator.GetCapacity() > StaticBufferHeapSizeInBytes)
+			heap.reset();
+
+		pendingBufferFrees.pop_front();
+	}
+}
+
+// --------------------------------------------------------
+// Creates a committed buffer of the given size
+// 
+// heapType - Default for GPU-only memory, upload for CPU-writable memory
+// sizeInBytes - How big the buffer is
+// initialState - The state the buffer starts out in
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D12Resource> DX12Helper::CreateBufferResource(D3D12_HEAP_TYPE heapType, UINT64 sizeInBytes, D3D12_RESOURCE_STATES initialState)
+{
+	Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+
+	D3D12_HEAP_PROPERTIES props = {};
+	props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	props.CreationNodeMask = 1;
+	props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	props.Type = heapType;
+	props.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Alignment = 0;
+	desc.DepthOrArraySize = 1;
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	desc.Format = DXGI_FORMAT_UNKNOWN;
+	desc.Height = 1; // Assuming this is a regular buffer, not a texture
+	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	desc.MipLevels = 1;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Width = sizeInBytes; // Size of the buffer
+
+	device->CreateCommittedResource(
+		&props,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		initialState,
+		0,
+		IID_PPV_ARGS(buffer.GetAddressOf()));
+
+	return buffer;
+}
 
 
 // --------------------------------------------------------
@@ -435,13 +1093,14 @@ void DX12Helper::WaitForGPU()
 void DX12Helper::CreateConstantBufferUploadHeap()
 {
 	// This heap MUST have a size that is a multiple of 256
-	// We'll support up to the max number of CBs if they're
-	// all 256 bytes or less, or fewer overall CBs if they're larger
-	cbUploadHeapSizeInBytes = maxConstantBuffers * 256;
+	// It has room for the max number of CBs if they're all 256
+	// bytes or less, plus whatever other per-frame data there is
+	cbUploadHeapSizeInBytes = FrameUploadHeapSizeInBytes;
 	
-	// Assume the first CB will start at the beginning of the heap
-	// This offset changes as we use more CBs, and wraps around when full
-	cbUploadHeapOffsetInBytes = 0;
+	// Each frame's CBs go in the next part of the heap, wrapping
+	// around once the GPU is finished with the frames at the start
+	// (every reservation is a multiple of 256, so they stay aligned)
+	cbUploadRing.reset(new FrameRing(cbUploadHeapSizeInBytes));
 
 	// Create the upload heap for our constant buffer
 	D3D12_HEAP_PROPERTIES heapProps = {};
@@ -485,8 +1144,8 @@ void DX12Helper::CreateConstantBufferUploadHeap()
 // this heap is partially treated as a ring buffer, allowing 
 // the program to continually re-use the memory as frames 
 // progress.  However, after the initial CBV portion, the
-// SRV descriptors are stored statically, with each material
-// tracking the start of its descriptor range.
+// SRV descriptors are handed out in ranges that stay put
+// until freed, with each material tracking its own range.
 // --------------------------------------------------------
 void DX12Helper::CreateCBVSRVDescriptorHeap()
 {
@@ -502,11 +1161,29 @@ void DX12Helper::CreateCBVSRVDescriptorHeap()
 	dhDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV; // This heap can store CBVs, SRVs and UAVs
 	device->CreateDescriptorHeap(&dhDesc, IID_PPV_ARGS(cbvSrvDescriptorHeap.GetAddressOf()));
 
-	// Assume the first CBV will be at the beginning of the heap
-	// This will increase as we use more CBVs and will wrap back to 0
-	// when it reaches maxConstantBuffers
-	cbvDescriptorOffset = 0;
+	// CBVs are at the beginning of the heap, and like the CBs they
+	// point to, wrap back to 0 once the GPU is done with them
+	cbvDescriptorRing.reset(new FrameRing(maxConstantBuffers));
+
+	// SRVs are after all possible CBVs, in ranges that are
+	// reused once the GPU is done with them
+	srvDescriptors.reset(new DescriptorAllocator(maxTextureDescriptors));
+}
+
+// --------------------------------------------------------
+// Creates the CPU-side (non-shader-visible) heap that every
+// loaded texture's SRV lives in until materials copy it to
+// the final heap.  Descriptors here are only ever sources
+// for copies, so the GPU never reads them.
+// --------------------------------------------------------
+void DX12Helper::CreateTextureStagingHeap()
+{
+	D3D12_DESCRIPTOR_HEAP_DESC dhDesc = {};
+	dhDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // Non-shader visible for CPU-side-only descriptor heap!
+	dhDesc.NodeMask = 0;
+	dhDesc.NumDescriptors = maxStagingTextureDescriptors;
+	dhDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	device->CreateDescriptorHeap(&dhDesc, IID_PPV_ARGS(textureStagingHeap.GetAddressOf()));
 
-	// Assume the first SRV will be after all possible CBVs
-	srvDescriptorOffset = maxConstantBuffers;
+	stagingDescriptors.reset(new DescriptorAllocator(maxStagingTextureDescriptors));
 }
\ No newline at end of file
@@ -3,8 +3,93 @@
 #include <d3d12.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
+#include <deque>
+#include <memory>
 #include <vector>
 
+#include "DescriptorAllocator.h"
+#include "FramePacer.h"
+#include "FrameRing.h"
+#include "TextureProcessing.h"
+#include "TlsfAllocator.h"
+#include "UploadBatch.h"
+#include "UploadStreamer.h"
+
+// How many frames the CPU can get ahead of the GPU (2 or 3),
+// each with its own command allocator
+const unsigned int FramesInFlight = 2;
+
+// Constant buffers and other data written each frame (like
+// per-object data) share an upload heap this big, split
+// between the frames in flight
+const UINT64 FrameUploadHeapSizeInBytes = 8 * 1024 * 1024;
+
+// Staging memory for streamed buffers, and how much of it
+// each frame may fill (big buffers take several frames)
+const UINT64 StreamingRingSizeInBytes = 32 * 1024 * 1024;
+const UINT64 StreamingBudgetInBytesPerFrame = 4 * 1024 * 1024;
+
+// Batched static buffers share staging arenas of this size,
+// and up to this many are kept for reuse between batches
+const UINT64 UploadBatchArenaSizeInBytes = 8 * 1024 * 1024;
+const size_t UploadBatchPooledArenaCount = 4;
+
+// Static buffers are ranges of shared GPU buffers this big
+// (bigger data gets a buffer to itself), starting on
+// multiples of the alignment
+const UINT64 StaticBufferHeapSizeInBytes = 64 * 1024 * 1024;
+const UINT64 StaticBufferAlignment = 256;
+
+// --------------------------------------------------------
+// A range of one of the shared static buffers.  The range
+// goes back to its buffer when this is destroyed, once the
+// GPU has finished with it.
+// --------------------------------------------------------
+class BufferRange
+{
+public:
+	BufferRange(unsigned int heap, ID3D12Resource* resource, const TlsfAllocation& allocation) :
+		heap(heap),
+		resource(resource),
+		allocation(allocation)
+	{};
+	~BufferRange();
+
+	ID3D12Resource* GetResource() const { return resource; }
+	UINT64 GetOffset() const { return allocation.offset; }
+	D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() const { return resource->GetGPUVirtualAddress() + allocation.offset; }
+
+private:
+	unsigned int heap;
+	ID3D12Resource* resource;
+	TlsfAllocation allocation;
+};
+
+// How textures' SRVs got into the final heap: the staging
+// heap they're created in, the ranges materials reserved,
+// and the copies between the two
+struct DescriptorStats
+{
+	unsigned int stagingDescriptors;
+	unsigned int stagingCapacity;
+	unsigned int srvRanges;
+	unsigned int srvsUsed;
+	unsigned int srvCapacity;
+	unsigned int copyCalls;
+	unsigned int descriptorsCopied;
+};
+
+// How a set of textures loaded: the CPU side of it (decode,
+// mips, compression and cache hits) and any that never got
+// an SRV, which are left with null handles
+struct TextureLoadStats
+{
+	TextureCookStats cook;
+	unsigned int loaded;
+	unsigned int outOfSlots;	// No staging descriptor was left for them
+	unsigned int failed;		// Couldn't be decoded or created on the GPU
+};
+
 class DX12Helper
 {
 #pragma region Singleton
@@ -27,15 +112,13 @@ public:
 private:
 	static DX12Helper* instance;
 	DX12Helper() :
-		cbUploadHeapOffsetInBytes(0),
 		cbUploadHeapSizeInBytes(0),
 		cbUploadHeapStartAddress(0),
-		cbvDescriptorOffset(0),
 		cbvSrvDescriptorHeapIncrementSize(0),
-		srvDescriptorOffset(0),
 		waitFence(0),
-		waitFenceCounter(0),
-		waitFenceEvent(0)
+		waitFenceEvent(0),
+		descriptorCopyCalls(0),
+		descriptorsCopied(0)
 	{};
 #pragma endregion
 
@@ -47,7 +130,7 @@ public:
 		Microsoft::WRL::ComPtr<ID3D12Device> device,
 		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList,
 		Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
-		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator
+		const std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>& commandAllocators
 	);
 
 	// Getters
@@ -55,21 +138,48 @@ public:
 
 	// Resource creation
 	D3D12_CPU_DESCRIPTOR_HANDLE LoadTexture(const wchar_t* file, bool generateMips = true);
-	Microsoft::WRL::ComPtr<ID3D12Resource> CreateStaticBuffer(unsigned int dataStride, unsigned int dataCount, void* data);
-	D3D12_GPU_DESCRIPTOR_HANDLE CreateGBufferSRV(Microsoft::WRL::ComPtr<ID3D12Resource> gBufferTexture, DXGI_FORMAT format);
+	TextureLoadStats LoadTextures(const TextureSource<wchar_t>* sources, unsigned int count, D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, bool generateMips = true);
+	std::shared_ptr<BufferRange> CreateStaticBuffer(unsigned int dataStride, unsigned int dataCount, const void* data);
+	std::shared_ptr<BufferRange> CreateStreamedBuffer(
+		unsigned int dataStride,
+		unsigned int dataCount,
+		const void* data,
+		std::shared_ptr<const void> dataOwner,
+		UploadTicket& ticket);
+	DescriptorHandle CreateGBufferSRVs(const Microsoft::WRL::ComPtr<ID3D12Resource>* gBufferTextures, const DXGI_FORMAT* formats, unsigned int count);
 	//void CreateLightingPassSRV(ID3D12Resource* gBufferTexture, D3D12_CPU_DESCRIPTOR_HANDLE& srvHandle);
 	//Microsoft::WRL::ComPtr<ID3D12Resource> CreateGBufferTexture(ID3D12Device* device, UINT width, UINT height, DXGI_FORMAT format, UINT offset);
 	
 	std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> shaderVisibleTextureDescriptorHeaps;
 
-	// Resource usage
+	// Resource usage (these return a null handle, address or pointer
+	// if this frame has run out of room, and the draw should be skipped)
 	D3D12_GPU_DESCRIPTOR_HANDLE FillNextConstantBufferAndGetGPUDescriptorHandle(
 		void* data,
 		unsigned int dataSizeInBytes);
-	D3D12_GPU_DESCRIPTOR_HANDLE CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptorToCopy, unsigned int numDescriptorsToCopy);
+	D3D12_GPU_VIRTUAL_ADDRESS FillNextConstantBuffer(void* data, unsigned int dataSizeInBytes);
+	void* ReserveFrameUpload(UINT64 sizeInBytes, D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress);
+
+	// Shader-visible SRVs (ranges stay put until freed)
+	DescriptorHandle AllocateSRVs(unsigned int count);
+	void FreeSRVs(const DescriptorHandle& srvs);
+	void CopySRVs(const DescriptorHandle& srvs, unsigned int firstSRV, D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptorToCopy, unsigned int numDescriptorsToCopy);
+	D3D12_GPU_DESCRIPTOR_HANDLE GetSRVGPUHandle(const DescriptorHandle& srvs, unsigned int srv = 0);
+	void CopySRVs(const DescriptorHandle& srvs, const D3D12_CPU_DESCRIPTOR_HANDLE* descriptorsToCopy, unsigned int numDescriptorsToCopy);
+	DescriptorStats GetDescriptorStats();
+
+	// Batched uploads (nestable)
+	void BeginUploadBatch();
+	void EndUploadBatch();
+
+	// Streamed uploads
+	bool IsUploadComplete(UploadTicket ticket);
+	void RecordStreamingUploads();
 
 	// Command list & basic synchronization
+	void CloseExecuteAndMoveToNextFrame();
 	void CloseExecuteAndResetCommandList();
+	UINT64 CloseAndExecuteCommandList();
 	void WaitForGPU();
 
 	// Assuming you have declared the RTV heap
@@ -84,52 +194,106 @@ private:
 	// Command list related
 	// Note: We're assuming a single command list for the entire
 	// engine at this point.  That's not always true for more
-	// complex engines but should be fine for us
+	// complex engines but should be fine for us.  It records
+	// with a different allocator each frame, so it can be reset
+	// while the GPU is still running the previous frames.
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>	commandList;
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue>			commandQueue;
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator>		commandAllocator;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> commandAllocators;
 
 	// Basic CPU/GPU synchronization
 	Microsoft::WRL::ComPtr<ID3D12Fence> waitFence;
 	HANDLE								waitFenceEvent;
-	unsigned long						waitFenceCounter;
+
+	// Which allocator is recording, and the fence values signaled
+	friend class DX12FrameQueueBackend;
+	std::unique_ptr<FrameQueueBackend> frameQueueBackend;
+	std::unique_ptr<FramePacer> framePacer;
 
 	// Maximum number of constant buffers, assuming each buffer
 	// is 256 bytes or less.  Larger buffers are fine, but will
 	// result in fewer buffers in use at any time.
-	// This is also used as the max number of CBVs possible.
-	const unsigned int maxConstantBuffers = 1000;
+	// This is also used as the max number of CBVs possible,
+	// shared by every frame the GPU hasn't finished yet.
+	const unsigned int maxConstantBuffers = 4096;
 
 	// Maximum number of texture descriptors (SRVs) we can have.
 	// Each material will have a chunk of this, plus any 
 	// non-material textures we may need for our program.
-	// Note: If we delayed the creation of this heap until 
-	//       after all textures and materials were created,
-	//       we could come up with an exact amount.  The following
-	//       constant ensures we (hopefully) never run out of room.
+	// Chunks are reused once freed, so this only needs to
+	// cover what's alive at once.
 	const unsigned int maxTextureDescriptors = 1000;
+
+	// Maximum number of loaded textures, each of which has
+	// an SRV in the CPU-side staging heap for materials to
+	// copy from
+	const unsigned int maxStagingTextureDescriptors = 1000;
 	
 	// GPU-side contant buffer upload heap
 	Microsoft::WRL::ComPtr<ID3D12Resource> cbUploadHeap;
 	UINT64 cbUploadHeapSizeInBytes;
-	UINT64 cbUploadHeapOffsetInBytes;
 	void* cbUploadHeapStartAddress;
+	std::unique_ptr<FrameRing> cbUploadRing;		// Bytes of the upload heap each frame uses
 
 	// GPU-side CBV/SRV descriptor heap
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> cbvSrvDescriptorHeap;
 	SIZE_T cbvSrvDescriptorHeapIncrementSize;
-	unsigned int cbvDescriptorOffset;
-	unsigned int srvDescriptorOffset;
+	std::unique_ptr<FrameRing> cbvDescriptorRing;	// CBV descriptors each frame uses
+	std::unique_ptr<DescriptorAllocator> srvDescriptors;	// SRVs, after all of the CBVs
+	D3D12_CPU_DESCRIPTOR_HANDLE GetSRVCPUHandle(const DescriptorHandle& srvs, unsigned int srv);
 
 	//// Assuming you have declared the RTV heap
 	//Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> rtvHeap;
 	//SIZE_T rtvDescriptorSize; // Increment size for RTV descriptor heap
 
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBufferResource(D3D12_HEAP_TYPE heapType, UINT64 sizeInBytes, D3D12_RESOURCE_STATES initialState);
 	void CreateConstantBufferUploadHeap();
 	void CreateCBVSRVDescriptorHeap();
+	bool ReserveFrameRingSpace(FrameRing& ring, UINT64 size, UINT64& offset);
+	void FinishFrameRings();
+	void WaitForFenceValue(UINT64 fenceValue);
+
+	// Streamed buffer uploads, recorded at the end of each frame
+	std::unique_ptr<UploadBackend> streamingBackend;
+	std::unique_ptr<UploadStreamer> streamer;
+
+	// Static buffers staged together and submitted at once
+	friend class DX12UploadBatchBackend;
+	std::unique_ptr<UploadBatchBackend> uploadBatchBackend;
+	std::unique_ptr<UploadBatch> uploadBatch;
+
+	// Shared buffers that static data is suballocated from
+	struct BufferHeap
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+		TlsfAllocator allocator;
+
+		explicit BufferHeap(UINT64 size) : allocator(size) {}
+	};
+
+	// A freed range the GPU may still be reading
+	struct PendingBufferFree
+	{
+		UINT64 fenceValue;
+		unsigned int heap;
+		TlsfAllocation allocation;
+	};
+
+	friend class BufferRange;
+	std::vector<std::unique_ptr<BufferHeap>> bufferHeaps;
+	std::deque<PendingBufferFree> pendingBufferFrees;
+	std::shared_ptr<BufferRange> AllocateBufferRange(UINT64 sizeInBytes);
+	void FreeBufferRange(unsigned int heap, const TlsfAllocation& allocation);
+	void ReleaseCompletedBufferRanges();
 
 	// Textures
 	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> textures;
-	std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> cpuSideTextureDescriptorHeaps;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> textureStagingHeap;
+	std::unique_ptr<DescriptorAllocator> stagingDescriptors;
+	void CreateTextureStagingHeap();
+
+	// Descriptor copies into the final heap, for DescriptorStats
+	unsigned int descriptorCopyCalls;
+	unsigned int descriptorsCopied;
 };
 
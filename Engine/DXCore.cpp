@@ -235,10 +235,14 @@ HRESULT DXCore::InitDirect3D()
 	// Set up DX12 command allocator / queue / list, 
 	// which are necessary pieces for issuing standard API calls
 	{
-		// Set up allocator
-		device->CreateCommandAllocator(
-			D3D12_COMMAND_LIST_TYPE_DIRECT,
-			IID_PPV_ARGS(commandAllocator.GetAddressOf()));
+		// Set up allocators, one for each frame the GPU may be working on
+		commandAllocators.resize(FramesInFlight);
+		for (unsigned int i = 0; i < FramesInFlight; i++)
+		{
+			device->CreateCommandAllocator(
+				D3D12_COMMAND_LIST_TYPE_DIRECT,
+				IID_PPV_ARGS(commandAllocators[i].GetAddressOf()));
+		}
 
 		// Command queue
 		D3D12_COMMAND_QUEUE_DESC qDesc = {};
@@ -250,7 +254,7 @@ HRESULT DXCore::InitDirect3D()
 		device->CreateCommandList(
 			0,								// Which physical GPU will handle these tasks?  0 for single GPU setup
 			D3D12_COMMAND_LIST_TYPE_DIRECT,	// Type of command list - direct is for standard API calls
-			commandAllocator.Get(),			// The allocator for this list
+			commandAllocators[0].Get(),		// The allocator for the first frame
 			0,								// Initial pipeline state - none for now
 			IID_PPV_ARGS(commandList.GetAddressOf()));
 	}
@@ -263,14 +267,18 @@ HRESULT DXCore::InitDirect3D()
 			device,
 			commandList,
 			commandQueue,
-			commandAllocator);
+			commandAllocators);
 	}
 
 	// Swap chain creation
 	{
 		// Create a description of how our swap chain should work
+		// Each frame in flight still owns the back buffer it's
+		// drawing to, so there must be at least one per frame
+		static_assert(numBackBuffers >= FramesInFlight, "Need a back buffer for every frame in flight");
+
 		DXGI_SWAP_CHAIN_DESC swapDesc = {};
-		swapDesc.BufferCount = 2; //numBackBuffers;
+		swapDesc.BufferCount = numBackBuffers;
 		swapDesc.BufferDesc.Width = windowWidth;
 		swapDesc.BufferDesc.Height = windowHeight;
 		swapDesc.BufferDesc.RefreshRate.Numerator = 60;
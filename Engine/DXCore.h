@@ -7,6 +7,8 @@
 #include <vector>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
+#include "DescriptorAllocator.h"
+
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d12.lib")
@@ -82,7 +84,7 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D12Device>		device;
 	Microsoft::WRL::ComPtr<IDXGISwapChain>		swapChain;
 
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator>		commandAllocator;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> commandAllocators;	// One per frame in flight
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue>			commandQueue;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>	commandList;
 
@@ -92,6 +94,7 @@ protected:
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> gBufferRTVs[4];
 	D3D12_GPU_DESCRIPTOR_HANDLE gBufferSRVs[4];
+	DescriptorHandle gBufferSRVRange = {};
 	Microsoft::WRL::ComPtr<ID3D12Resource> lightBufferRTV;
 
 	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[7]; // Pointers into the RTV desc heap
@@ -17,7 +17,7 @@ struct VertexShaderInput
 	float3 position		: POSITION;
 	float2 uv			: TEXCOORD;
 	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
+	float4 tangent		: TANGENT;
 };
 
 // Defines the output data of our vertex shader
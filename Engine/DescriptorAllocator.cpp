@@ -0,0 +1,205 @@
+#include "DescriptorAllocator.h"
+
+DescriptorAllocator::DescriptorAllocator(uint32_t capacity) :
+	capacity(capacity),
+	top(0),
+	highWater(0),
+	used(0),
+	pendingCount(0),
+	liveRanges(0),
+	freeRanges(0),
+	ranges(capacity)
+{
+	for (Range& range : ranges)
+	{
+		range.generation = 1;
+		range.count = 0;
+		range.live = false;
+		range.free = false;
+		range.freeListSlot = 0;
+		range.freeStart = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Finds a range of the given size: a freed one of exactly
+// that size, then never-used space, then part of a bigger
+// freed range.  Returns false if none of those fit.
+//
+// count - How many descriptors (at least 1)
+// handle - Receives the range
+// --------------------------------------------------------
+bool DescriptorAllocator::Allocate(uint32_t count, DescriptorHandle& handle)
+{
+	if (count == 0)
+		return false;
+
+	uint32_t index = TakeFree(count, true);
+	if (index == capacity && capacity - top >= count)
+	{
+		index = top;
+		top += count;
+		if (top > highWater)
+			highWater = top;
+	}
+	if (index == capacity)
+		index = TakeFree(count, false);
+	if (index == capacity)
+		return false;
+
+	Range& range = ranges[index];
+	range.count = count;
+	range.live = true;
+	used += count;
+	liveRanges++;
+
+	handle.index = index;
+	handle.count = count;
+	handle.generation = range.generation;
+	return true;
+}
+
+// --------------------------------------------------------
+// Retires a range right away (so its handle stops being
+// valid) but keeps its slots out of circulation until the
+// GPU has finished every frame that could be reading them
+//
+// handle - The range to free
+// fenceValue - Fence value signaled after the last use
+// --------------------------------------------------------
+bool DescriptorAllocator::Free(const DescriptorHandle& handle, uint64_t fenceValue)
+{
+	if (!IsValid(handle))
+		return false;
+
+	Range& range = ranges[handle.index];
+	range.live = false;
+	if (++range.generation == 0)
+		range.generation = 1;
+	liveRanges--;
+
+	PendingFree free = { fenceValue, handle.index };
+	pending.push_back(free);
+	pendingCount += handle.count;
+	return true;
+}
+
+// --------------------------------------------------------
+// Puts ranges whose fence value has completed back into
+// circulation, merged with any free space next to them
+// --------------------------------------------------------
+void DescriptorAllocator::ReleaseCompleted(uint64_t completedFenceValue)
+{
+	while (!pending.empty() && pending.front().fenceValue <= completedFenceValue)
+	{
+		uint32_t index = pending.front().index;
+		pending.pop_front();
+
+		pendingCount -= ranges[index].count;
+		used -= ranges[index].count;
+		AddFree(index, ranges[index].count);
+	}
+}
+
+bool DescriptorAllocator::IsValid(const DescriptorHandle& handle) const
+{
+	if (handle.generation == 0 || handle.index >= capacity)
+		return false;
+
+	const Range& range = ranges[handle.index];
+	return range.live && range.generation == handle.generation && range.count == handle.count;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::GetStats() const
+{
+	DescriptorAllocatorStats stats = {};
+	stats.capacity = capacity;
+	stats.used = used;
+	stats.pending = pendingCount;
+	stats.highWater = highWater;
+	stats.liveRanges = liveRanges;
+	stats.freeRanges = freeRanges;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Pulls a freed range of exactly count slots, or (unless
+// exactOnly) splits the smallest bigger one, putting the
+// rest back.  Returns capacity if there are none.
+// --------------------------------------------------------
+uint32_t DescriptorAllocator::TakeFree(uint32_t count, bool exactOnly)
+{
+	std::map<uint32_t, std::vector<uint32_t>>::iterator list =
+		exactOnly ? freeLists.find(count) : freeLists.lower_bound(count);
+	if (list == freeLists.end())
+		return capacity;
+
+	uint32_t found = list->first;
+	uint32_t index = list->second.back();
+	RemoveFree(index);
+
+	if (found > count)
+		AddFree(index + count, found - count);
+	return index;
+}
+
+// --------------------------------------------------------
+// Adds a free range, merged with the free ranges on either
+// side so churn doesn't leave the space in pieces too small
+// to use.  Free space that reaches the top goes back to
+// being unused.
+// --------------------------------------------------------
+void DescriptorAllocator::AddFree(uint32_t index, uint32_t count)
+{
+	uint32_t next = index + count;
+	if (next < capacity && ranges[next].free)
+	{
+		count += ranges[next].count;
+		RemoveFree(next);
+	}
+
+	// The slot before is the last of a free range if that range's start says it reaches here
+	if (index > 0)
+	{
+		uint32_t previous = ranges[index - 1].freeStart;
+		if (ranges[previous].free && previous + ranges[previous].count == index)
+		{
+			index = previous;
+			count += ranges[previous].count;
+			RemoveFree(previous);
+		}
+	}
+
+	if (index + count == top)
+	{
+		top = index;
+		return;
+	}
+
+	std::vector<uint32_t>& list = freeLists[count];
+	Range& range = ranges[index];
+	range.count = count;
+	range.live = false;
+	range.free = true;
+	range.freeListSlot = (uint32_t)list.size();
+	ranges[index + count - 1].freeStart = index;
+	list.push_back(index);
+	freeRanges++;
+}
+
+void DescriptorAllocator::RemoveFree(uint32_t index)
+{
+	Range& range = ranges[index];
+	std::map<uint32_t, std::vector<uint32_t>>::iterator list = freeLists.find(range.count);
+
+	// Move the list's last range into this one's place
+	std::vector<uint32_t>& indices = list->second;
+	indices[range.freeListSlot] = indices.back();
+	ranges[indices.back()].freeListSlot = range.freeListSlot;
+	indices.pop_back();
+	if (indices.empty())
+		freeLists.erase(list);
+
+	range.free = false;
+	freeRanges--;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+// --------------------------------------------------------
+// A range of descriptors from a DescriptorAllocator.  The
+// generation changes whenever a range is freed, so old
+// handles to reused descriptors can be told apart (and a
+// zeroed handle never refers to anything).
+// --------------------------------------------------------
+struct DescriptorHandle
+{
+	uint32_t index;			// First descriptor, from the start of the allocator's space
+	uint32_t count;
+	uint32_t generation;	// 0 for no descriptors
+};
+
+// How a DescriptorAllocator's space is used right now
+struct DescriptorAllocatorStats
+{
+	uint32_t capacity;
+	uint32_t used;			// Including ranges waiting on the GPU
+	uint32_t pending;		// Freed, but the GPU may still be reading them
+	uint32_t highWater;		// Furthest into the space ever handed out
+	size_t liveRanges;
+	size_t freeRanges;
+};
+
+// --------------------------------------------------------
+// Hands out ranges of a fixed number of descriptor slots
+// (like part of a shader-visible heap).  Freed ranges wait
+// until the GPU passes a fence value, then go on a free list
+// for their size, so the same slots come back for the same
+// kinds of things (a material's textures, a G-buffer).  A
+// range stays put while it's live, so its descriptors can
+// be indexed directly by shaders.  Freed ranges merge with
+// free neighbours, and bigger free ranges are only split
+// when nothing else fits.  Only tracks indices; the
+// descriptors themselves are up to the caller.
+// --------------------------------------------------------
+class DescriptorAllocator
+{
+public:
+	explicit DescriptorAllocator(uint32_t capacity);
+
+	bool Allocate(uint32_t count, DescriptorHandle& handle);
+
+	// Frees a range once the given fence value completes.  Returns
+	// false (and does nothing) for handles that aren't live.
+	bool Free(const DescriptorHandle& handle, uint64_t fenceValue);
+
+	// Makes ranges freed before this fence value available again
+	void ReleaseCompleted(uint64_t completedFenceValue);
+
+	bool IsValid(const DescriptorHandle& handle) const;
+	DescriptorAllocatorStats GetStats() const;
+	uint32_t GetCapacity() const { return capacity; }
+
+private:
+	// Tracked for the first slot of each range
+	struct Range
+	{
+		uint32_t generation;
+		uint32_t count;
+		bool live;
+		bool free;				// On a free list
+		uint32_t freeListSlot;	// Where on it
+		uint32_t freeStart;		// In the last slot of a free range: its first slot
+	};
+
+	struct PendingFree
+	{
+		uint64_t fenceValue;
+		uint32_t index;
+	};
+
+	uint32_t capacity;
+	uint32_t top;			// Slots from here up are unused (never handed out, or merged back)
+	uint32_t highWater;
+	uint32_t used;
+	uint32_t pendingCount;
+	size_t liveRanges;
+	size_t freeRanges;
+
+	std::vector<Range> ranges;
+	std::map<uint32_t, std::vector<uint32_t>> freeLists;	// Count -> first slots
+	std::deque<PendingFree> pending;
+
+	uint32_t TakeFree(uint32_t count, bool exactOnly);
+	void AddFree(uint32_t index, uint32_t count);
+	void RemoveFree(uint32_t index);
+};
@@ -0,0 +1,71 @@
+#include "FramePacer.h"
+
+FramePacer::FramePacer(FrameQueueBackend& backend, unsigned int framesInFlight) :
+	backend(backend),
+	frameIndex(0),
+	fenceValue(0),
+	frameFenceValues(framesInFlight > 0 ? framesInFlight : 1, 0),
+	waits(0)
+{
+}
+
+// --------------------------------------------------------
+// Submits the current frame, then moves to the next frame's
+// allocator.  The GPU may still be using that allocator from
+// framesInFlight frames ago, which is the only time this
+// waits.  Returns the fence value signaled after the frame.
+// --------------------------------------------------------
+uint64_t FramePacer::EndFrame()
+{
+	uint64_t submitted = Submit();
+	frameIndex = (frameIndex + 1) % (unsigned int)frameFenceValues.size();
+
+	if (backend.GetCompletedFenceValue() < frameFenceValues[frameIndex])
+	{
+		backend.WaitForFenceValue(frameFenceValues[frameIndex]);
+		waits++;
+	}
+
+	backend.Reset(frameIndex);
+	return submitted;
+}
+
+// --------------------------------------------------------
+// Submits without moving to the next frame (for uploads and
+// the like that need to finish right away).  The queue runs
+// in order, so waiting for this submission's fence value
+// waits for every earlier frame too.  The recorded commands
+// go first, since signaling without them would let anything
+// tagged with GetNextFenceValue() count as done before the
+// GPU even saw it.
+// --------------------------------------------------------
+uint64_t FramePacer::SubmitAndWait()
+{
+	uint64_t submitted = Submit();
+	backend.WaitForFenceValue(submitted);
+	backend.Reset(frameIndex);
+	return submitted;
+}
+
+// --------------------------------------------------------
+// Submits without moving to the next frame or waiting (for
+// uploads that only need to finish before later work on the
+// queue).  The allocator keeps its commands until the frame
+// ends and the GPU is done with all of them.
+// --------------------------------------------------------
+uint64_t FramePacer::SubmitAndContinue()
+{
+	uint64_t submitted = Submit();
+	backend.Reopen(frameIndex);
+	return submitted;
+}
+
+uint64_t FramePacer::Submit()
+{
+	backend.Execute(frameIndex);
+
+	fenceValue++;
+	backend.Signal(fenceValue);
+	frameFenceValues[frameIndex] = fenceValue;
+	return fenceValue;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// What frame pacing needs from a graphics API: one command
+// allocator per frame in flight (recorded into by a shared
+// command list), a queue to submit to, and a fence the
+// queue signals in order.  Frames are 0 to framesInFlight-1.
+// --------------------------------------------------------
+class FrameQueueBackend
+{
+public:
+	virtual ~FrameQueueBackend() {}
+
+	// Closes and submits everything recorded with a frame's allocator
+	virtual void Execute(unsigned int frame) = 0;
+
+	// Has the queue set the fence to this value once it gets here
+	virtual void Signal(uint64_t fenceValue) = 0;
+	virtual uint64_t GetCompletedFenceValue() = 0;
+	virtual void WaitForFenceValue(uint64_t fenceValue) = 0;
+
+	// Starts recording with a frame's allocator again (the GPU is done with it)
+	virtual void Reset(unsigned int frame) = 0;
+
+	// Carries on recording with a frame's allocator after a submission,
+	// without resetting it (the GPU may still be using its commands)
+	virtual void Reopen(unsigned int frame) = 0;
+};
+
+// --------------------------------------------------------
+// Lets the CPU record a frame while the GPU is still working
+// on earlier ones.  Each frame records with its own
+// allocator, and ending a frame submits it and moves on to
+// the next allocator, only waiting if the GPU hasn't
+// finished the frame that last used it.  Every submission
+// signals the next fence value, so anything the CPU writes
+// for the GPU can be tagged with GetNextFenceValue() and
+// reused once that value completes.
+// --------------------------------------------------------
+class FramePacer
+{
+public:
+	FramePacer(FrameQueueBackend& backend, unsigned int framesInFlight);
+
+	// Submits the current frame and starts the next one
+	uint64_t EndFrame();
+
+	// Submits what's been recorded and waits for the GPU to finish
+	// everything (leaving it idle), then carries on recording with
+	// the same allocator
+	uint64_t SubmitAndWait();
+
+	// Submits what's been recorded without waiting, then carries on
+	// recording with the same allocator
+	uint64_t SubmitAndContinue();
+
+	unsigned int GetFrameIndex() const { return frameIndex; }
+	unsigned int GetFramesInFlight() const { return (unsigned int)frameFenceValues.size(); }
+	uint64_t GetLastFenceValue() const { return fenceValue; }
+	uint64_t GetNextFenceValue() const { return fenceValue + 1; }
+
+	// How many times EndFrame() has had to wait on the GPU
+	size_t GetWaitCount() const { return waits; }
+
+private:
+	FrameQueueBackend& backend;
+	unsigned int frameIndex;
+	uint64_t fenceValue;					// Most recently signaled
+	std::vector<uint64_t> frameFenceValues;	// Signaled after each frame's last submission
+	size_t waits;
+
+	uint64_t Submit();
+};
@@ -0,0 +1,108 @@
+#include "FrameRing.h"
+
+#include <algorithm>
+
+FrameRing::FrameRing(uint64_t capacity) :
+	capacity(capacity),
+	head(0),
+	tail(0),
+	used(0),
+	unfinished(0)
+{
+}
+
+// --------------------------------------------------------
+// Hands out a contiguous block, skipping the rest of the
+// ring (which counts as used until it's reclaimed) if the
+// block doesn't fit before the end.  Returns false when
+// there isn't room.
+//
+// size - Space needed
+// offset - Receives where the block starts
+// --------------------------------------------------------
+bool FrameRing::Allocate(uint64_t size, uint64_t& offset)
+{
+	if (size == 0 || size > capacity || used == capacity)
+		return false;
+
+	if (head >= tail)
+	{
+		// Free space is [head, capacity) and then [0, tail)
+		if (capacity - head >= size)
+		{
+			offset = head;
+			head += size;
+			used += size;
+			unfinished += size;
+			return true;
+		}
+
+		if (tail >= size)
+		{
+			uint64_t skipped = capacity - head;
+			offset = 0;
+			head = size;
+			used += skipped + size;
+			unfinished += skipped + size;
+			return true;
+		}
+
+		return false;
+	}
+
+	// Free space is [head, tail)
+	if (tail - head >= size)
+	{
+		offset = head;
+		head += size;
+		used += size;
+		unfinished += size;
+		return true;
+	}
+
+	return false;
+}
+
+// --------------------------------------------------------
+// The biggest block Allocate() would succeed with right now
+// --------------------------------------------------------
+uint64_t FrameRing::GetLargestFreeBlock() const
+{
+	if (used == capacity)
+		return 0;
+
+	if (head >= tail)
+		return std::max(capacity - head, tail);
+
+	return tail - head;
+}
+
+void FrameRing::FinishFrame(uint64_t fenceValue)
+{
+	if (unfinished == 0)
+		return;
+
+	Retirement retirement = { fenceValue, head, unfinished };
+	retirements.push_back(retirement);
+	unfinished = 0;
+}
+
+void FrameRing::Reclaim(uint64_t completedFenceValue)
+{
+	while (!retirements.empty() && retirements.front().fenceValue <= completedFenceValue)
+	{
+		tail = retirements.front().end;
+		used -= retirements.front().size;
+		retirements.pop_front();
+	}
+
+	// Start over at the beginning whenever the ring empties out,
+	// so big blocks don't have to wrap
+	if (used == 0)
+		head = tail = 0;
+}
+
+uint64_t FrameRing::GetOldestFenceValue() const
+{
+	return retirements.empty() ? 0 : retirements.front().fenceValue;
+}
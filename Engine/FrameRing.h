@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// --------------------------------------------------------
+// Fixed-size ring of per-frame space (bytes of staging or
+// constant buffer memory, or descriptors).  Space is handed
+// out in order and comes back a whole frame at a time, once
+// the fence value that frame was tagged with has completed.
+// Offsets are relative to the start of the ring, in the
+// same units as the sizes.
+// --------------------------------------------------------
+class FrameRing
+{
+public:
+	explicit FrameRing(uint64_t capacity);
+
+	bool Allocate(uint64_t size, uint64_t& offset);
+	uint64_t GetLargestFreeBlock() const;
+
+	// Allocates, waiting for the oldest frames still in use (one at a
+	// time) until there's room.  Fails rather than overwriting anything
+	// when the frame being recorded has filled the ring by itself.
+	template<typename WaitForFence>
+	bool AllocateWaiting(uint64_t size, uint64_t completedFenceValue, WaitForFence waitForFence, uint64_t& offset);
+
+	// Tags everything allocated since the last call with a fence value
+	void FinishFrame(uint64_t fenceValue);
+
+	// Frees every frame whose fence value has completed
+	void Reclaim(uint64_t completedFenceValue);
+
+	// Fence value to wait for to free the oldest frame still in use
+	// (0 if nothing tagged is in use)
+	uint64_t GetOldestFenceValue() const;
+
+	uint64_t GetCapacity() const { return capacity; }
+	uint64_t GetUsed() const { return used; }
+
+private:
+	struct Retirement
+	{
+		uint64_t fenceValue;
+		uint64_t end;		// Where the ring's tail moves to once it completes
+		uint64_t size;		// Including any space skipped to wrap around
+	};
+
+	uint64_t capacity;
+	uint64_t head;			// Next allocation starts here
+	uint64_t tail;			// Oldest live allocation starts here
+	uint64_t used;
+	uint64_t unfinished;	// Allocated since the last FinishFrame()
+	std::deque<Retirement> retirements;
+};
+
+// --------------------------------------------------------
+// The only space left belongs to the frame being recorded
+// once nothing tagged is in use, and none of that can be
+// reused until it's been submitted, so that's a failure.
+//
+// size - Space needed
+// completedFenceValue - The last fence value the GPU reached
+// waitForFence - Called with a fence value to wait for
+// offset - Receives where the block starts
+// --------------------------------------------------------
+template<typename WaitForFence>
+bool FrameRing::AllocateWaiting(uint64_t size, uint64_t completedFenceValue, WaitForFence waitForFence, uint64_t& offset)
+{
+	Reclaim(completedFenceValue);
+	while (!Allocate(size, offset))
+	{
+		uint64_t oldestFenceValue = GetOldestFenceValue();
+		if (oldestFenceValue == 0)
+			return false;
+
+		waitForFence(oldestFenceValue);
+		Reclaim(oldestFenceValue);
+	}
+	return true;
+}
@@ -1,12 +1,5 @@
 #include "Lighting.hlsli"
 
-// Data that can change per material
-cbuffer perMaterial : register(b1)
-{
-    // Surface color
-    float4 Color;
-};
-
 // Defines the input to this pixel shader
 // - Should match the output of our corresponding vertex shader
 struct VertexToPixel
@@ -14,8 +7,9 @@ struct VertexToPixel
     float4 screenPosition : SV_POSITION;
     float2 uv : TEXCOORD;
     float3 normal : NORMAL;
-    float3 tangent : TANGENT;
+    float4 tangent : TANGENT;
     float3 worldPos        : POSITION;
+    float4 color : COLOR;   // Surface color of the object
 };
 
 struct GBuffer
@@ -29,8 +23,7 @@ struct GBuffer
 // Texture-related variables
 Texture2D AlbedoTexture : register(t0);
 Texture2D NormalTexture : register(t1);
-Texture2D RoughnessTexture : register(t2);
-Texture2D MetalTexture : register(t3);
+Texture2D RoughnessMetalTexture : register(t2);	// Packed in red and green
 
 SamplerState BasicSampler : register(s0);
 
@@ -39,16 +32,17 @@ GBuffer main(VertexToPixel input)
 {
     // Always re-normalize interpolated direction vectors
     input.normal = normalize(input.normal);
-    input.tangent = normalize(input.tangent);
+    input.tangent.xyz = normalize(input.tangent.xyz);
 
     // Sample various textures
     input.normal = NormalMapping(NormalTexture, BasicSampler, input.uv, input.normal, input.tangent);
-    float roughness = RoughnessTexture.Sample(BasicSampler, input.uv).r;
-    float metal = MetalTexture.Sample(BasicSampler, input.uv).r;
+    float2 roughnessMetal = RoughnessMetalTexture.Sample(BasicSampler, input.uv).rg;
+    float roughness = roughnessMetal.r;
+    float metal = roughnessMetal.g;
 
     // Gamma correct the texture back to linear space and apply the color tint
     float3 surfaceColor = AlbedoTexture.Sample(BasicSampler, input.uv).rgb;
-    surfaceColor = pow(surfaceColor, 2.2) * Color.rgb;
+    surfaceColor = pow(surfaceColor, 2.2) * input.color.rgb;
 
     // Linearize the depth value
     float linearDepth = input.screenPosition.z / input.screenPosition.w;
@@ -86,7 +86,12 @@ void Game::Init()
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
 	CreateRootSigAndPipelineState();
+
+	// Anything loaded straight away shares one upload submission
+	DX12Helper::GetInstance().BeginUploadBatch();
 	CreateBasicGeometry();
+	DX12Helper::GetInstance().EndUploadBatch();
+
 	GenerateLights();
 
 	camera = std::make_shared<Camera>(
@@ -168,9 +173,9 @@ void Game::CreateRootSigAndPipelineState()
 		inputElements[2].SemanticName = "NORMAL";					// Match our vertex shader input!
 		inputElements[2].SemanticIndex = 0;							// This is the 0th normal (there could be more)
 
-		// Set up the fourth element - a tangent, which is 2 more float values
+		// Set up the fourth element - a tangent plus its bitangent sign, which is 4 more float values
 		inputElements[3].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;	// After the previous element
-		inputElements[3].Format = DXGI_FORMAT_R32G32B32_FLOAT;		// 3x 32-bit floats
+		inputElements[3].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;	// 4x 32-bit floats
 		inputElements[3].SemanticName = "TANGENT";					// Match our vertex shader input!
 		inputElements[3].SemanticIndex = 0;							// This is the 0th tangent (there could be more)
 	}
@@ -179,51 +184,43 @@ void Game::CreateRootSigAndPipelineState()
 	// Root Signature for GBuffer
 	// --------------------------------------------
 	{
-		// Describe the range of CBVs needed for the vertex shader
-		D3D12_DESCRIPTOR_RANGE cbvRangeVS = {};
-		cbvRangeVS.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-		cbvRangeVS.NumDescriptors = 1;
-		cbvRangeVS.BaseShaderRegister = 0;
-		cbvRangeVS.RegisterSpace = 0;
-		cbvRangeVS.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-		// Describe the range of CBVs needed for the G-buffer pixel shader
-		D3D12_DESCRIPTOR_RANGE cbvRangeGBufferPS = {};
-		cbvRangeGBufferPS.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-		cbvRangeGBufferPS.NumDescriptors = 1;
-		cbvRangeGBufferPS.BaseShaderRegister = 1;  // Assuming the G-buffer CBV is registered at b1
-		cbvRangeGBufferPS.RegisterSpace = 0;
-		cbvRangeGBufferPS.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
 		// Create a range of SRV's for textures
 		D3D12_DESCRIPTOR_RANGE srvRange = {};
 		srvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		srvRange.NumDescriptors = 4;		// Set to max number of textures at once (match pixel shader!)
+		srvRange.NumDescriptors = MaterialTextureSlotCount;	// Set to max number of textures at once (match pixel shader!)
 		srvRange.BaseShaderRegister = 0;	// Starts at s0 (match pixel shader!)
 		srvRange.RegisterSpace = 0;
 		srvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
 		// Create the root parameters
-		D3D12_ROOT_PARAMETER rootParams[3] = {};
+		// Note: Per-frame and per-object data are bound straight from the
+		//       upload heap (no descriptors), and each draw only sets its ID
+		D3D12_ROOT_PARAMETER rootParams[4] = {};
 
-		// CBV table param for vertex shader
-		rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		// Root CBV for the vertex shader's per-frame data (b0)
+		rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
 		rootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
-		rootParams[0].DescriptorTable.NumDescriptorRanges = 1;
-		rootParams[0].DescriptorTable.pDescriptorRanges = &cbvRangeVS;
+		rootParams[0].Descriptor.ShaderRegister = 0;
+		rootParams[0].Descriptor.RegisterSpace = 0;
 
+		// Root SRV for the structured buffer of per-object data (t0, space1)
+		rootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		rootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+		rootParams[1].Descriptor.ShaderRegister = 0;
+		rootParams[1].Descriptor.RegisterSpace = 1;
 
-		// CBV table param for G-buffer pixel shader
-		rootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		rootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-		rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
-		rootParams[1].DescriptorTable.pDescriptorRanges = &cbvRangeGBufferPS;
+		// Root constant for the draw ID (b1)
+		rootParams[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		rootParams[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+		rootParams[2].Constants.ShaderRegister = 1;
+		rootParams[2].Constants.RegisterSpace = 0;
+		rootParams[2].Constants.Num32BitValues = 1;
 
 		// SRV table param
-		rootParams[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		rootParams[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-		rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
-		rootParams[2].DescriptorTable.pDescriptorRanges = &srvRange;
+		rootParams[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		rootParams[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
+		rootParams[3].DescriptorTable.pDescriptorRanges = &srvRange;
 
 		// Create a single static sampler (available to all pixel shaders at the same slot)
 		// Note: This is in lieu of having materials have their own samplers for this demo
@@ -649,24 +646,57 @@ void Game::CreateRootSigAndPipelineState()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	// Quick macro to simplify texture loading lines below
-#define LoadTexture(x) DX12Helper::GetInstance().LoadTexture(FixPath(x).c_str())
-
-	// Load textures
-	D3D12_CPU_DESCRIPTOR_HANDLE cobblestoneAlbedo = LoadTexture(L"../../Assets/Textures/cobblestone_albedo.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE cobblestoneNormals = LoadTexture(L"../../Assets/Textures/cobblestone_normals.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE cobblestoneRoughness = LoadTexture(L"../../Assets/Textures/cobblestone_roughness.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE cobblestoneMetal = LoadTexture(L"../../Assets/Textures/cobblestone_metal.png");
-
-	D3D12_CPU_DESCRIPTOR_HANDLE bronzeAlbedo = LoadTexture(L"../../Assets/Textures/Sponza/Sponza_Curtain_Red_diffuse.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE bronzeNormals = LoadTexture(L"../../Assets/Textures/Sponza/Sponza_Curtain_normal.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE bronzeRoughness = LoadTexture(L"../../Assets/Textures/Sponza/Sponza_Curtain_roughness.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE bronzeMetal = LoadTexture(L"../../Assets/Textures/Sponza/ChainTexture_Metallic.png");
+	// Load every material's textures at once (decoded in parallel and
+	// uploaded together), one per slot in slot order: albedo, normals,
+	// then a roughness map and a metal map packed together.  Loading
+	// them in order keeps each material's SRVs side by side, so they
+	// copy in one go.
+	const TextureSource<wchar_t> textureFiles[] = {
+		{ L"../../Assets/Textures/cobblestone_albedo.png" },
+		{ L"../../Assets/Textures/cobblestone_normals.png" },
+		{ L"../../Assets/Textures/cobblestone_roughness.png", L"../../Assets/Textures/cobblestone_metal.png" },
+
+		{ L"../../Assets/Textures/Sponza/Sponza_Curtain_Red_diffuse.png" },
+		{ L"../../Assets/Textures/Sponza/Sponza_Curtain_normal.png" },
+		{ L"../../Assets/Textures/Sponza/Sponza_Curtain_roughness.png", L"../../Assets/Textures/Sponza/ChainTexture_Metallic.png" },
+
+		{ L"../../Assets/Textures/Sponza/VasePlant_diffuse.png" },
+		{ L"../../Assets/Textures/Sponza/VasePlant_normal.png" },
+		{ L"../../Assets/Textures/Sponza/VasePlant_roughness.png", L"../../Assets/Textures/Sponza/Dielectric_metallic.png" } };
+	const unsigned int texturesPerMaterial = MaterialTextureSlotCount;
+	const unsigned int textureCount = ARRAYSIZE(textureFiles);
+
+	std::wstring texturePaths[textureCount][2];
+	TextureSource<wchar_t> textureSources[textureCount];
+	for (unsigned int i = 0; i < textureCount; i++)
+	{
+		texturePaths[i][0] = FixPath(textureFiles[i].file);
+		textureSources[i].file = texturePaths[i][0].c_str();
+		textureSources[i].metal = 0;
+		if (textureFiles[i].metal)
+		{
+			texturePaths[i][1] = FixPath(textureFiles[i].metal);
+			textureSources[i].metal = texturePaths[i][1].c_str();
+		}
+	}
 
-	D3D12_CPU_DESCRIPTOR_HANDLE scratchedAlbedo = LoadTexture(L"../../Assets/Textures/Sponza/VasePlant_diffuse.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE scratchedNormals = LoadTexture(L"../../Assets/Textures/Sponza/VasePlant_normal.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE scratchedRoughness = LoadTexture(L"../../Assets/Textures/Sponza/VasePlant_roughness.png");
-	D3D12_CPU_DESCRIPTOR_HANDLE scratchedMetal = LoadTexture(L"../../Assets/Textures/Sponza/Dielectric_metallic.png");
+	D3D12_CPU_DESCRIPTOR_HANDLE textureSRVs[textureCount];
+	TextureLoadStats textureStats = DX12Helper::GetInstance().LoadTextures(textureSources, textureCount, textureSRVs);
+	printf("Loaded %u of %u textures in %.2f ms (%zu cached, decode %.2f ms, mips %.2f ms, compress %.2f ms over %u threads, %zu through WIC)\n",
+		textureStats.loaded,
+		textureCount,
+		textureStats.cook.totalMilliseconds,
+		textureStats.cook.cacheHits,
+		textureStats.cook.decodeMilliseconds,
+		textureStats.cook.mipMilliseconds,
+		textureStats.cook.compressMilliseconds,
+		textureStats.cook.threads,
+		textureStats.cook.failed);
+	if (textureStats.outOfSlots > 0 || textureStats.failed > 0)
+		printf("%u textures failed to load and %u found no staging descriptor\n", textureStats.failed, textureStats.outOfSlots);
+	const D3D12_CPU_DESCRIPTOR_HANDLE* cobblestoneTextures = textureSRVs;
+	const D3D12_CPU_DESCRIPTOR_HANDLE* bronzeTextures = textureSRVs + texturesPerMaterial;
+	const D3D12_CPU_DESCRIPTOR_HANDLE* scratchedTextures = textureSRVs + texturesPerMaterial * 2;
 
 	// During initialization
 	gBufferRTVs[0] = CreateGBufferTexture(device.Get(), windowWidth, windowHeight, DXGI_FORMAT_R8G8B8A8_UNORM, 2);
@@ -674,10 +704,13 @@ void Game::CreateBasicGeometry()
 	gBufferRTVs[2] = CreateGBufferTexture(device.Get(), windowWidth, windowHeight, DXGI_FORMAT_R32_FLOAT, 4);
 	gBufferRTVs[3] = CreateGBufferTexture(device.Get(), windowWidth, windowHeight, DXGI_FORMAT_R8G8B8A8_UNORM, 5);
 
-	gBufferSRVs[0] = DX12Helper::GetInstance().CreateGBufferSRV(gBufferRTVs[0], DXGI_FORMAT_R8G8B8A8_UNORM);
-	gBufferSRVs[1] = DX12Helper::GetInstance().CreateGBufferSRV(gBufferRTVs[1], DXGI_FORMAT_R8G8B8A8_UNORM); 
-	gBufferSRVs[2] = DX12Helper::GetInstance().CreateGBufferSRV(gBufferRTVs[2], DXGI_FORMAT_R32_FLOAT);  
-	gBufferSRVs[3] = DX12Helper::GetInstance().CreateGBufferSRV(gBufferRTVs[3], DXGI_FORMAT_R8G8B8A8_UNORM);  
+	// The lighting passes read all four as one table, so their SRVs share a range
+	// (and any previous G-buffer's range goes back for reuse)
+	DXGI_FORMAT gBufferFormats[4] = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R8G8B8A8_UNORM };
+	DX12Helper::GetInstance().FreeSRVs(gBufferSRVRange);
+	gBufferSRVRange = DX12Helper::GetInstance().CreateGBufferSRVs(gBufferRTVs, gBufferFormats, 4);
+	for (unsigned int i = 0; i < 4; i++)
+		gBufferSRVs[i] = DX12Helper::GetInstance().GetSRVGPUHandle(gBufferSRVRange, i);
 
 	lightBufferRTV = CreateLightingTexture(device.Get(), windowWidth, windowHeight, DXGI_FORMAT_R8G8B8A8_UNORM, 6);
 
@@ -685,33 +718,27 @@ void Game::CreateBasicGeometry()
 	// Note: Samplers are handled by a single static sampler in the
 	// root signature for this demo, rather than per-material
 	cobbleMat = std::make_shared<Material>(pipelineStateGBuffer, XMFLOAT3(1, 1, 1));
-	cobbleMat->AddTexture(cobblestoneAlbedo, 0);
-	cobbleMat->AddTexture(cobblestoneNormals, 1);
-	cobbleMat->AddTexture(cobblestoneRoughness, 2);
-	cobbleMat->AddTexture(cobblestoneMetal, 3);
+	for (unsigned int slot = 0; slot < texturesPerMaterial; slot++)
+		cobbleMat->AddTexture(cobblestoneTextures[slot], slot);
 	cobbleMat->FinalizeTextures();
 
 	bronzeMat = std::make_shared<Material>(pipelineStateGBuffer, XMFLOAT3(1, 1, 1));
-	bronzeMat->AddTexture(bronzeAlbedo, 0);
-	bronzeMat->AddTexture(bronzeNormals, 1);
-	bronzeMat->AddTexture(bronzeRoughness, 2);
-	bronzeMat->AddTexture(bronzeMetal, 3);
+	for (unsigned int slot = 0; slot < texturesPerMaterial; slot++)
+		bronzeMat->AddTexture(bronzeTextures[slot], slot);
 	bronzeMat->FinalizeTextures();
 
 	scratchedMat = std::make_shared<Material>(pipelineStateGBuffer, XMFLOAT3(1, 1, 1));
-	scratchedMat->AddTexture(scratchedAlbedo, 0);
-	scratchedMat->AddTexture(scratchedNormals, 1);
-	scratchedMat->AddTexture(scratchedRoughness, 2);
-	scratchedMat->AddTexture(scratchedMetal, 3);
+	for (unsigned int slot = 0; slot < texturesPerMaterial; slot++)
+		scratchedMat->AddTexture(scratchedTextures[slot], slot);
 	scratchedMat->FinalizeTextures();
 
-	// Load meshes
-	std::shared_ptr<Mesh> floor		= std::make_shared<Mesh>(FixPath(L"../../Assets/Models/Sponza/Floor.obj").c_str());
-	std::shared_ptr<Mesh> sphere	= std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphereScaled.obj").c_str());
-	std::shared_ptr<Mesh> sphere2 = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str());
-	std::shared_ptr<Mesh> helix		= std::make_shared<Mesh>(FixPath(L"../../Assets/Models/helix.obj").c_str());
-	std::shared_ptr<Mesh> torus		= std::make_shared<Mesh>(FixPath(L"../../Assets/Models/torus.obj").c_str());
-	std::shared_ptr<Mesh> cylinder	= std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cylinder.obj").c_str());
+	// Load meshes (in the background, and only once per model)
+	std::shared_ptr<Mesh> floor		= meshes.Load(FixPath(L"../../Assets/Models/Sponza/Floor.obj"));
+	std::shared_ptr<Mesh> sphere	= meshes.Load(FixPath(L"../../Assets/Models/sphereScaled.obj"));
+	std::shared_ptr<Mesh> sphere2	= meshes.Load(FixPath(L"../../Assets/Models/sphere.obj"));
+	std::shared_ptr<Mesh> helix		= meshes.Load(FixPath(L"../../Assets/Models/helix.obj"));
+	std::shared_ptr<Mesh> torus		= meshes.Load(FixPath(L"../../Assets/Models/torus.obj"));
+	std::shared_ptr<Mesh> cylinder	= meshes.Load(FixPath(L"../../Assets/Models/cylinder.obj"));
 
 	//// Create entities
 	std::shared_ptr<GameEntity> entityPlane = std::make_shared<GameEntity>(floor, bronzeMat);
@@ -720,7 +747,22 @@ void Game::CreateBasicGeometry()
 	std::shared_ptr<GameEntity> entitySphere = std::make_shared<GameEntity>(sphere, cobbleMat);
 	entitySphere->GetTransform()->SetPosition(0.0f, 0.0f, 100.0f);
 
-	sphere3 = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str());
+	sphere3 = meshes.Load(FixPath(L"../../Assets/Models/sphere.obj"));
+
+	printf("Mesh registry: %zu unique meshes (%u shared by path, %u by contents)\n",
+		meshes.GetMeshCount(),
+		meshes.GetPathHits(),
+		meshes.GetContentHits());
+
+	DescriptorStats descriptors = DX12Helper::GetInstance().GetDescriptorStats();
+	printf("Texture descriptors: %u of %u staged, %u ranges using %u of %u SRVs, %u copies for %u descriptors\n",
+		descriptors.stagingDescriptors,
+		descriptors.stagingCapacity,
+		descriptors.srvRanges,
+		descriptors.srvsUsed,
+		descriptors.srvCapacity,
+		descriptors.copyCalls,
+		descriptors.descriptorsCopied);
 
 	// Add to list
 	staticEntities.push_back(entityPlane);
@@ -840,6 +882,9 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Grab the helper
 	DX12Helper& dx12Helper = DX12Helper::GetInstance();
 
+	// Streamed mesh data goes first, so it finishes along with this frame
+	dx12Helper.RecordStreamingUploads();
+
 	// Clearing the render target
 	{
 		for (int i = 0; i < 4; i++)
@@ -957,12 +1002,10 @@ void Game::Draw(float deltaTime, float totalTime)
 		commandList->ResourceBarrier(1, &barrier);
 
 		// Must occur BEFORE present
-		// Note: Resetting the allocator every frame requires us to sync the CPU & GPU,
-		//       since we cannot reset the allocator if its command list is executing.
-		//       This is a pretty big performance hit, as we can't proceed until the GPU
-		//       is totally done.  A better solution would be to have several allocators
-		//       and command lists, and rotate through them with each successive frame.
-		dx12Helper.CloseExecuteAndResetCommandList();
+		// Note: Each frame records with its own allocator, so this only waits
+		//       if the GPU is still running the frame that last used the next one,
+		//       and present doesn't have to wait for the GPU to finish this frame.
+		dx12Helper.CloseExecuteAndMoveToNextFrame();
 
 		// Present the current back buffer
 		bool vsyncNecessary = vsync || !deviceSupportsTearing || isFullscreen;
@@ -973,7 +1016,7 @@ void Game::Draw(float deltaTime, float totalTime)
 		// Figure out which buffer is next
 		currentSwapBuffer++;
 
-		if (currentSwapBuffer >= 2)
+		if (currentSwapBuffer >= numBackBuffers)
 			currentSwapBuffer = 0;
 
 		currentGBufferCount++;
@@ -985,131 +1028,109 @@ void Game::Draw(float deltaTime, float totalTime)
 
 void Game::RenderGBuffer()
 {
-	// Loop through the meshes
-	{
-		
-
-		for (auto& e : dynamicEntities)
-		{
-			e.get()->SetMaterial(bronzeMat);
-			// Grab the material for this entity
-			std::shared_ptr<Material> mat = scratchedMat;
-
-			// Set the pipeline state for this material
-			commandList->SetPipelineState(mat->GetPipelineState().Get());
-
-			// Set up the vertex shader data we intend to use for drawing this entity
-			{
-				VertexShaderExternalData vsData = {};
-				vsData.world = e->GetTransform()->GetWorldMatrix();
-				vsData.worldInverseTranspose = e->GetTransform()->GetWorldInverseTransposeMatrix();
-				vsData.view = camera->GetView();
-				vsData.projection = camera->GetProjection();
-
-				// Send this to a chunk of the constant buffer heap
-				// and grab the GPU handle for it so we can set it for this draw
-				D3D12_GPU_DESCRIPTOR_HANDLE cbHandleVS = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
-					(void*)(&vsData), sizeof(VertexShaderExternalData));
-
-				// Set this constant buffer handle
-				// Note: This assumes that descriptor table 0 is the
-				//       place to put this particular descriptor.  This
-				//       is based on how we set up our root signature.
-				commandList->SetGraphicsRootDescriptorTable(0, cbHandleVS);
-			}
-
-			GBufferPixelShaderExternalData psData = {};
-			psData.color = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
+	DX12Helper& dx12Helper = DX12Helper::GetInstance();
 
-			D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePS = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
-				(void*)(&psData), sizeof(GBufferPixelShaderExternalData));
+	// The camera is the same for every object, so upload it once
+	GBufferPerFrameData frameData = {};
+	frameData.view = camera->GetView();
+	frameData.projection = camera->GetProjection();
+	D3D12_GPU_VIRTUAL_ADDRESS frameDataAddress = dx12Helper.FillNextConstantBuffer((void*)(&frameData), sizeof(GBufferPerFrameData));
 
-			//// Set this constant buffer handle
-			//// Note: This assumes that descriptor table 1 is the
-			////       place to put this particular descriptor.  This
-			////       is based on how we set up our root signature.
-			commandList->SetGraphicsRootDescriptorTable(1, cbHandlePS);
+	// Every object's data goes in one structured buffer this frame, written
+	// straight into upload memory, and each draw just passes its index in it
+	size_t maxObjects = dynamicEntities.size() + staticEntities.size();
+	D3D12_GPU_VIRTUAL_ADDRESS objectsAddress = 0;
+	GBufferObjectData* objects = (GBufferObjectData*)dx12Helper.ReserveFrameUpload(
+		maxObjects * sizeof(GBufferObjectData), objectsAddress);
 
-			// Set the G-buffer textures as shader resources
-			// Set the SRV descriptor handle for this material's textures
-			// Note: This assumes that descriptor table 2 is for textures (as per our root sig)
-			commandList->SetGraphicsRootDescriptorTable(2, mat->GetFinalGPUHandleForTextures());
+	// Without room for this frame's data there's nothing safe to draw with
+	if (frameDataAddress == 0 || !objects)
+		return;
 
-			// Grab the mesh and its buffer views
-			std::shared_ptr<Mesh> mesh = e->GetMesh();
-			D3D12_VERTEX_BUFFER_VIEW vbv = mesh->GetVB();
-			D3D12_INDEX_BUFFER_VIEW  ibv = mesh->GetIB();
+	commandList->SetGraphicsRootConstantBufferView(0, frameDataAddress);
+	commandList->SetGraphicsRootShaderResourceView(1, objectsAddress);
+	unsigned int drawID = 0;
 
-			// Set the geometry
-			commandList->IASetVertexBuffers(0, 1, &vbv);
-			commandList->IASetIndexBuffer(&ibv);
+	auto drawEntity = [&](GameEntity* e, const std::shared_ptr<Material>& mat)
+	{
+		// A material whose textures couldn't be finalized has nothing to bind
+		D3D12_GPU_DESCRIPTOR_HANDLE textures = mat->GetFinalGPUHandleForTextures();
+		if (textures.ptr == 0)
+			return;
+
+		// Set the pipeline state for this material
+		commandList->SetPipelineState(mat->GetPipelineState().Get());
+
+		// Fill in this object's data (upload memory is write-combined, so write only)
+		GBufferObjectData& object = objects[drawID];
+		object.world = e->GetTransform()->GetWorldMatrix();
+		object.worldInverseTranspose = e->GetTransform()->GetWorldInverseTransposeMatrix();
+		object.color = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
+		commandList->SetGraphicsRoot32BitConstant(2, drawID, 0);
+		drawID++;
+
+		// Set the G-buffer textures as shader resources
+		// Set the SRV descriptor handle for this material's textures
+		// Note: This assumes that root param 3 is for textures (as per our root sig)
+		commandList->SetGraphicsRootDescriptorTable(3, textures);
+
+		// Grab the mesh and its buffer views
+		std::shared_ptr<Mesh> mesh = e->GetMesh();
+		D3D12_VERTEX_BUFFER_VIEW vbv = mesh->GetVB();
+		D3D12_INDEX_BUFFER_VIEW  ibv = mesh->GetIB();
+
+		// Set the geometry
+		commandList->IASetVertexBuffers(0, 1, &vbv);
+		commandList->IASetIndexBuffer(&ibv);
+
+		// Draw the level of detail that suits its size on screen
+		const MeshLod& lod = mesh->SelectLod(GetPixelsPerUnit(e));
+		commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.firstIndex, 0, 0);
+	};
 
-			// Draw
-			commandList->DrawIndexedInstanced(mesh->GetIndexCount(), 1, 0, 0, 0);
+	// Loop through the meshes
+	{
+		for (auto& e : dynamicEntities)
+		{
+			// Meshes still streaming in can't be drawn yet
+			if (!e->GetMesh()->IsReady())
+				continue;
 
+			e.get()->SetMaterial(bronzeMat);
+			drawEntity(e.get(), scratchedMat);
 		}
 
 		for (auto& e : staticEntities)
 		{
-			// Grab the material for this entity
-			std::shared_ptr<Material> mat = e->GetMaterial();
-
-			// Set the pipeline state for this material
-			commandList->SetPipelineState(mat->GetPipelineState().Get());
-
-			// Set up the vertex shader data we intend to use for drawing this entity
-			{
-				VertexShaderExternalData vsData = {};
-				vsData.world = e->GetTransform()->GetWorldMatrix();
-				vsData.worldInverseTranspose = e->GetTransform()->GetWorldInverseTransposeMatrix();
-				vsData.view = camera->GetView();
-				vsData.projection = camera->GetProjection();
-
-				// Send this to a chunk of the constant buffer heap
-				// and grab the GPU handle for it so we can set it for this draw
-				D3D12_GPU_DESCRIPTOR_HANDLE cbHandleVS = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
-					(void*)(&vsData), sizeof(VertexShaderExternalData));
-
-				// Set this constant buffer handle
-				// Note: This assumes that descriptor table 0 is the
-				//       place to put this particular descriptor.  This
-				//       is based on how we set up our root signature.
-				commandList->SetGraphicsRootDescriptorTable(0, cbHandleVS);
-			}
-
-			GBufferPixelShaderExternalData psData = {};
-			psData.color = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
-
-			D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePS = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
-				(void*)(&psData), sizeof(GBufferPixelShaderExternalData));
-
-			//// Set this constant buffer handle
-			//// Note: This assumes that descriptor table 1 is the
-			////       place to put this particular descriptor.  This
-			////       is based on how we set up our root signature.
-			commandList->SetGraphicsRootDescriptorTable(1, cbHandlePS);
-
-			// Set the G-buffer textures as shader resources
-			// Set the SRV descriptor handle for this material's textures
-			// Note: This assumes that descriptor table 2 is for textures (as per our root sig)
-			commandList->SetGraphicsRootDescriptorTable(2, mat->GetFinalGPUHandleForTextures());
-
-			// Grab the mesh and its buffer views
-			std::shared_ptr<Mesh> mesh = e->GetMesh();
-			D3D12_VERTEX_BUFFER_VIEW vbv = mesh->GetVB();
-			D3D12_INDEX_BUFFER_VIEW  ibv = mesh->GetIB();
-
-			// Set the geometry
-			commandList->IASetVertexBuffers(0, 1, &vbv);
-			commandList->IASetIndexBuffer(&ibv);
-
-			// Draw
-			commandList->DrawIndexedInstanced(mesh->GetIndexCount(), 1, 0, 0, 0);
+			// Meshes still streaming in can't be drawn yet
+			if (!e->GetMesh()->IsReady())
+				continue;
 
+			drawEntity(e.get(), e->GetMaterial());
 		}
 	}
 }
 
+// --------------------------------------------------------
+// Roughly how many pixels one of an entity's object space
+// units covers on screen, for picking levels of detail
+// --------------------------------------------------------
+float Game::GetPixelsPerUnit(GameEntity* entity)
+{
+	XMFLOAT3 position = entity->GetWorldBounds().center;
+	XMFLOAT3 scale = entity->GetTransform()->GetScale();
+	XMFLOAT3 cameraPosition = camera->GetTransform()->GetPosition();
+
+	XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&position), XMLoadFloat3(&cameraPosition));
+	float distance = XMVectorGetX(XMVector3Length(offset));
+	distance = max(distance, camera->GetNearClip());
+
+	// Height of the view at that distance, spread over the window's pixels
+	float viewHeight = 2.0f * distance * tanf(camera->GetFieldOfView() * 0.5f);
+	float maxScale = max(fabsf(scale.x), max(fabsf(scale.y), fabsf(scale.z)));
+	return maxScale * windowHeight / viewHeight;
+}
+
 void Game::RenderLighting()
 {
 	commandList->SetGraphicsRootSignature(rootSignatureLighting.Get());
@@ -1138,7 +1159,6 @@ void Game::RenderLighting()
 
 			D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePS = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
 				(void*)(&psData), sizeof(PerFrameData));
-			commandList->SetGraphicsRootDescriptorTable(0, cbHandlePS);
 
 			PerLightData perLightData = {};
 			perLightData.ThisLight = light;
@@ -1146,6 +1166,11 @@ void Game::RenderLighting()
 			D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePerLight = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
 				(void*)(&perLightData), sizeof(PerLightData));
 
+			// Skip the light if this frame ran out of constant buffer space
+			if (cbHandlePS.ptr == 0 || cbHandlePerLight.ptr == 0)
+				continue;
+
+			commandList->SetGraphicsRootDescriptorTable(0, cbHandlePS);
 			commandList->SetGraphicsRootDescriptorTable(1, cbHandlePerLight);
 
 			commandList->SetGraphicsRootDescriptorTable(2, gBufferSRVs[0]);
@@ -1174,7 +1199,6 @@ void Game::RenderLighting()
 
 			D3D12_GPU_DESCRIPTOR_HANDLE cbHandleVS_1 = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
 				(void*)(&vsData), sizeof(VertexShaderPointLightData));
-			commandList->SetGraphicsRootDescriptorTable(0, cbHandleVS_1);
 
 			if (!forwardDest) {
 				// Move towards the target position
@@ -1214,7 +1238,6 @@ void Game::RenderLighting()
 
 			D3D12_GPU_DESCRIPTOR_HANDLE cbHandleVS_2 = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
 				(void*)(&vsData_2), sizeof(PerLight));
-			commandList->SetGraphicsRootDescriptorTable(1, cbHandleVS_2);
 
 			PerFramePointLight psData = {};
 			psData.CameraPosition = camera->GetTransform()->GetPosition();
@@ -1224,7 +1247,6 @@ void Game::RenderLighting()
 
 			D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePS = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
 				(void*)(&psData), sizeof(PerFramePointLight));
-			commandList->SetGraphicsRootDescriptorTable(2, cbHandlePS);
 
 			PerLightData perLightData = {};
 			perLightData.ThisLight = light;
@@ -1232,21 +1254,29 @@ void Game::RenderLighting()
 			D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePerLight = DX12Helper::GetInstance().FillNextConstantBufferAndGetGPUDescriptorHandle(
 				(void*)(&perLightData), sizeof(PerLightData));
 
+			// Skip the light if this frame ran out of constant buffer space
+			if (cbHandleVS_1.ptr == 0 || cbHandleVS_2.ptr == 0 || cbHandlePS.ptr == 0 || cbHandlePerLight.ptr == 0)
+				continue;
+
+			commandList->SetGraphicsRootDescriptorTable(0, cbHandleVS_1);
+			commandList->SetGraphicsRootDescriptorTable(1, cbHandleVS_2);
+			commandList->SetGraphicsRootDescriptorTable(2, cbHandlePS);
 			commandList->SetGraphicsRootDescriptorTable(3, cbHandlePerLight);
 
 			commandList->SetGraphicsRootDescriptorTable(4, gBufferSRVs[0]);
 
-			// Set buffers in the input assembler
-			UINT stride = sizeof(Vertex);
-			UINT offset = 0;
-			D3D12_VERTEX_BUFFER_VIEW vbv = sphere3->GetVB();
-			D3D12_INDEX_BUFFER_VIEW  ibv = sphere3->GetIB();
+			// Set buffers in the input assembler (once the light volume has streamed in)
+			if (sphere3->IsReady())
+			{
+				D3D12_VERTEX_BUFFER_VIEW vbv = sphere3->GetVB();
+				D3D12_INDEX_BUFFER_VIEW  ibv = sphere3->GetIB();
 
-			commandList->IASetVertexBuffers(0, 1, &vbv);
-			commandList->IASetIndexBuffer(&ibv);
+				commandList->IASetVertexBuffers(0, 1, &vbv);
+				commandList->IASetIndexBuffer(&ibv);
 
-			// Draw this mesh
-			commandList->DrawIndexedInstanced(sphere3->GetIndexCount(), 1, 0, 0, 0);
+				// Draw this mesh
+				commandList->DrawIndexedInstanced(sphere3->GetIndexCount(), 1, 0, 0, 0);
+			}
 
 			//// Draw the light (e.g., fullscreen triangle)
 			//commandList->DrawInstanced(3, 1, 0, 0);
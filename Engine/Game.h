@@ -2,6 +2,7 @@
 
 #include "DXCore.h"
 #include "Mesh.h"
+#include "MeshRegistry.h"
 #include "GameEntity.h"
 #include "Transform.h"
 #include "Camera.h"
@@ -41,6 +42,7 @@ private:
 	void CreateRootSigAndPipelineState();
 	void CreateBasicGeometry();
 	void GenerateLights();
+	float GetPixelsPerUnit(GameEntity* entity);
 	
 	// Overall pipeline and rendering requirements
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignatureGBuffer;
@@ -62,6 +64,7 @@ private:
 	std::shared_ptr<Material> cobbleMat;
 
 	std::shared_ptr<Mesh> sphere3;
+	MeshRegistry meshes;
 
 	// Scene
 	int lightCount;
@@ -16,3 +16,13 @@ void GameEntity::SetMesh(std::shared_ptr<Mesh> mesh) { this->mesh = mesh; }
 void GameEntity::SetMaterial(std::shared_ptr<Material> material) { this->material = material; }
 
 Transform* GameEntity::GetTransform() { return &transform; }
+
+// --------------------------------------------------------
+// The mesh's bounds moved into world space by this entity's
+// transform (a box around the transformed box, so it may be
+// a little loose for rotated entities)
+// --------------------------------------------------------
+MeshBounds GameEntity::GetWorldBounds()
+{
+	return TransformMeshBounds(mesh->GetBounds(), transform.GetWorldMatrix());
+}
@@ -21,6 +21,7 @@ public:
 	void SetMaterial(std::shared_ptr<Material> material);
 
 	Transform* GetTransform();
+	MeshBounds GetWorldBounds();
 
 private:
 
@@ -27,22 +27,25 @@ struct Light
 
 // === UTILITY FUNCTIONS ============================================
 
-// Basic sample and unpack
+// Sample and unpack, rebuilding z from x and y since cooked
+// normal maps (BC5) only keep those two
 float3 SampleAndUnpackNormalMap(Texture2D map, SamplerState samp, float2 uv)
 {
-	return map.Sample(samp, uv).rgb * 2.0f - 1.0f;
+	float2 xy = map.Sample(samp, uv).rg * 2.0f - 1.0f;
+	return float3(xy, sqrt(saturate(1.0f - dot(xy, xy))));
 }
 
 // Handle converting tangent-space normal map to world space normal
-float3 NormalMapping(Texture2D map, SamplerState samp, float2 uv, float3 normal, float3 tangent)
+// - The tangent's w is the bitangent sign, which is -1 for mirrored UVs
+float3 NormalMapping(Texture2D map, SamplerState samp, float2 uv, float3 normal, float4 tangent)
 {
 	// Grab the normal from the map
 	float3 normalFromMap = SampleAndUnpackNormalMap(map, samp, uv);
 
 	// Gather the required vectors for converting the normal
 	float3 N = normal;
-	float3 T = normalize(tangent - N * dot(tangent, N));
-	float3 B = cross(T, N);
+	float3 T = normalize(tangent.xyz - N * dot(tangent.xyz, N));
+	float3 B = cross(T, N) * tangent.w;
 
 	// Create the 3x3 matrix to convert from TANGENT-SPACE normals to WORLD-SPACE normals
 	float3x3 TBN = float3x3(T, B, N);
@@ -0,0 +1,176 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <string>
+#endif
+
+MappedFile::MappedFile() :
+	isOpen(false),
+	data(0),
+	size(0),
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(0)
+#else
+	fileDescriptor(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+
+#ifdef _WIN32
+
+// --------------------------------------------------------
+// Opens and maps the given file for reading.  Returns
+// false if the file couldn't be opened or mapped.
+//
+// file - Path to the file to map
+// --------------------------------------------------------
+bool MappedFile::Open(const wchar_t* file)
+{
+	Close();
+
+	fileHandle = CreateFileW(file, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	return MapOpenedFile();
+}
+
+bool MappedFile::Open(const char* file)
+{
+	Close();
+
+	fileHandle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	return MapOpenedFile();
+}
+
+// --------------------------------------------------------
+// Shared by both Open() overloads once the file handle
+// exists: creates the mapping object and maps the view
+// --------------------------------------------------------
+bool MappedFile::MapOpenedFile()
+{
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	// Empty files can't be mapped, but are still valid files
+	size = (size_t)fileSize.QuadPart;
+	isOpen = true;
+	if (size == 0)
+		return true;
+
+	mappingHandle = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if (mappingHandle)
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Unmaps the view and releases the OS handles
+// --------------------------------------------------------
+void MappedFile::Close()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+
+	data = 0;
+	size = 0;
+	mappingHandle = 0;
+	fileHandle = INVALID_HANDLE_VALUE;
+	isOpen = false;
+}
+
+#else
+
+// --------------------------------------------------------
+// Opens and maps the given file for reading.  Returns
+// false if the file couldn't be opened or mapped.
+//
+// file - Path to the file to map
+// --------------------------------------------------------
+bool MappedFile::Open(const wchar_t* file)
+{
+	// POSIX paths are narrow, so convert using the current locale
+	size_t length = wcstombs(0, file, 0);
+	if (length == (size_t)-1)
+		return false;
+
+	std::string narrow(length, '\0');
+	wcstombs(&narrow[0], file, length + 1);
+	return Open(narrow.c_str());
+}
+
+bool MappedFile::Open(const char* file)
+{
+	Close();
+
+	fileDescriptor = open(file, O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat info = {};
+	if (fstat(fileDescriptor, &info) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	// Empty files can't be mapped, but are still valid files
+	size = (size_t)info.st_size;
+	isOpen = true;
+	if (size == 0)
+		return true;
+
+	void* mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapped == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	// We read the file front to back, so let the OS read ahead
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	data = (const char*)mapped;
+	return true;
+}
+
+// --------------------------------------------------------
+// Unmaps the view and closes the file
+// --------------------------------------------------------
+void MappedFile::Close()
+{
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+
+	data = 0;
+	size = 0;
+	fileDescriptor = -1;
+	isOpen = false;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only, memory-mapped view of an entire file
+//
+// The file's bytes can be read directly through GetData()
+// without any intermediate copies.  The mapping stays valid
+// until Close() is called or the object is destroyed.
+//
+// This has no DirectX dependency and works on both Windows
+// and POSIX systems.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Mappings own OS handles, so they can't be copied
+	MappedFile(MappedFile const&) = delete;
+	void operator=(MappedFile const&) = delete;
+
+	bool Open(const wchar_t* file);
+	bool Open(const char* file);
+	void Close();
+
+	bool IsOpen() const { return isOpen; }
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	bool isOpen;
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+	bool MapOpenedFile();
+#else
+	int fileDescriptor;
+#endif
+};
@@ -16,9 +16,19 @@ Material::Material(
 {
 	// Init remaining data
 	finalGPUHandleForSRVs = {};
+	finalSRVs = {};
 	ZeroMemory(textureSRVsBySlot, sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * 128);
 }
 
+// --------------------------------------------------------
+// Gives this material's range of the final CBV/SRV heap
+// back for reuse (once the GPU is done with it)
+// --------------------------------------------------------
+Material::~Material()
+{
+	DX12Helper::GetInstance().FreeSRVs(finalSRVs);
+}
+
 // Getters
 Microsoft::WRL::ComPtr<ID3D12PipelineState> Material::GetPipelineState() { return pipelineState; }
 DirectX::XMFLOAT2 Material::GetUVScale() { return uvScale; }
@@ -58,33 +68,35 @@ void Material::AddTexture(D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptorHandle, int s
 // --------------------------------------------------------
 // Denotes that we're done adding textures to the material,
 // meaning its safe to copy all of the texture SRVs from 
-// their own descriptors to the final CBV/SRV descriptor
-// heap so we can access them as a group while drawing.
+// the staging heap to the final CBV/SRV descriptor heap
+// so we can access them as a group while drawing.  Returns
+// false if there's no room for them, leaving the material
+// unfinalized (and its texture handle null).
 // --------------------------------------------------------
-void Material::FinalizeTextures()
+bool Material::FinalizeTextures()
 {
 	// Skip if we're already set up
-	if (materialTexturesFinalized)
-		return;
+	if (materialTexturesFinalized || highestSRVSlot < 0)
+		return materialTexturesFinalized;
 
-	// Grab the helper before the loop
+	// Grab the helper before copying
 	DX12Helper& dx12Helper = DX12Helper::GetInstance();
 
-	// One by one, copy all SRVs into the shader-visible CBV/SRV heap
-	// Make sure we save the FIRST texture's GPU handle, as that
-	// points to the beginning of the SRV range for this material
-	for (int i = 0; i <= highestSRVSlot; i++)
-	{
-		// Copy a single SRV at a time since they're all
-		// currently in separate heaps!
-		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle =
-			dx12Helper.CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(textureSRVsBySlot[i], 1);
+	// Reserve a range for every slot in the shader-visible CBV/SRV heap,
+	// and save the FIRST texture's GPU handle, as that points to the
+	// beginning of the SRV range for this material
+	finalSRVs = dx12Helper.AllocateSRVs(highestSRVSlot + 1);
+	if (finalSRVs.generation == 0)
+		return false;
+	finalGPUHandleForSRVs = dx12Helper.GetSRVGPUHandle(finalSRVs);
 
-		// Save the first resulting handle
-		if (i == 0)	{ finalGPUHandleForSRVs = gpuHandle; }
-	}
+	// Copy all SRVs into the range - textures loaded in slot
+	// order sit side by side in the staging heap, so this is
+	// usually a single copy
+	dx12Helper.CopySRVs(finalSRVs, textureSRVsBySlot, highestSRVSlot + 1);
 
 	// All done with texture setup
 	materialTexturesFinalized = true;
+	return true;
 }
 
@@ -7,8 +7,23 @@
 #include <unordered_map>
 
 #include "Camera.h"
+#include "DescriptorAllocator.h"
 #include "Transform.h"
 
+// --------------------------------------------------------
+// The texture slots (registers) of materials drawn with
+// GBuffer.hlsl.  Roughness and metal share one packed
+// texture (see PackRoughnessMetalTexture()), so a material
+// has three SRVs to copy and its shader three textures to read.
+// --------------------------------------------------------
+enum MaterialTextureSlot
+{
+	MaterialTextureSlot_Albedo,
+	MaterialTextureSlot_Normal,
+	MaterialTextureSlot_RoughnessMetal,	// Red and green
+	MaterialTextureSlotCount
+};
+
 class Material
 {
 public:
@@ -17,6 +32,7 @@ public:
 		DirectX::XMFLOAT3 tint, 
 		DirectX::XMFLOAT2 uvScale = DirectX::XMFLOAT2(1, 1),
 		DirectX::XMFLOAT2 uvOffset = DirectX::XMFLOAT2(0, 0));
+	~Material();
 
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPipelineState();
 	DirectX::XMFLOAT2 GetUVScale();
@@ -30,7 +46,7 @@ public:
 	void SetColorTint(DirectX::XMFLOAT3 tint);
 
 	void AddTexture(D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptorHandle, int slot);
-	void FinalizeTextures();
+	bool FinalizeTextures();
 
 private:
 
@@ -48,5 +64,6 @@ private:
 	int highestSRVSlot; 
 	D3D12_CPU_DESCRIPTOR_HANDLE textureSRVsBySlot[128]; // Up to 128 textures can be bound per shader stage (we'll never get near that amount)
 	D3D12_GPU_DESCRIPTOR_HANDLE finalGPUHandleForSRVs;
+	DescriptorHandle finalSRVs;	// Where the SRVs above ended up
 };
 
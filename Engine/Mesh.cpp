@@ -1,4 +1,14 @@
 #include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshBounds.h"
+#include "MeshCache.h"
+#include "MeshProcessing.h"
+#include "MeshSimplify.h"
+#include "Meshlets.h"
+#include "ObjParser.h"
+
+#include <chrono>
+#include <cstdio>
 
 
 
@@ -11,175 +21,272 @@ Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numInd
 
 Mesh::Mesh(const wchar_t* objFile)
 {
-	// Initialize in the event the load fails
-	numIndices = 0;
-	ibView = {};
-	vbView = {};
+	MeshLoadData data;
+	LoadData(objFile, 0, data);
+	PrintLoadStats(data);
+	FinishLoad(data, 0);
+}
 
-	// File input object
-	std::ifstream obj(objFile);
+// --------------------------------------------------------
+// Creates a mesh whose data is still being loaded (usually
+// on another thread).  Once the load is done, the GPU buffers
+// are created the first time anything asks for them (on the
+// asking thread) and their data streams in over a few frames.
+// --------------------------------------------------------
+Mesh::Mesh(std::future<std::unique_ptr<MeshLoadData>> pendingLoad) :
+	pendingLoad(std::move(pendingLoad))
+{
+	// Initialize in case something reads the members directly
+	MeshLoadData empty;
+	FinishLoad(empty, 0);
+}
 
-	// Check for successful open
-	if (!obj.is_open())	return;
+// --------------------------------------------------------
+// Blocks until a pending load is done, then queues it to
+// stream to the GPU (the load data stays alive until it's
+// all staged).  Must be called from the rendering thread.
+// --------------------------------------------------------
+void Mesh::FinishPendingLoad()
+{
+	std::shared_ptr<MeshLoadData> data(pendingLoad.get());
+	if (!data) return;
 
-	// Variables used while reading the file
+	PrintLoadStats(*data);
+	FinishLoad(*data, data);
+}
+
+// --------------------------------------------------------
+// Whether the mesh can be drawn this frame.  Never blocks:
+// it finishes a pending load only once the data is ready,
+// then waits for the buffers to finish streaming in.
+// --------------------------------------------------------
+bool Mesh::IsReady()
+{
+	if (pendingLoad.valid())
+	{
+		if (pendingLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
 
-	char chars[100];                     // String for line reading
+		FinishPendingLoad();
+	}
+
+	return DX12Helper::GetInstance().IsUploadComplete(uploadTicket);
+}
 
-	// Still have data left?
-	while (obj.good())
+// --------------------------------------------------------
+// Does all the CPU work of loading a model: uses the cooked
+// version if it's up to date, otherwise parses and processes
+// the OBJ and writes a new cooked version.  Never touches
+// the GPU, so it's safe to run on any thread, and leaves
+// reporting what it did to the caller (PrintLoadStats()).
+//
+// objFile - The source model
+// knownSourceHash - HashBytes() of the source if the caller
+//                   already knows it, or null to hash it here
+// data - Receives the results
+// --------------------------------------------------------
+void Mesh::LoadData(const wchar_t* objFile, const uint64_t* knownSourceHash, MeshLoadData& data)
+{
+	data.file = objFile;
+
+#ifdef NUBIX_COOKED_MESHES_ONLY
+	// Shipping builds trust whatever the MeshCooker tool produced
+	// and don't need the source model to exist at all
+	(void)knownSourceHash;
+	uint64_t sourceHash = AnySourceHash;
+#else
+	// Map the source so we can tell whether the cooked version is still up to date
+	MappedFile source;
+	if (!source.Open(objFile)) return;
+	uint64_t sourceHash = knownSourceHash ? *knownSourceHash : HashBytes(source.GetData(), source.GetSize());
+#endif
+
+	// Fast path: the cooked mesh already has final vertices (tangents
+	// included), indices and levels of detail, so they can go straight
+	// from the mapped file to the GPU without any parsing
+	std::wstring cookedFile = GetCookedMeshPath(objFile);
+	if (data.cooked.Open(cookedFile.c_str(), sourceHash))
+		return;
+
+#ifdef NUBIX_COOKED_MESHES_ONLY
+	printf("Missing cooked mesh %ls (run the MeshCooker tool)\n", cookedFile.c_str());
+#else
+	// Parse the whole (already mapped) file in one go
+	ObjData obj;
+	MeshLoadStats& stats = data.stats;
+	stats.processed = true;
+	ParseObjMemory(source.GetData(), source.GetSize(), obj, &stats.parse);
+
+	// Create the verts by looking up corresponding data from the parsed streams,
+	// reusing a single vertex for every corner that shares the same data
+	std::vector<Vertex>& verts = data.verts;
+	std::vector<unsigned int> indices;
+	BuildObjVertices(obj, verts, indices);
+	stats.corners = indices.size();
+	stats.vertices = verts.size();
+
+	// Keep the raw streams around for anything that needs them later
+	data.positions = std::move(obj.positions);
+	data.normals = std::move(obj.normals);
+	data.uvs = std::move(obj.uvs);
+
+	if (verts.empty()) return;
+
+	// Reorder triangles and vertices for the GPU's caches
+	stats.cacheBefore = AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+	OptimizeMesh(verts, indices);
+	stats.cacheAfter = AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+
+	// Tangents come from the full detail triangles only
+	CalculateTangents(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+
+	// Simplified versions for when the mesh is small on screen,
+	// all sharing the one vertex buffer
+	BuildMeshLods(&verts[0], verts.size(), &indices[0], indices.size(), data.lodIndices, data.lods);
+
+	// Save the final data so the next run can skip all of this
+	WriteCookedMesh(cookedFile.c_str(), &verts[0], (unsigned int)verts.size(), &data.lodIndices[0], (unsigned int)data.lodIndices.size(), &data.lods[0], (unsigned int)data.lods.size(), sourceHash, CookedMeshFlag_VertexCacheOptimized);
+#endif
+}
+
+// --------------------------------------------------------
+// Reports what processing a loaded model took: parse speed,
+// how well corners deduplicated, the vertex cache before and
+// after optimizing, and the levels of detail.  Prints
+// nothing for cooked loads.  Call from one thread at a time
+// (like the one finishing loads) so reports don't interleave.
+// --------------------------------------------------------
+void Mesh::PrintLoadStats(const MeshLoadData& data)
+{
+	const MeshLoadStats& stats = data.stats;
+	if (!stats.processed)
+		return;
+
+	printf("Parsed %ls: %.2f MB in %.2f ms (%.1f MB/s, %u threads)\n",
+		data.file.c_str(),
+		stats.parse.bytes / (1024.0 * 1024.0),
+		stats.parse.milliseconds,
+		stats.parse.GetMegabytesPerSecond(),
+		stats.parse.threads);
+
+	if (stats.parse.malformedLines > 0)
+		printf("Skipped %zu malformed lines in %ls (later indices may be off)\n", stats.parse.malformedLines, data.file.c_str());
+
+	if (stats.vertices == 0)
+		return;
+
+	printf("Deduplicated %zu corners into %zu vertices (%.2f corners per vertex)\n",
+		stats.corners,
+		stats.vertices,
+		(double)stats.corners / stats.vertices);
+
+	printf("Optimized vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		stats.cacheBefore.acmr,
+		stats.cacheAfter.acmr,
+		stats.cacheBefore.atvr,
+		stats.cacheAfter.atvr);
+
+	for (size_t i = 0; i < data.lods.size(); i++)
+		printf("LOD %zu: %u triangles, error %g\n", i, data.lods[i].indexCount / 3, data.lods[i].error);
+}
+
+// --------------------------------------------------------
+// Uploads loaded data to the GPU and keeps the CPU-side
+// copies.  An empty load leaves an empty (but drawable) mesh.
+//
+// data - The loaded data
+// streamOwner - Owns data if it should stream to the GPU over
+//               the next few frames, or null to upload it now
+// --------------------------------------------------------
+void Mesh::FinishLoad(MeshLoadData& data, std::shared_ptr<const void> streamOwner)
+{
+	// Initialize in the event the load failed
+	numIndices = 0;
+	lods.assign(1, MeshLod());
+	bounds = {};
+	ibView = {};
+	vbView = {};
+
+	if (data.cooked.IsOpen())
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-			}
-		}
+		const CookedMesh& cooked = data.cooked;
+		UploadBuffers(cooked.GetVertices(), cooked.GetVertexCount(), cooked.GetIndices(), cooked.GetIndexCount(), cooked.GetLods(), cooked.GetLodCount(), streamOwner);
+
+		// Keep CPU-side copies for systems (like physics) that read them
+		const unsigned int* fullDetail = cooked.GetIndices() + lods[0].firstIndex;
+		verts.assign(cooked.GetVertices(), cooked.GetVertices() + cooked.GetVertexCount());
+		indices.assign(fullDetail, fullDetail + lods[0].indexCount);
 	}
+	else if (!data.verts.empty())
+	{
+		// Create the actual buffers
+		UploadBuffers(&data.verts[0], (int)data.verts.size(), &data.lodIndices[0], (int)data.lodIndices.size(), &data.lods[0], (int)data.lods.size(), streamOwner);
 
-	// Close the file and create the actual buffers
-	obj.close();
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter);
+		// A streamed upload still needs the originals
+		if (streamOwner) verts = data.verts;
+		else verts = std::move(data.verts);
+		indices.assign(data.lodIndices.begin() + lods[0].firstIndex, data.lodIndices.begin() + lods[0].firstIndex + lods[0].indexCount);
+	}
+
+	positions = std::move(data.positions);
+	normals = std::move(data.normals);
+	uvs = std::move(data.uvs);
+	vertCounter = (unsigned int)verts.size();
 }
 
 
 void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices)
 {
-	// Save the index count
-	this->numIndices = numIndices;
-
 	// Calculate the tangents before copying to buffer
 	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
 
-	// Create the two buffers
-	vertexBuffer = DX12Helper::GetInstance().CreateStaticBuffer(sizeof(Vertex), numVerts, vertArray);
-	indexBuffer = DX12Helper::GetInstance().CreateStaticBuffer(sizeof(unsigned int), numIndices, indexArray);
+	UploadBuffers(vertArray, numVerts, indexArray, numIndices, 0, 0, 0);
+}
+
+
+// --------------------------------------------------------
+// Creates the GPU buffers and their views from final data
+// (tangents already calculated).  The data is only read,
+// so it can point directly into a mapped file.  Without any
+// levels of detail, the whole index buffer is the only level.
+// Streamed data must stay alive (through streamOwner) until
+// the streamer has staged it.
+// --------------------------------------------------------
+void Mesh::UploadBuffers(const Vertex* vertArray, int numVerts, const unsigned int* indexArray, int numIndices, const MeshLod* lodArray, int numLods, std::shared_ptr<const void> streamOwner)
+{
+	// Save the level ranges, and the full detail index count
+	if (numLods > 0)
+	{
+		lods.assign(lodArray, lodArray + numLods);
+	}
+	else
+	{
+		MeshLod lod = { 0, (uint32_t)numIndices, 0.0f };
+		lods.assign(1, lod);
+	}
+	this->numIndices = lods[0].indexCount;
+
+	// Culling and level of detail selection both start from these
+	bounds = CalculateMeshBounds(vertArray, numVerts);
+
+	// Create the two buffers.  Streamed uploads finish in order,
+	// so the index buffer's ticket covers both.
+	DX12Helper& dx12Helper = DX12Helper::GetInstance();
+	if (streamOwner)
+	{
+		UploadTicket vertexTicket = 0;
+		vertexBuffer = dx12Helper.CreateStreamedBuffer(sizeof(Vertex), numVerts, vertArray, streamOwner, vertexTicket);
+		indexBuffer = dx12Helper.CreateStreamedBuffer(sizeof(unsigned int), numIndices, indexArray, streamOwner, uploadTicket);
+	}
+	else
+	{
+		// Both go up in one submission
+		dx12Helper.BeginUploadBatch();
+		vertexBuffer = dx12Helper.CreateStaticBuffer(sizeof(Vertex), numVerts, vertArray);
+		indexBuffer = dx12Helper.CreateStaticBuffer(sizeof(unsigned int), numIndices, indexArray);
+		dx12Helper.EndUploadBatch();
+		uploadTicket = 0;
+	}
 
 	// Set up the views
 	vbView.StrideInBytes = sizeof(Vertex);
@@ -189,81 +296,39 @@ void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArr
 	ibView.Format = DXGI_FORMAT_R32_UINT;
 	ibView.SizeInBytes = sizeof(unsigned int) * numIndices;
 	ibView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
-
-
 }
 
 
-// Calculates the tangents of the vertices in a mesh
-// Code adapted from: http://www.terathon.com/code/tangent.html
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+// --------------------------------------------------------
+// Picks the coarsest level of detail whose error would stay
+// under LodErrorThresholdInPixels on screen
+//
+// pixelsPerUnit - How many pixels one object space unit
+//                 covers at the mesh's distance
+// --------------------------------------------------------
+const MeshLod& Mesh::SelectLod(float pixelsPerUnit)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
+	WaitUntilLoaded();
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numVerts;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
-	}
+	size_t lod = 0;
+	while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit < LodErrorThresholdInPixels)
+		lod++;
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+	return lods[lod];
+}
 
-		// Use Gram-Schmidt orthogonalize
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
-}
\ No newline at end of file
+// --------------------------------------------------------
+// Gets the mesh's meshlets (and their culling bounds),
+// building them from the full detail triangles the first
+// time they're needed, since only cluster culling uses them
+// --------------------------------------------------------
+const MeshletData& Mesh::GetMeshlets()
+{
+	WaitUntilLoaded();
+	if (!meshletsBuilt && !verts.empty() && !indices.empty())
+		BuildMeshlets(&verts[0], verts.size(), &indices[0], indices.size(), meshlets);
+
+	meshletsBuilt = true;
+	return meshlets;
+}
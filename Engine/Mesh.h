@@ -5,40 +5,111 @@
 #include <DirectXMath.h>
 #include "Vertex.h"
 #include "DX12Helper.h"
+#include "MeshBounds.h"
+#include "MeshCache.h"
+#include "MeshProcessing.h"
+#include "MeshSimplify.h"
+#include "Meshlets.h"
+#include "ObjParser.h"
 
 
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
-#include <fstream>
 
 using namespace DirectX;
 
+// Levels of detail are swapped once their error would
+// cover less than this many pixels on screen
+const float LodErrorThresholdInPixels = 1.0f;
+
+// --------------------------------------------------------
+// What processing a source model took, for the caller to
+// report (loads run on worker threads, so they don't print).
+// All zero when the cooked version was used.
+// --------------------------------------------------------
+struct MeshLoadStats
+{
+	bool processed;
+	ObjParseStats parse;
+	size_t corners;                      // Face corners, before deduplication
+	size_t vertices;
+	VertexCacheStats cacheBefore;
+	VertexCacheStats cacheAfter;
+};
+
+// --------------------------------------------------------
+// Everything loading a model produces before it touches the
+// GPU.  Filling one in is thread safe; uploading it isn't.
+// --------------------------------------------------------
+struct MeshLoadData
+{
+	std::wstring file;                   // The source model
+	CookedMesh cooked;                   // Open if the data is in a cooked file
+	std::vector<Vertex> verts;           // Otherwise, the processed data
+	std::vector<unsigned int> lodIndices;
+	std::vector<MeshLod> lods;
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	MeshLoadStats stats = {};
+};
+
 class Mesh
 {
 public:
 	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices);
 	Mesh(const wchar_t* objFile);
+	Mesh(std::future<std::unique_ptr<MeshLoadData>> pendingLoad);
+
+	// CPU side of loading a model, safe on any thread
+	static void LoadData(const wchar_t* objFile, const uint64_t* knownSourceHash, MeshLoadData& data);
+	static void PrintLoadStats(const MeshLoadData& data);
+
+	// Finishes a pending load (only needed before reading the members below directly)
+	void WaitUntilLoaded() { if (pendingLoad.valid()) FinishPendingLoad(); }
+
+	// Whether the GPU buffers can be drawn yet (never blocks)
+	bool IsReady();
+
+	D3D12_VERTEX_BUFFER_VIEW GetVB() { WaitUntilLoaded(); return vbView; }
+	D3D12_INDEX_BUFFER_VIEW GetIB() { WaitUntilLoaded(); return ibView; }
+	int GetIndexCount() { WaitUntilLoaded(); return numIndices; }
+
+	int GetLodCount() { WaitUntilLoaded(); return (int)lods.size(); }
+	const MeshLod& GetLod(int lod) { WaitUntilLoaded(); return lods[lod]; }
+	const MeshLod& SelectLod(float pixelsPerUnit);
+
+	const MeshletData& GetMeshlets();
 
-	D3D12_VERTEX_BUFFER_VIEW GetVB() { return vbView; }
-	D3D12_INDEX_BUFFER_VIEW GetIB() { return ibView; }
-	int GetIndexCount() { return numIndices; }
+	const MeshBounds& GetBounds() { WaitUntilLoaded(); return bounds; }
 
 	std::vector<XMFLOAT3> positions;     // Positions from the file
 	std::vector<XMFLOAT3> normals;       // Normals from the file
 	std::vector<XMFLOAT2> uvs;           // UVs from the file
 	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
+	std::vector<UINT> indices;           // Indices of these verts (full detail only)
+	unsigned int vertCounter = 0;        // Count of unique vertices
 
 private:
 	int numIndices; 
+	MeshBounds bounds;                   // Object space box and sphere
+	std::vector<MeshLod> lods;           // Index ranges, from full detail to coarsest
+	MeshletData meshlets;                // Clusters of the full detail triangles
+	bool meshletsBuilt = false;
+	std::future<std::unique_ptr<MeshLoadData>> pendingLoad;
+	UploadTicket uploadTicket = 0;       // Last streamed upload the buffers need
 	
 	D3D12_VERTEX_BUFFER_VIEW vbView;
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexBuffer;
+	std::shared_ptr<BufferRange> vertexBuffer;   // Ranges of the shared static buffers
 
 	D3D12_INDEX_BUFFER_VIEW ibView;
-	Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer;
+	std::shared_ptr<BufferRange> indexBuffer;
 
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	void FinishPendingLoad();
+	void FinishLoad(MeshLoadData& data, std::shared_ptr<const void> streamOwner);
 	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices);
+	void UploadBuffers(const Vertex* vertArray, int numVerts, const unsigned int* indexArray, int numIndices, const MeshLod* lodArray, int numLods, std::shared_ptr<const void> streamOwner);
 };
 
@@ -0,0 +1,284 @@
+#include "MeshBounds.h"
+
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+
+// Every x86 target has SSE2, which is all the min/max
+// reduction needs; anything else gets the scalar loop
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define NUBIX_BOUNDS_SSE 1
+#endif
+
+namespace
+{
+#ifdef NUBIX_BOUNDS_SSE
+	// Loads a vertex's position into xyz.  The fourth lane
+	// picks up the start of the UV, which nothing here uses.
+	__m128 LoadPosition(const Vertex& v)
+	{
+		return _mm_loadu_ps(&v.Position.x);
+	}
+
+	XMFLOAT3 StorePosition(__m128 value)
+	{
+		float lanes[4];
+		_mm_storeu_ps(lanes, value);
+		return XMFLOAT3(lanes[0], lanes[1], lanes[2]);
+	}
+
+	// --------------------------------------------------------
+	// Min/max reduction four vertices at a time, with two sets
+	// of accumulators so consecutive loads don't wait on each
+	// other's results
+	// --------------------------------------------------------
+	void CalculateBoxSSE(const Vertex* verts, size_t count, XMFLOAT3& low, XMFLOAT3& high)
+	{
+		__m128 low0 = LoadPosition(verts[0]);
+		__m128 high0 = low0;
+		__m128 low1 = low0;
+		__m128 high1 = low0;
+
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 a = LoadPosition(verts[i + 0]);
+			__m128 b = LoadPosition(verts[i + 1]);
+			__m128 c = LoadPosition(verts[i + 2]);
+			__m128 d = LoadPosition(verts[i + 3]);
+
+			low0 = _mm_min_ps(low0, _mm_min_ps(a, b));
+			high0 = _mm_max_ps(high0, _mm_max_ps(a, b));
+			low1 = _mm_min_ps(low1, _mm_min_ps(c, d));
+			high1 = _mm_max_ps(high1, _mm_max_ps(c, d));
+		}
+
+		for (; i < count; i++)
+		{
+			__m128 p = LoadPosition(verts[i]);
+			low0 = _mm_min_ps(low0, p);
+			high0 = _mm_max_ps(high0, p);
+		}
+
+		low = StorePosition(_mm_min_ps(low0, low1));
+		high = StorePosition(_mm_max_ps(high0, high1));
+	}
+
+	// Largest squared distance from center to any position
+	float CalculateRadiusSquaredSSE(const Vertex* verts, size_t count, const XMFLOAT3& center)
+	{
+		// Zero the fourth lane so the UV doesn't count
+		const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		__m128 c = _mm_set_ps(0.0f, center.z, center.y, center.x);
+		__m128 farthest = _mm_setzero_ps();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			__m128 d = _mm_and_ps(_mm_sub_ps(LoadPosition(verts[i]), c), xyzMask);
+			__m128 squared = _mm_mul_ps(d, d);
+
+			// x + y + z into the lowest lane
+			__m128 sum = _mm_add_ps(squared, _mm_movehl_ps(squared, squared));
+			sum = _mm_add_ss(sum, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 1, 1, 1)));
+			farthest = _mm_max_ss(farthest, sum);
+		}
+
+		return _mm_cvtss_f32(farthest);
+	}
+#else
+	void CalculateBoxScalar(const Vertex* verts, size_t count, XMFLOAT3& low, XMFLOAT3& high)
+	{
+		low = verts[0].Position;
+		high = verts[0].Position;
+		for (size_t i = 1; i < count; i++)
+		{
+			const XMFLOAT3& p = verts[i].Position;
+			low.x = fminf(low.x, p.x); high.x = fmaxf(high.x, p.x);
+			low.y = fminf(low.y, p.y); high.y = fmaxf(high.y, p.y);
+			low.z = fminf(low.z, p.z); high.z = fmaxf(high.z, p.z);
+		}
+	}
+
+	float CalculateRadiusSquaredScalar(const Vertex* verts, size_t count, const XMFLOAT3& center)
+	{
+		float farthest = 0.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			const XMFLOAT3& p = verts[i].Position;
+			float dx = p.x - center.x;
+			float dy = p.y - center.y;
+			float dz = p.z - center.z;
+			farthest = fmaxf(farthest, dx * dx + dy * dy + dz * dz);
+		}
+		return farthest;
+	}
+#endif
+}
+
+
+// --------------------------------------------------------
+// Ritter's bounding sphere: start with the two points far
+// apart along some direction, then grow to take in any
+// points left outside.  Within a few percent of optimal.
+//
+// verts - The vertices
+// vertices - Which of them to bound, or null for the first count
+// count - How many to bound (at least 1)
+// center - Receives the sphere's center
+// radius - Receives its radius
+// --------------------------------------------------------
+void CalculateBoundingSphere(const Vertex* verts, const uint32_t* vertices, size_t count, XMFLOAT3& center, float& radius)
+{
+	auto position = [&](size_t i) -> const XMFLOAT3& { return verts[vertices ? vertices[i] : i].Position; };
+	auto distanceSquared = [](const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		float dx = a.x - b.x;
+		float dy = a.y - b.y;
+		float dz = a.z - b.z;
+		return dx * dx + dy * dy + dz * dz;
+	};
+	auto farthestFrom = [&](const XMFLOAT3& point)
+	{
+		size_t farthest = 0;
+		float farthestDistance = -1.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			float distance = distanceSquared(position(i), point);
+			if (distance > farthestDistance)
+			{
+				farthest = i;
+				farthestDistance = distance;
+			}
+		}
+		return position(farthest);
+	};
+
+	XMFLOAT3 a = farthestFrom(position(0));
+	XMFLOAT3 b = farthestFrom(a);
+	center = XMFLOAT3((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+	radius = sqrtf(distanceSquared(a, b)) * 0.5f;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = position(i);
+		float distance = sqrtf(distanceSquared(p, center));
+		if (distance <= radius)
+			continue;
+
+		// Move the center toward the point just enough to reach it
+		float grownRadius = (radius + distance) * 0.5f;
+		float shift = (grownRadius - radius) / distance;
+		center.x += (p.x - center.x) * shift;
+		center.y += (p.y - center.y) * shift;
+		center.z += (p.z - center.z) * shift;
+		radius = grownRadius;
+	}
+}
+
+
+// --------------------------------------------------------
+// Finds the axis-aligned box around a mesh's positions,
+// and a sphere around them: whichever is smaller of the
+// one centered on the box and Ritter's.  Both are exact
+// around their centers (the box touches the outermost
+// positions, and so does the sphere).
+//
+// verts - The mesh's vertices
+// count - How many vertices
+// --------------------------------------------------------
+MeshBounds CalculateMeshBounds(const Vertex* verts, size_t count)
+{
+	MeshBounds bounds = {};
+	if (count == 0)
+		return bounds;
+
+#ifdef NUBIX_BOUNDS_SSE
+	CalculateBoxSSE(verts, count, bounds.min, bounds.max);
+#else
+	CalculateBoxScalar(verts, count, bounds.min, bounds.max);
+#endif
+
+	bounds.center = XMFLOAT3(
+		(bounds.min.x + bounds.max.x) * 0.5f,
+		(bounds.min.y + bounds.max.y) * 0.5f,
+		(bounds.min.z + bounds.max.z) * 0.5f);
+
+	// Ritter's is usually tighter for long or lopsided meshes,
+	// but not always, so measure both (exactly, around each center)
+	XMFLOAT3 ritterCenter;
+	float ritterRadius;
+	CalculateBoundingSphere(verts, 0, count, ritterCenter, ritterRadius);
+#ifdef NUBIX_BOUNDS_SSE
+	float radiusSquared = CalculateRadiusSquaredSSE(verts, count, bounds.center);
+	float ritterRadiusSquared = CalculateRadiusSquaredSSE(verts, count, ritterCenter);
+#else
+	float radiusSquared = CalculateRadiusSquaredScalar(verts, count, bounds.center);
+	float ritterRadiusSquared = CalculateRadiusSquaredScalar(verts, count, ritterCenter);
+#endif
+
+	if (ritterRadiusSquared < radiusSquared)
+	{
+		bounds.center = ritterCenter;
+		radiusSquared = ritterRadiusSquared;
+	}
+	bounds.radius = sqrtf(radiusSquared);
+
+	return bounds;
+}
+
+
+// --------------------------------------------------------
+// Transforms bounds without touching all eight corners
+// (Arvo's method): the box's center is transformed as a
+// point, and each new half extent is the old half extents
+// weighted by the absolute values of the matrix.  The
+// result is the tightest box around the transformed box.
+// The sphere's radius grows by the matrix's largest scale.
+//
+// bounds - Object space bounds
+// matrix - Transform to apply (like a world matrix)
+// --------------------------------------------------------
+MeshBounds TransformMeshBounds(const MeshBounds& bounds, const XMFLOAT4X4& matrix)
+{
+	const float(*m)[4] = matrix.m;
+	auto transformPoint = [m](const XMFLOAT3& p)
+	{
+		return XMFLOAT3(
+			p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+			p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+			p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2]);
+	};
+
+	XMFLOAT3 boxCenter(
+		(bounds.min.x + bounds.max.x) * 0.5f,
+		(bounds.min.y + bounds.max.y) * 0.5f,
+		(bounds.min.z + bounds.max.z) * 0.5f);
+	XMFLOAT3 extent(
+		(bounds.max.x - bounds.min.x) * 0.5f,
+		(bounds.max.y - bounds.min.y) * 0.5f,
+		(bounds.max.z - bounds.min.z) * 0.5f);
+
+	XMFLOAT3 center = transformPoint(boxCenter);
+	float newExtent[3];
+	for (int c = 0; c < 3; c++)
+		newExtent[c] = extent.x * fabsf(m[0][c]) + extent.y * fabsf(m[1][c]) + extent.z * fabsf(m[2][c]);
+
+	MeshBounds result;
+	result.min = XMFLOAT3(center.x - newExtent[0], center.y - newExtent[1], center.z - newExtent[2]);
+	result.max = XMFLOAT3(center.x + newExtent[0], center.y + newExtent[1], center.z + newExtent[2]);
+	result.center = transformPoint(bounds.center);
+
+	// Each row is where an axis ends up, so its length is that axis' scale
+	float scaleSquared = 0.0f;
+	for (int r = 0; r < 3; r++)
+		scaleSquared = fmaxf(scaleSquared, m[r][0] * m[r][0] + m[r][1] * m[r][1] + m[r][2] * m[r][2]);
+	result.radius = bounds.radius * sqrtf(scaleSquared);
+
+	return result;
+}
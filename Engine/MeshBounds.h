@@ -0,0 +1,30 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// An axis-aligned box and a bounding sphere around a set
+// of positions.  The sphere isn't necessarily centered on
+// the box, but its radius is never more than half the box's
+// diagonal.
+// --------------------------------------------------------
+struct MeshBounds
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+	DirectX::XMFLOAT3 center;
+	float radius;
+};
+
+// Finds the box and sphere around a mesh's positions
+MeshBounds CalculateMeshBounds(const Vertex* verts, size_t count);
+
+// Ritter's sphere around some (or all) of a mesh's positions
+void CalculateBoundingSphere(const Vertex* verts, const uint32_t* vertices, size_t count, DirectX::XMFLOAT3& center, float& radius);
+
+// Moves object space bounds into another space using a (row vector) matrix
+MeshBounds TransformMeshBounds(const MeshBounds& bounds, const DirectX::XMFLOAT4X4& matrix);
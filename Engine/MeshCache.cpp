@@ -0,0 +1,296 @@
+#include "MeshCache.h"
+#include "MeshBounds.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace DirectX;
+
+CookedMesh::CookedMesh() :
+	header(0)
+{
+}
+
+// --------------------------------------------------------
+// Maps a cooked mesh file and checks that it's usable.
+// Returns false (and stays closed) if the file is missing,
+// was written by a different version, is truncated, has
+// flags this build doesn't know or was cooked from a
+// different version of the source file.
+//
+// file - The cooked mesh file
+// expectedSourceHash - HashBytes() of the current source file,
+//                      or AnySourceHash to skip that check
+// --------------------------------------------------------
+bool CookedMesh::Open(const wchar_t* file, uint64_t expectedSourceHash)
+{
+	Close();
+	return this->file.Open(file) && Validate(expectedSourceHash);
+}
+
+bool CookedMesh::Open(const char* file, uint64_t expectedSourceHash)
+{
+	Close();
+	return this->file.Open(file) && Validate(expectedSourceHash);
+}
+
+void CookedMesh::Close()
+{
+	file.Close();
+	header = 0;
+}
+
+const Vertex* CookedMesh::GetVertices() const
+{
+	return header ? (const Vertex*)(header + 1) : 0;
+}
+
+const unsigned int* CookedMesh::GetIndices() const
+{
+	return header ? (const unsigned int*)(GetVertices() + header->vertexCount) : 0;
+}
+
+const MeshLod* CookedMesh::GetLods() const
+{
+	return header ? (const MeshLod*)(GetIndices() + header->indexCount) : 0;
+}
+
+// --------------------------------------------------------
+// Makes sure every level of detail stays within the index
+// buffer and is made of whole triangles
+// --------------------------------------------------------
+static bool ValidateLods(const CookedMeshHeader* h)
+{
+	const MeshLod* lods = (const MeshLod*)((const unsigned int*)((const Vertex*)(h + 1) + h->vertexCount) + h->indexCount);
+	for (uint32_t i = 0; i < h->lodCount; i++)
+	{
+		if (lods[i].indexCount % 3 != 0 ||
+			lods[i].firstIndex > h->indexCount ||
+			lods[i].indexCount > h->indexCount - lods[i].firstIndex)
+			return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Checks the mapped header against what this build expects
+// --------------------------------------------------------
+bool CookedMesh::Validate(uint64_t expectedSourceHash)
+{
+	if (file.GetSize() < sizeof(CookedMeshHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const CookedMeshHeader* h = (const CookedMeshHeader*)file.GetData();
+	size_t expectedSize =
+		sizeof(CookedMeshHeader) +
+		(size_t)h->vertexCount * sizeof(Vertex) +
+		(size_t)h->indexCount * sizeof(unsigned int) +
+		(size_t)h->lodCount * sizeof(MeshLod);
+
+	if (memcmp(h->magic, "NBXM", 4) != 0 ||
+		h->version != CookedMeshVersion ||
+		h->vertexStride != sizeof(Vertex) ||
+		(h->flags & ~(uint32_t)CookedMeshFlag_All) != 0 ||
+		(expectedSourceHash != AnySourceHash && h->sourceHash != expectedSourceHash) ||
+		file.GetSize() != expectedSize ||
+		!ValidateLods(h))
+	{
+		Close();
+		return false;
+	}
+
+	header = h;
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Hashes a block of memory eight bytes at a time.  This is
+// only used to notice that a source file has changed, so
+// speed matters far more than hash quality here.
+//
+// data - The bytes to hash
+// size - How many bytes
+// --------------------------------------------------------
+uint64_t HashBytes(const void* data, size_t size)
+{
+	const uint64_t prime = 0x100000001B3ull;
+	uint64_t hash = 0xCBF29CE484222325ull ^ (size * prime);
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t wordCount = size / 8;
+	for (size_t i = 0; i < wordCount; i++)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i * 8, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+
+	// Any leftover bytes one at a time
+	for (size_t i = wordCount * 8; i < size; i++)
+		hash = (hash ^ bytes[i]) * prime;
+
+	return hash ^ (hash >> 32);
+}
+
+
+// --------------------------------------------------------
+// Swaps the source file's extension for the cooked one,
+// so "Models/sphere.obj" becomes "Models/sphere.nbxmesh"
+// --------------------------------------------------------
+template<typename StringType>
+static StringType ReplaceExtension(const StringType& sourceFile, const StringType& extension)
+{
+	size_t dot = sourceFile.find_last_of('.');
+	size_t slash = sourceFile.find_last_of(StringType(1, '/') + StringType(1, '\\'));
+	if (dot == StringType::npos || (slash != StringType::npos && dot < slash))
+		return sourceFile + extension;
+
+	return sourceFile.substr(0, dot) + extension;
+}
+
+std::wstring GetCookedMeshPath(const std::wstring& sourceFile) { return ReplaceExtension(sourceFile, std::wstring(L"" COOKED_MESH_EXTENSION)); }
+std::string GetCookedMeshPath(const std::string& sourceFile) { return ReplaceExtension(sourceFile, std::string(COOKED_MESH_EXTENSION)); }
+
+
+// --------------------------------------------------------
+// Writes the header, vertices, indices and levels of detail to an open file
+// --------------------------------------------------------
+static bool WriteCookedMeshToFile(FILE* out, const Vertex* verts, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const MeshLod* lods, unsigned int lodCount, uint64_t sourceHash, uint32_t flags)
+{
+	CookedMeshHeader header = {};
+	memcpy(header.magic, "NBXM", 4);
+	header.version = CookedMeshVersion;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.flags = flags;
+	header.sourceHash = sourceHash;
+	header.lodCount = lodCount;
+
+	// Object-space bounds, which are handy to have without
+	// touching the vertex data at load time
+	MeshBounds bounds = CalculateMeshBounds(verts, vertexCount);
+	header.boundsMin = bounds.min;
+	header.boundsMax = bounds.max;
+
+	return
+		fwrite(&header, sizeof(header), 1, out) == 1 &&
+		fwrite(verts, sizeof(Vertex), vertexCount, out) == vertexCount &&
+		fwrite(indices, sizeof(unsigned int), indexCount, out) == indexCount &&
+		fwrite(lods, sizeof(MeshLod), lodCount, out) == lodCount;
+}
+
+// --------------------------------------------------------
+// Suffix for the temporary file a cooked mesh is written to
+// before being renamed into place.  It's unique to this
+// process and this write, so two loaders (or a loader and
+// the cooker) writing the same mesh never share a file and
+// readers only ever see a complete one.
+// --------------------------------------------------------
+static std::string GetTemporarySuffix()
+{
+	static std::atomic<unsigned int> writes(0);
+#ifdef _WIN32
+	unsigned long process = GetCurrentProcessId();
+#else
+	unsigned long process = (unsigned long)getpid();
+#endif
+
+	char suffix[64];
+	snprintf(suffix, sizeof(suffix), ".%lu-%u.tmp", process, writes++);
+	return suffix;
+}
+
+#ifndef _WIN32
+// --------------------------------------------------------
+// POSIX paths are narrow, so convert using the current
+// locale.  Returns false if the path can't be represented.
+// --------------------------------------------------------
+static bool NarrowPath(const wchar_t* file, std::string& narrow)
+{
+	size_t length = wcstombs(0, file, 0);
+	if (length == (size_t)-1)
+		return false;
+
+	narrow.assign(length, '\0');
+	return wcstombs(&narrow[0], file, length + 1) == length;
+}
+#endif
+
+// --------------------------------------------------------
+// Writes a cooked mesh file.  The data goes to a temporary
+// file first, which then replaces the real one, so a reader
+// never maps a half-written mesh.  Returns false (and
+// leaves any existing file alone) if it couldn't be fully
+// written.
+//
+// file - Where to write the cooked mesh
+// verts - Final vertices (tangents already calculated)
+// vertexCount - How many vertices
+// indices - Final index buffer, holding every level of detail
+// indexCount - How many indices
+// lods - Where each level of detail is in the index buffer
+// lodCount - How many levels of detail
+// sourceHash - HashBytes() of the file this was cooked from
+// flags - CookedMeshFlags describing any extra processing
+// --------------------------------------------------------
+bool WriteCookedMesh(const wchar_t* file, const Vertex* verts, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const MeshLod* lods, unsigned int lodCount, uint64_t sourceHash, uint32_t flags)
+{
+#ifdef _WIN32
+	std::string suffix = GetTemporarySuffix();
+	std::wstring temporary = std::wstring(file) + std::wstring(suffix.begin(), suffix.end());
+
+	FILE* out = 0;
+	if (_wfopen_s(&out, temporary.c_str(), L"wb") != 0 || !out)
+		return false;
+
+	bool written = WriteCookedMeshToFile(out, verts, vertexCount, indices, indexCount, lods, lodCount, sourceHash, flags);
+	written = fclose(out) == 0 && written;
+	written = written && MoveFileExW(temporary.c_str(), file, MOVEFILE_REPLACE_EXISTING) != 0;
+	if (!written) _wremove(temporary.c_str());
+	return written;
+#else
+	std::string narrow;
+	return
+		NarrowPath(file, narrow) &&
+		WriteCookedMesh(narrow.c_str(), verts, vertexCount, indices, indexCount, lods, lodCount, sourceHash, flags);
+#endif
+}
+
+bool WriteCookedMesh(const char* file, const Vertex* verts, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const MeshLod* lods, unsigned int lodCount, uint64_t sourceHash, uint32_t flags)
+{
+	std::string temporary = std::string(file) + GetTemporarySuffix();
+
+	FILE* out = 0;
+#ifdef _WIN32
+	if (fopen_s(&out, temporary.c_str(), "wb") != 0) out = 0;
+#else
+	out = fopen(temporary.c_str(), "wb");
+#endif
+	if (!out)
+		return false;
+
+	bool written = WriteCookedMeshToFile(out, verts, vertexCount, indices, indexCount, lods, lodCount, sourceHash, flags);
+	written = fclose(out) == 0 && written;
+#ifdef _WIN32
+	written = written && MoveFileExA(temporary.c_str(), file, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	written = written && rename(temporary.c_str(), file) == 0;
+#endif
+	if (!written) remove(temporary.c_str());
+	return written;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+#include "MeshSimplify.h"
+#include "Vertex.h"
+
+// Bump this whenever the cooked layout (or Vertex) changes
+// so that stale cache files are ignored and rewritten
+const uint32_t CookedMeshVersion = 3;
+
+// Pass as the expected source hash to accept a cooked mesh
+// without checking it against its source file
+const uint64_t AnySourceHash = 0;
+
+// File extension used for cooked meshes, which are written
+// next to the source model
+#define COOKED_MESH_EXTENSION ".nbxmesh"
+
+// Extra processing that has been applied to a cooked mesh
+enum CookedMeshFlags : uint32_t
+{
+	CookedMeshFlag_None = 0,
+	CookedMeshFlag_VertexCacheOptimized = 1 << 0,
+
+	// Every flag this build understands; files with any
+	// other bit set were cooked by something newer
+	CookedMeshFlag_All = CookedMeshFlag_VertexCacheOptimized,
+};
+
+// --------------------------------------------------------
+// Header at the start of every cooked mesh file.  The final
+// vertex array immediately follows the header, the index
+// buffer (every level of detail, one after another) follows
+// the vertices and the MeshLod table follows the indices.
+// --------------------------------------------------------
+struct CookedMeshHeader
+{
+	char magic[4];					// Always "NBXM"
+	uint32_t version;				// CookedMeshVersion when written
+	uint32_t vertexStride;			// sizeof(Vertex) when written
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t flags;					// CookedMeshFlags describing extra processing
+	uint64_t sourceHash;			// HashBytes() of the source file
+	DirectX::XMFLOAT3 boundsMin;	// Object-space AABB of the vertices
+	DirectX::XMFLOAT3 boundsMax;
+	uint32_t lodCount;				// Entries in the MeshLod table
+	uint32_t reserved;
+};
+
+static_assert(sizeof(CookedMeshHeader) == 64, "Cooked mesh header layout changed - bump CookedMeshVersion");
+
+// --------------------------------------------------------
+// A cooked mesh file mapped straight into memory.  The
+// vertex and index pointers point into the mapping, so they
+// are only valid while this object is open.
+// --------------------------------------------------------
+class CookedMesh
+{
+public:
+	CookedMesh();
+
+	bool Open(const wchar_t* file, uint64_t expectedSourceHash);
+	bool Open(const char* file, uint64_t expectedSourceHash);
+	void Close();
+
+	bool IsOpen() const { return header != 0; }
+	const CookedMeshHeader* GetHeader() const { return header; }
+	const Vertex* GetVertices() const;
+	const unsigned int* GetIndices() const;
+	const MeshLod* GetLods() const;
+	unsigned int GetVertexCount() const { return header ? header->vertexCount : 0; }
+	unsigned int GetIndexCount() const { return header ? header->indexCount : 0; }
+	unsigned int GetLodCount() const { return header ? header->lodCount : 0; }
+
+private:
+	MappedFile file;
+	const CookedMeshHeader* header;
+
+	bool Validate(uint64_t expectedSourceHash);
+};
+
+// Fast, non-cryptographic 64-bit hash used to detect source changes
+uint64_t HashBytes(const void* data, size_t size);
+
+// Where the cooked version of a source model lives
+std::wstring GetCookedMeshPath(const std::wstring& sourceFile);
+std::string GetCookedMeshPath(const std::string& sourceFile);
+
+// Writes the final vertices, indices and levels of detail of a mesh to a cooked mesh file
+bool WriteCookedMesh(const wchar_t* file, const Vertex* verts, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const MeshLod* lods, unsigned int lodCount, uint64_t sourceHash, uint32_t flags = CookedMeshFlag_None);
+bool WriteCookedMesh(const char* file, const Vertex* verts, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const MeshLod* lods, unsigned int lodCount, uint64_t sourceHash, uint32_t flags = CookedMeshFlag_None);
@@ -0,0 +1,1051 @@
+#include "MeshProcessing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+
+// Which SIMD tangent kernels this build can contain.  MSVC
+// allows AVX2 intrinsics in any function, so that path is
+// always built there and picked at runtime.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define NUBIX_TANGENTS_SSE 1
+#endif
+
+#if defined(NUBIX_TANGENTS_SSE) && (defined(_MSC_VER) || defined(__AVX2__))
+#define NUBIX_TANGENTS_AVX2 1
+#endif
+
+namespace
+{
+	// Per-vertex tangent and bitangent sums.  Each vertex's
+	// sums share one 32 byte block, so adding a triangle to a
+	// corner only touches a single cache line, and each half
+	// loads as a single row.
+	struct TangentSum
+	{
+		float tx, ty, tz, padding0;
+		float bx, by, bz, padding1;
+	};
+
+	// --------------------------------------------------------
+	// Calculates the tangent and bitangent of each triangle in
+	// a range and adds them to each corner's sums.  This is the
+	// scalar fallback, and handles whatever is left over after
+	// the SIMD versions below.
+	// Code adapted from: http://www.terathon.com/code/tangent.html
+	//
+	// sums - Sums for vertices firstSum and up
+	// --------------------------------------------------------
+	void AccumulateTangentsScalar(const Vertex* verts, const unsigned int* indices, size_t firstTriangle, size_t lastTriangle, TangentSum* sums, unsigned int firstSum)
+	{
+		for (size_t triangle = firstTriangle; triangle < lastTriangle; triangle++)
+		{
+			// Grab indices and vertices of the triangle
+			unsigned int i1 = indices[triangle * 3 + 0];
+			unsigned int i2 = indices[triangle * 3 + 1];
+			unsigned int i3 = indices[triangle * 3 + 2];
+			const Vertex* v1 = &verts[i1];
+			const Vertex* v2 = &verts[i2];
+			const Vertex* v3 = &verts[i3];
+
+			// Calculate vectors relative to triangle positions
+			float x1 = v2->Position.x - v1->Position.x;
+			float y1 = v2->Position.y - v1->Position.y;
+			float z1 = v2->Position.z - v1->Position.z;
+
+			float x2 = v3->Position.x - v1->Position.x;
+			float y2 = v3->Position.y - v1->Position.y;
+			float z2 = v3->Position.z - v1->Position.z;
+
+			// Do the same for vectors relative to triangle uv's
+			float s1 = v2->UV.x - v1->UV.x;
+			float t1 = v2->UV.y - v1->UV.y;
+
+			float s2 = v3->UV.x - v1->UV.x;
+			float t2 = v3->UV.y - v1->UV.y;
+
+			// Triangles with degenerate uvs don't contribute
+			float det = s1 * t2 - s2 * t1;
+			float r = det != 0.0f ? 1.0f / det : 0.0f;
+
+			float tx = (t2 * x1 - t1 * x2) * r;
+			float ty = (t2 * y1 - t1 * y2) * r;
+			float tz = (t2 * z1 - t1 * z2) * r;
+
+			float bx = (s1 * x2 - s2 * x1) * r;
+			float by = (s1 * y2 - s2 * y1) * r;
+			float bz = (s1 * z2 - s2 * z1) * r;
+
+			// Adjust the sums of each vert of the triangle
+			const unsigned int corners[3] = { i1, i2, i3 };
+			for (unsigned int v : corners)
+			{
+				TangentSum& sum = sums[v - firstSum];
+				sum.tx += tx; sum.ty += ty; sum.tz += tz;
+				sum.bx += bx; sum.by += by; sum.bz += bz;
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Turns the summed tangents of a range of vertices into
+	// final tangents: orthogonal to the normal (using Gram-
+	// Schmidt), normalized, and with w holding the sign of the
+	// bitangent relative to cross(normal, tangent)
+	// --------------------------------------------------------
+	void FinalizeTangentsScalar(Vertex* verts, size_t first, size_t last, const TangentSum* sums)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			// Grab the vectors
+			XMFLOAT3 n = verts[i].Normal;
+			XMFLOAT3 t(sums[i].tx, sums[i].ty, sums[i].tz);
+			XMFLOAT3 b(sums[i].bx, sums[i].by, sums[i].bz);
+
+			// Use Gram-Schmidt orthogonalize
+			float d = n.x * t.x + n.y * t.y + n.z * t.z;
+			t.x -= n.x * d;
+			t.y -= n.y * d;
+			t.z -= n.z * d;
+
+			// Normalize (leaving degenerate tangents as zero)
+			float length = sqrtf(t.x * t.x + t.y * t.y + t.z * t.z);
+			float scale = length != 0.0f ? 1.0f / length : 0.0f;
+			t.x *= scale;
+			t.y *= scale;
+			t.z *= scale;
+
+			// Mirrored uvs make the bitangent point against cross(n, t)
+			float cx = n.y * t.z - n.z * t.y;
+			float cy = n.z * t.x - n.x * t.z;
+			float cz = n.x * t.y - n.y * t.x;
+			float handedness = cx * b.x + cy * b.y + cz * b.z;
+
+			// Store the tangent
+			verts[i].Tangent = XMFLOAT4(t.x, t.y, t.z, handedness < 0.0f ? -1.0f : 1.0f);
+		}
+	}
+
+	// --------------------------------------------------------
+	// The handful of operations the SIMD tangent kernels need,
+	// in one flavor per instruction set.  Width is how many
+	// lanes (triangles or vertices) each Reg holds.  Data comes
+	// in and goes out as rows of four floats (e.g. a position
+	// plus whatever follows it), which Transpose() turns into
+	// one Reg per component and Untranspose() turns back.
+	// --------------------------------------------------------
+#ifdef NUBIX_TANGENTS_SSE
+	struct SSELanes
+	{
+		typedef __m128 Reg;
+		typedef __m128 Row;
+		static const int Width = 4;
+
+		static Row LoadRow(const float* p) { return _mm_loadu_ps(p); }
+		static void StoreRow(float* p, Row r) { _mm_storeu_ps(p, r); }
+		static Row AddRow(Row a, Row b) { return _mm_add_ps(a, b); }
+
+		static void Transpose(const Row* rows, Reg& a, Reg& b, Reg& c, Reg& d)
+		{
+			a = rows[0]; b = rows[1]; c = rows[2]; d = rows[3];
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+		}
+
+		static void Untranspose(Reg a, Reg b, Reg c, Reg d, Row* rows)
+		{
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			rows[0] = a; rows[1] = b; rows[2] = c; rows[3] = d;
+		}
+
+		static Reg Zero() { return _mm_setzero_ps(); }
+		static Reg Add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+		static Reg Sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+		static Reg Mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+		static Reg Sqrt(Reg a) { return _mm_sqrt_ps(a); }
+
+		static Reg SafeReciprocal(Reg a)
+		{
+			__m128 nonZero = _mm_cmpneq_ps(a, _mm_setzero_ps());
+			return _mm_and_ps(nonZero, _mm_div_ps(_mm_set1_ps(1.0f), a));
+		}
+
+		static Reg Sign(Reg a)
+		{
+			__m128 negative = _mm_cmplt_ps(a, _mm_setzero_ps());
+			return _mm_or_ps(_mm_and_ps(negative, _mm_set1_ps(-1.0f)), _mm_andnot_ps(negative, _mm_set1_ps(1.0f)));
+		}
+	};
+#endif
+
+#ifdef NUBIX_TANGENTS_AVX2
+	struct AVX2Lanes
+	{
+		typedef __m256 Reg;
+		typedef __m128 Row;
+		static const int Width = 8;
+
+		static Row LoadRow(const float* p) { return _mm_loadu_ps(p); }
+		static void StoreRow(float* p, Row r) { _mm_storeu_ps(p, r); }
+		static Row AddRow(Row a, Row b) { return _mm_add_ps(a, b); }
+
+		// Same shuffles as _MM_TRANSPOSE4_PS, but on rows 0-3
+		// and rows 4-7 at once (one in each 128-bit half)
+		static void Transpose4x4Halves(Reg& a, Reg& b, Reg& c, Reg& d)
+		{
+			__m256 t0 = _mm256_unpacklo_ps(a, b);
+			__m256 t1 = _mm256_unpacklo_ps(c, d);
+			__m256 t2 = _mm256_unpackhi_ps(a, b);
+			__m256 t3 = _mm256_unpackhi_ps(c, d);
+			a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			c = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			d = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		static Reg Pair(Row low, Row high) { return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1); }
+
+		static void Transpose(const Row* rows, Reg& a, Reg& b, Reg& c, Reg& d)
+		{
+			a = Pair(rows[0], rows[4]);
+			b = Pair(rows[1], rows[5]);
+			c = Pair(rows[2], rows[6]);
+			d = Pair(rows[3], rows[7]);
+			Transpose4x4Halves(a, b, c, d);
+		}
+
+		static void Untranspose(Reg a, Reg b, Reg c, Reg d, Row* rows)
+		{
+			Transpose4x4Halves(a, b, c, d);
+			rows[0] = _mm256_castps256_ps128(a); rows[4] = _mm256_extractf128_ps(a, 1);
+			rows[1] = _mm256_castps256_ps128(b); rows[5] = _mm256_extractf128_ps(b, 1);
+			rows[2] = _mm256_castps256_ps128(c); rows[6] = _mm256_extractf128_ps(c, 1);
+			rows[3] = _mm256_castps256_ps128(d); rows[7] = _mm256_extractf128_ps(d, 1);
+		}
+
+		static Reg Zero() { return _mm256_setzero_ps(); }
+		static Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+		static Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+		static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+		static Reg Sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+
+		static Reg SafeReciprocal(Reg a)
+		{
+			__m256 nonZero = _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+			return _mm256_and_ps(nonZero, _mm256_div_ps(_mm256_set1_ps(1.0f), a));
+		}
+
+		static Reg Sign(Reg a)
+		{
+			__m256 negative = _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_LT_OQ);
+			return _mm256_blendv_ps(_mm256_set1_ps(1.0f), _mm256_set1_ps(-1.0f), negative);
+		}
+	};
+#endif
+
+	// --------------------------------------------------------
+	// SIMD version of AccumulateTangentsScalar(), which handles
+	// Lanes::Width triangles at a time.  The math is vectorized;
+	// adding the results can't be, since triangles share
+	// vertices.
+	//
+	// firstTriangle, lastTriangle - Range of whole triangles to
+	//                               process (a multiple of Width)
+	// sums - Sums for vertices firstSum and up
+	// --------------------------------------------------------
+	template<typename Lanes>
+	void AccumulateTangents(const Vertex* verts, const unsigned int* indices, size_t firstTriangle, size_t lastTriangle, TangentSum* sums, unsigned int firstSum)
+	{
+		typedef typename Lanes::Reg Reg;
+		typedef typename Lanes::Row Row;
+		const int W = Lanes::Width;
+
+		for (size_t triangle = firstTriangle; triangle < lastTriangle; triangle += W)
+		{
+			const unsigned int* tri = &indices[triangle * 3];
+
+			// Load each corner as (x, y, z, u) and (u, v, nx, ny)
+			// rows, and turn those into one Reg per component
+			Reg px[3], py[3], pz[3], u[3], v[3];
+			for (int c = 0; c < 3; c++)
+			{
+				Row positionRows[W];
+				Row uvRows[W];
+				for (int l = 0; l < W; l++)
+				{
+					const Vertex& vert = verts[tri[l * 3 + c]];
+					positionRows[l] = Lanes::LoadRow(&vert.Position.x);
+					uvRows[l] = Lanes::LoadRow(&vert.UV.x);
+				}
+
+				Reg unused0, unused1, unused2;
+				Lanes::Transpose(positionRows, px[c], py[c], pz[c], u[c]);
+				Lanes::Transpose(uvRows, unused0, v[c], unused1, unused2);
+			}
+
+			// Vectors relative to the triangle's first corner
+			Reg x1 = Lanes::Sub(px[1], px[0]), y1 = Lanes::Sub(py[1], py[0]), z1 = Lanes::Sub(pz[1], pz[0]);
+			Reg x2 = Lanes::Sub(px[2], px[0]), y2 = Lanes::Sub(py[2], py[0]), z2 = Lanes::Sub(pz[2], pz[0]);
+			Reg s1 = Lanes::Sub(u[1], u[0]), t1 = Lanes::Sub(v[1], v[0]);
+			Reg s2 = Lanes::Sub(u[2], u[0]), t2 = Lanes::Sub(v[2], v[0]);
+
+			// Triangles with degenerate uvs don't contribute
+			Reg r = Lanes::SafeReciprocal(Lanes::Sub(Lanes::Mul(s1, t2), Lanes::Mul(s2, t1)));
+
+			Reg tx = Lanes::Mul(Lanes::Sub(Lanes::Mul(t2, x1), Lanes::Mul(t1, x2)), r);
+			Reg ty = Lanes::Mul(Lanes::Sub(Lanes::Mul(t2, y1), Lanes::Mul(t1, y2)), r);
+			Reg tz = Lanes::Mul(Lanes::Sub(Lanes::Mul(t2, z1), Lanes::Mul(t1, z2)), r);
+			Reg bx = Lanes::Mul(Lanes::Sub(Lanes::Mul(s1, x2), Lanes::Mul(s2, x1)), r);
+			Reg by = Lanes::Mul(Lanes::Sub(Lanes::Mul(s1, y2), Lanes::Mul(s2, y1)), r);
+			Reg bz = Lanes::Mul(Lanes::Sub(Lanes::Mul(s1, z2), Lanes::Mul(s2, z1)), r);
+
+			// Back to one row per triangle, then add to each corner's sums
+			Row tangentRows[W];
+			Row bitangentRows[W];
+			Lanes::Untranspose(tx, ty, tz, Lanes::Zero(), tangentRows);
+			Lanes::Untranspose(bx, by, bz, Lanes::Zero(), bitangentRows);
+
+			for (int l = 0; l < W; l++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					TangentSum& sum = sums[tri[l * 3 + c] - firstSum];
+					Lanes::StoreRow(&sum.tx, Lanes::AddRow(Lanes::LoadRow(&sum.tx), tangentRows[l]));
+					Lanes::StoreRow(&sum.bx, Lanes::AddRow(Lanes::LoadRow(&sum.bx), bitangentRows[l]));
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// SIMD version of FinalizeTangentsScalar(), which handles
+	// Lanes::Width vertices at a time
+	//
+	// first, last - Range of vertices (a multiple of Width)
+	// --------------------------------------------------------
+	template<typename Lanes>
+	void FinalizeTangents(Vertex* verts, size_t first, size_t last, const TangentSum* sums)
+	{
+		typedef typename Lanes::Reg Reg;
+		typedef typename Lanes::Row Row;
+		const int W = Lanes::Width;
+
+		for (size_t i = first; i < last; i += W)
+		{
+			Row normalRows[W];
+			Row tangentRows[W];
+			Row bitangentRows[W];
+			for (int l = 0; l < W; l++)
+			{
+				normalRows[l] = Lanes::LoadRow(&verts[i + l].Normal.x);
+				tangentRows[l] = Lanes::LoadRow(&sums[i + l].tx);
+				bitangentRows[l] = Lanes::LoadRow(&sums[i + l].bx);
+			}
+
+			Reg nx, ny, nz, tx, ty, tz, bx, by, bz, unused;
+			Lanes::Transpose(normalRows, nx, ny, nz, unused);
+			Lanes::Transpose(tangentRows, tx, ty, tz, unused);
+			Lanes::Transpose(bitangentRows, bx, by, bz, unused);
+
+			// Gram-Schmidt orthogonalize
+			Reg d = Lanes::Add(Lanes::Add(Lanes::Mul(nx, tx), Lanes::Mul(ny, ty)), Lanes::Mul(nz, tz));
+			tx = Lanes::Sub(tx, Lanes::Mul(nx, d));
+			ty = Lanes::Sub(ty, Lanes::Mul(ny, d));
+			tz = Lanes::Sub(tz, Lanes::Mul(nz, d));
+
+			// Normalize (leaving degenerate tangents as zero)
+			Reg lengthSq = Lanes::Add(Lanes::Add(Lanes::Mul(tx, tx), Lanes::Mul(ty, ty)), Lanes::Mul(tz, tz));
+			Reg scale = Lanes::SafeReciprocal(Lanes::Sqrt(lengthSq));
+			tx = Lanes::Mul(tx, scale);
+			ty = Lanes::Mul(ty, scale);
+			tz = Lanes::Mul(tz, scale);
+
+			// Mirrored uvs make the bitangent point against cross(n, t)
+			Reg cx = Lanes::Sub(Lanes::Mul(ny, tz), Lanes::Mul(nz, ty));
+			Reg cy = Lanes::Sub(Lanes::Mul(nz, tx), Lanes::Mul(nx, tz));
+			Reg cz = Lanes::Sub(Lanes::Mul(nx, ty), Lanes::Mul(ny, tx));
+			Reg handedness = Lanes::Add(Lanes::Add(Lanes::Mul(cx, bx), Lanes::Mul(cy, by)), Lanes::Mul(cz, bz));
+
+			Row resultRows[W];
+			Lanes::Untranspose(tx, ty, tz, Lanes::Sign(handedness), resultRows);
+			for (int l = 0; l < W; l++)
+				Lanes::StoreRow(&verts[i + l].Tangent.x, resultRows[l]);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Runs either half of the tangent calculation over any
+	// range with one SIMD instruction set, using the scalar
+	// version for whatever doesn't fill a whole register
+	// --------------------------------------------------------
+	template<typename Lanes>
+	void AccumulateTangentsWith(const Vertex* verts, const unsigned int* indices, size_t firstTriangle, size_t lastTriangle, TangentSum* sums, unsigned int firstSum)
+	{
+		size_t wholeEnd = lastTriangle - (lastTriangle - firstTriangle) % Lanes::Width;
+		AccumulateTangents<Lanes>(verts, indices, firstTriangle, wholeEnd, sums, firstSum);
+		AccumulateTangentsScalar(verts, indices, wholeEnd, lastTriangle, sums, firstSum);
+	}
+
+	template<typename Lanes>
+	void FinalizeTangentsWith(Vertex* verts, size_t first, size_t last, const TangentSum* sums)
+	{
+		size_t wholeEnd = last - (last - first) % Lanes::Width;
+		FinalizeTangents<Lanes>(verts, first, wholeEnd, sums);
+		FinalizeTangentsScalar(verts, wholeEnd, last, sums);
+	}
+
+	// The two halves of the tangent calculation for one instruction set
+	struct TangentFunctions
+	{
+		void (*accumulate)(const Vertex* verts, const unsigned int* indices, size_t firstTriangle, size_t lastTriangle, TangentSum* sums, unsigned int firstSum);
+		void (*finalize)(Vertex* verts, size_t first, size_t last, const TangentSum* sums);
+	};
+
+	// --------------------------------------------------------
+	// Runs func(0) through func(count - 1) at the same time,
+	// with the calling thread taking func(0) itself
+	// --------------------------------------------------------
+	template<typename Func>
+	void RunOnThreads(unsigned int count, const Func& func)
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(count - 1);
+		for (unsigned int i = 1; i < count; i++)
+			workers.push_back(std::thread([&func, i]() { func(i); }));
+
+		func(0);
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	// One thread's share of a parallel tangent calculation.  Its
+	// sums only cover the vertices its triangles actually use,
+	// which for most meshes is a small window of the whole.
+	struct PartialTangentSums
+	{
+		unsigned int firstVertex;
+		unsigned int lastVertex;
+		std::vector<TangentSum> sums;
+	};
+
+	// --------------------------------------------------------
+	// Calculates tangents with several threads.  Each thread
+	// accumulates its share of the triangles into its own sums,
+	// then each thread adds up every share's sums for its own
+	// range of vertices and finalizes them.
+	// --------------------------------------------------------
+	void CalculateTangentsParallel(Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t triangleCount, const TangentFunctions& functions, unsigned int threadCount)
+	{
+		std::vector<PartialTangentSums> partials(threadCount);
+
+		// Accumulate each share of the triangles
+		RunOnThreads(threadCount, [&](unsigned int t)
+		{
+			size_t firstTriangle = triangleCount * t / threadCount;
+			size_t lastTriangle = triangleCount * (t + 1) / threadCount;
+			PartialTangentSums& partial = partials[t];
+			if (firstTriangle == lastTriangle)
+			{
+				partial.firstVertex = partial.lastVertex = 0;
+				return;
+			}
+
+			// Which vertices do these triangles use?
+			unsigned int lowest = indices[firstTriangle * 3];
+			unsigned int highest = lowest;
+			for (size_t i = firstTriangle * 3; i < lastTriangle * 3; i++)
+			{
+				if (indices[i] < lowest) lowest = indices[i];
+				if (indices[i] > highest) highest = indices[i];
+			}
+
+			partial.firstVertex = lowest;
+			partial.lastVertex = highest + 1;
+			partial.sums.assign(partial.lastVertex - partial.firstVertex, TangentSum());
+			functions.accumulate(verts, indices, firstTriangle, lastTriangle, &partial.sums[0], lowest);
+		});
+
+		// Combine the shares and finalize, one range of vertices per thread
+		RunOnThreads(threadCount, [&](unsigned int t)
+		{
+			size_t first = vertexCount * t / threadCount;
+			size_t last = vertexCount * (t + 1) / threadCount;
+			if (first == last)
+				return;
+
+			std::vector<TangentSum> sums(last - first, TangentSum());
+			for (const PartialTangentSums& partial : partials)
+			{
+				size_t overlapStart = first > partial.firstVertex ? first : partial.firstVertex;
+				size_t overlapEnd = last < partial.lastVertex ? last : partial.lastVertex;
+				for (size_t v = overlapStart; v < overlapEnd; v++)
+				{
+					const TangentSum& from = partial.sums[v - partial.firstVertex];
+					TangentSum& to = sums[v - first];
+					to.tx += from.tx; to.ty += from.ty; to.tz += from.tz;
+					to.bx += from.bx; to.by += from.by; to.bz += from.bz;
+				}
+			}
+
+			functions.finalize(verts + first, 0, last - first, &sums[0]);
+		});
+	}
+
+	// --------------------------------------------------------
+	// Checks that both the CPU and the OS support AVX2
+	// --------------------------------------------------------
+	bool CpuSupportsAVX2()
+	{
+#if !defined(NUBIX_TANGENTS_AVX2)
+		return false;
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		__cpuidex(info, 7, 0);
+		return osSavesYmm && avx && (info[1] & (1 << 5)) != 0;
+#else
+		// Only built when the whole file targets AVX2
+		return true;
+#endif
+	}
+}
+
+
+// --------------------------------------------------------
+// Whether this build and CPU can run a tangent kernel
+// --------------------------------------------------------
+bool IsTangentKernelSupported(TangentKernel kernel)
+{
+	switch (kernel)
+	{
+	case TangentKernel_Auto:
+	case TangentKernel_Scalar:
+		return true;
+#ifdef NUBIX_TANGENTS_SSE
+	case TangentKernel_SSE:
+		return true;
+#endif
+	case TangentKernel_AVX2:
+	{
+		static const bool supported = CpuSupportsAVX2();
+		return supported;
+	}
+	default:
+		return false;
+	}
+}
+
+// --------------------------------------------------------
+// Calculates the tangents of the vertices in a mesh.  Each
+// tangent's w is set to the sign of the bitangent (-1 where
+// the uvs are mirrored), so shaders can rebuild the bitangent
+// as cross(T, N) * w.
+//
+// Multithreaded results add the triangles up in a different
+// order, so they can differ from single-threaded results in
+// the last few bits.
+//
+// verts - Vertices to update (positions, uvs and normals must be set)
+// numVerts - How many vertices
+// indices - Triangle list indices into verts
+// numIndices - How many indices
+// kernel - Which instruction set to use (Auto picks the widest available)
+// threadCount - Threads to use (0 picks automatically based on the size)
+// --------------------------------------------------------
+void CalculateTangents(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, TangentKernel kernel, unsigned int threadCount)
+{
+	if (numVerts <= 0)
+		return;
+
+	if (kernel == TangentKernel_Auto)
+	{
+		kernel =
+			IsTangentKernelSupported(TangentKernel_AVX2) ? TangentKernel_AVX2 :
+			IsTangentKernelSupported(TangentKernel_SSE) ? TangentKernel_SSE :
+			TangentKernel_Scalar;
+	}
+	else if (!IsTangentKernelSupported(kernel))
+	{
+		kernel = TangentKernel_Scalar;
+	}
+
+	TangentFunctions functions = { AccumulateTangentsScalar, FinalizeTangentsScalar };
+	switch (kernel)
+	{
+#ifdef NUBIX_TANGENTS_AVX2
+	case TangentKernel_AVX2:
+		functions.accumulate = AccumulateTangentsWith<AVX2Lanes>;
+		functions.finalize = FinalizeTangentsWith<AVX2Lanes>;
+		break;
+#endif
+#ifdef NUBIX_TANGENTS_SSE
+	case TangentKernel_SSE:
+		functions.accumulate = AccumulateTangentsWith<SSELanes>;
+		functions.finalize = FinalizeTangentsWith<SSELanes>;
+		break;
+#endif
+	default:
+		break;
+	}
+
+	size_t vertexCount = (size_t)numVerts;
+	size_t triangleCount = numIndices > 0 ? (size_t)numIndices / 3 : 0;
+
+	// Small meshes aren't worth the cost of starting threads
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = triangleCount >= TangentParallelThresholdInTriangles && hardwareThreads > 0 ? hardwareThreads : 1;
+	}
+
+	if (threadCount > 1 && triangleCount >= threadCount)
+	{
+		CalculateTangentsParallel(verts, vertexCount, indices, triangleCount, functions, threadCount);
+		return;
+	}
+
+	std::vector<TangentSum> sums(vertexCount, TangentSum());
+	functions.accumulate(verts, indices, 0, triangleCount, &sums[0], 0);
+	functions.finalize(verts, 0, vertexCount, &sums[0]);
+}
+
+
+// --------------------------------------------------------
+// Scores a vertex for OptimizeVertexCache().  Vertices that
+// are already in the cache score higher (the most recent
+// triangle's three vertices score a flat amount so we don't
+// just keep fanning around them), and vertices with few
+// triangles left get a boost so they're finished off.
+//
+// cachePosition - Position in the simulated cache (-1 if not in it)
+// remainingTriangles - Triangles still to be drawn that use this vertex
+// --------------------------------------------------------
+static float VertexCacheScore(int cachePosition, unsigned int remainingTriangles)
+{
+	// Nothing left to draw with this vertex
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			score = 0.75f;
+		}
+		else
+		{
+			float scaled = 1.0f - (cachePosition - 3) / (float)(VertexCacheSize - 3);
+			score = powf(scaled, 1.5f);
+		}
+	}
+
+	// Favor vertices with only a few triangles left
+	score += 2.0f / sqrtf((float)remainingTriangles);
+	return score;
+}
+
+// --------------------------------------------------------
+// Reorders the triangles of an indexed triangle list so
+// that consecutive triangles reuse recently transformed
+// vertices, using Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation".  The vertices themselves don't move.
+//
+// indices - Triangle list to reorder in place
+// indexCount - How many indices (a multiple of 3)
+// vertexCount - How many vertices the indices reference
+// --------------------------------------------------------
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Build the vertex -> triangle adjacency, stored as one
+	// flat array with a range of triangles per vertex
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	{
+		std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// Initial scores, with nothing in the cache
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = VertexCacheScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> triangleAdded(triangleCount, false);
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] =
+			vertexScore[indices[t * 3 + 0]] +
+			vertexScore[indices[t * 3 + 1]] +
+			vertexScore[indices[t * 3 + 2]];
+
+		if (triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			bestTriangle = (int)t;
+		}
+	}
+
+	// The simulated cache (with room for the three vertices being pushed in)
+	unsigned int cache[VertexCacheSize + 3];
+	int cacheCount = 0;
+	size_t scanCursor = 0;
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	for (size_t emitted = 0; emitted < triangleCount; emitted++)
+	{
+		// Nothing in the cache touches a remaining triangle,
+		// so just take the next one that hasn't been drawn
+		if (bestTriangle < 0)
+		{
+			while (triangleAdded[scanCursor]) scanCursor++;
+			bestTriangle = (int)scanCursor;
+		}
+
+		// Draw this triangle and remove it from each vertex's adjacency
+		const unsigned int* tri = &indices[bestTriangle * 3];
+		triangleAdded[bestTriangle] = true;
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			output.push_back(v);
+
+			unsigned int* begin = &adjacency[adjacencyStart[v]];
+			unsigned int* end = begin + remaining[v];
+			for (unsigned int* a = begin; a < end; a++)
+			{
+				if (*a == (unsigned int)bestTriangle)
+				{
+					*a = *(end - 1);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Push the triangle's vertices to the front of the cache,
+		// followed by everything that was already there
+		unsigned int newCache[VertexCacheSize + 3];
+		int newCount = 0;
+		for (int c = 0; c < 3; c++)
+			newCache[newCount++] = tri[c];
+		for (int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Update vertex scores, including any that just fell out
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < VertexCacheSize ? i : -1;
+			vertexScore[v] = VertexCacheScore(cachePosition[v], remaining[v]);
+		}
+
+		cacheCount = newCount < VertexCacheSize ? newCount : VertexCacheSize;
+		for (int i = 0; i < cacheCount; i++)
+			cache[i] = newCache[i];
+
+		// Rescore the triangles touching those vertices and pick the best one
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			for (unsigned int a = adjacencyStart[v]; a < adjacencyStart[v] + remaining[v]; a++)
+			{
+				unsigned int t = adjacency[a];
+				triangleScore[t] =
+					vertexScore[indices[t * 3 + 0]] +
+					vertexScore[indices[t * 3 + 1]] +
+					vertexScore[indices[t * 3 + 2]];
+
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = (int)t;
+				}
+			}
+		}
+	}
+
+	// Replace the original order
+	for (size_t i = 0; i < output.size(); i++)
+		indices[i] = output[i];
+}
+
+
+// --------------------------------------------------------
+// Reorders the triangles of an already cache optimized
+// triangle list to cut down on overdraw, loosely following
+// "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw" (Sander et al.).  The list is split into clusters
+// wherever the cache order already starts over (a triangle
+// whose vertices are all cache misses), so moving whole
+// clusters around costs almost nothing in cache efficiency.
+// Clusters that face away from the middle of the mesh are
+// usually in front of the rest of it, so they're drawn first
+// and the depth test rejects more of what follows.
+//
+// verts - Vertices the indices reference
+// vertexCount - How many vertices
+// indices - Triangle list to reorder in place
+// indexCount - How many indices (a multiple of 3)
+// --------------------------------------------------------
+void OptimizeOverdraw(const Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	// Find the cluster boundaries with the same FIFO cache that
+	// AnalyzeVertexCache() uses.  Hard boundaries are where the
+	// order already starts over.  Clusters are also cut short
+	// (starting the cache over) as soon as their own miss ratio
+	// is close enough to the whole mesh's, which gives the sort
+	// below much more to work with.
+	const float targetACMR = AnalyzeVertexCache(indices, indexCount, vertexCount).acmr * OverdrawCacheThreshold;
+	const size_t minClusterSize = 8;
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = VertexCacheFifoSize + 1;
+	std::vector<size_t> clusterStarts;
+	unsigned int clusterMisses = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		int misses = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			if (time - cacheTime[v] > (unsigned int)VertexCacheFifoSize)
+			{
+				cacheTime[v] = time++;
+				misses++;
+			}
+		}
+
+		if (t == 0 || (misses == 3 && clusterStarts.back() != t))
+		{
+			clusterStarts.push_back(t);
+			clusterMisses = 0;
+		}
+		clusterMisses += misses;
+
+		// Soft boundary after this triangle?
+		size_t clusterSize = t + 1 - clusterStarts.back();
+		if (clusterSize >= minClusterSize && t + 1 < triangleCount &&
+			(float)clusterMisses / clusterSize <= targetACMR)
+		{
+			clusterStarts.push_back(t + 1);
+			clusterMisses = 0;
+			time += VertexCacheFifoSize + 1;
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	const size_t clusterCount = clusterStarts.size() - 1;
+	if (clusterCount < 2)
+		return;
+
+	// The middle of the mesh, weighting each triangle by its area
+	struct Cluster
+	{
+		size_t first, last;
+		float sort;
+	};
+
+	XMFLOAT3 meshCentroid(0, 0, 0);
+	float meshArea = 0.0f;
+	std::vector<Cluster> clusters(clusterCount);
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+	std::vector<XMFLOAT3> clusterNormals(clusterCount);
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMFLOAT3 centroid(0, 0, 0);
+		XMFLOAT3 normal(0, 0, 0);
+		float area = 0.0f;
+
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			const XMFLOAT3& p0 = verts[indices[t * 3 + 0]].Position;
+			const XMFLOAT3& p1 = verts[indices[t * 3 + 1]].Position;
+			const XMFLOAT3& p2 = verts[indices[t * 3 + 2]].Position;
+
+			float x1 = p1.x - p0.x, y1 = p1.y - p0.y, z1 = p1.z - p0.z;
+			float x2 = p2.x - p0.x, y2 = p2.y - p0.y, z2 = p2.z - p0.z;
+
+			// Clockwise front faces (D3D's default), so this points outward
+			float nx = y1 * z2 - z1 * y2;
+			float ny = z1 * x2 - x1 * z2;
+			float nz = x1 * y2 - y1 * x2;
+			float triangleArea = sqrtf(nx * nx + ny * ny + nz * nz);
+
+			centroid.x += (p0.x + p1.x + p2.x) * triangleArea;
+			centroid.y += (p0.y + p1.y + p2.y) * triangleArea;
+			centroid.z += (p0.z + p1.z + p2.z) * triangleArea;
+			normal.x += nx;
+			normal.y += ny;
+			normal.z += nz;
+			area += triangleArea;
+		}
+
+		meshCentroid.x += centroid.x;
+		meshCentroid.y += centroid.y;
+		meshCentroid.z += centroid.z;
+		meshArea += area;
+
+		float scale = area > 0.0f ? 1.0f / (area * 3.0f) : 0.0f;
+		clusterCentroids[c] = XMFLOAT3(centroid.x * scale, centroid.y * scale, centroid.z * scale);
+		clusterNormals[c] = normal;
+		clusters[c].first = clusterStarts[c];
+		clusters[c].last = clusterStarts[c + 1];
+	}
+
+	float meshScale = meshArea > 0.0f ? 1.0f / (meshArea * 3.0f) : 0.0f;
+	meshCentroid = XMFLOAT3(meshCentroid.x * meshScale, meshCentroid.y * meshScale, meshCentroid.z * meshScale);
+
+	// Score each cluster by how much it faces away from the middle
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const XMFLOAT3& n = clusterNormals[c];
+		float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+		clusters[c].sort =
+			((clusterCentroids[c].x - meshCentroid.x) * n.x +
+			(clusterCentroids[c].y - meshCentroid.y) * n.y +
+			(clusterCentroids[c].z - meshCentroid.z) * n.z) * scale;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sort > b.sort; });
+
+	// Rebuild the list one cluster at a time
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	for (const Cluster& cluster : clusters)
+		output.insert(output.end(), indices + cluster.first * 3, indices + cluster.last * 3);
+
+	for (size_t i = 0; i < output.size(); i++)
+		indices[i] = output[i];
+}
+
+
+// --------------------------------------------------------
+// Reorders vertices into the order the index buffer first
+// uses them, so the GPU reads the vertex buffer roughly
+// front to back instead of jumping around.  Vertices that
+// no index uses are dropped off the end.
+//
+// verts - Vertices to reorder in place
+// vertexCount - How many vertices
+// indices - Triangle list to remap in place
+// indexCount - How many indices
+// Returns the number of vertices still in use
+// --------------------------------------------------------
+size_t OptimizeVertexFetch(Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertexCount);
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+		{
+			newIndex = (unsigned int)reordered.size();
+			reordered.push_back(verts[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+
+	for (size_t v = 0; v < reordered.size(); v++)
+		verts[v] = reordered[v];
+
+	return reordered.size();
+}
+
+
+// --------------------------------------------------------
+// Runs every optimization in the order they depend on each
+// other: triangle order for the cache, then clusters for
+// overdraw, then vertex order to match the final indices.
+//
+// verts - Vertices to reorder (and trim if any are unused)
+// indices - Triangle list to reorder and remap
+// --------------------------------------------------------
+void OptimizeMesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	if (verts.empty() || indices.empty())
+		return;
+
+	OptimizeVertexCache(&indices[0], indices.size(), verts.size());
+	OptimizeOverdraw(&verts[0], verts.size(), &indices[0], indices.size());
+	verts.resize(OptimizeVertexFetch(&verts[0], verts.size(), &indices[0], indices.size()));
+}
+
+
+// --------------------------------------------------------
+// Measures how an index buffer would use a FIFO post-
+// transform cache of the given size.  This needs nothing
+// but the indices, so it can check optimizations without
+// a GPU.
+//
+// indices - Triangle list to measure
+// indexCount - How many indices
+// vertexCount - How many vertices the indices reference
+// cacheSize - Entries in the simulated cache
+// --------------------------------------------------------
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+	VertexCacheStats stats = {};
+
+	// A vertex is in the cache if it was added within the last cacheSize misses
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = (unsigned int)cacheSize + 1;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (time - cacheTime[v] > (unsigned int)cacheSize)
+		{
+			cacheTime[v] = time++;
+			stats.verticesTransformed++;
+		}
+	}
+
+	size_t triangleCount = indexCount / 3;
+	stats.acmr = triangleCount > 0 ? (float)stats.verticesTransformed / triangleCount : 0.0f;
+	stats.atvr = vertexCount > 0 ? (float)stats.verticesTransformed / vertexCount : 0.0f;
+	return stats;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// CPU-side mesh processing shared by the engine and the
+// offline cooker.  None of this touches the GPU, so it
+// builds anywhere DirectXMath does.
+// --------------------------------------------------------
+
+// Size of the simulated post-transform cache that
+// OptimizeVertexCache() optimizes for
+const int VertexCacheSize = 32;
+
+// Instruction sets the tangent calculation can use
+enum TangentKernel
+{
+	TangentKernel_Auto,		// Widest one the CPU supports
+	TangentKernel_Scalar,
+	TangentKernel_SSE,		// 4 triangles at a time
+	TangentKernel_AVX2,		// 8 triangles at a time
+};
+
+// Whether this build and CPU can run the given kernel
+bool IsTangentKernelSupported(TangentKernel kernel);
+
+// Meshes with fewer triangles than this always calculate their
+// tangents on a single thread when the thread count is automatic
+const size_t TangentParallelThresholdInTriangles = 250000;
+
+// Calculates per-vertex tangents (with the bitangent sign in w) for an indexed triangle list
+void CalculateTangents(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, TangentKernel kernel = TangentKernel_Auto, unsigned int threadCount = 0);
+
+// Size of the FIFO cache AnalyzeVertexCache() simulates,
+// which is closer to how real GPUs behave than an LRU
+const int VertexCacheFifoSize = 16;
+
+// How much worse (as a multiple) than the cache optimized
+// order OptimizeOverdraw() may make the cache miss ratio
+const float OverdrawCacheThreshold = 1.05f;
+
+// --------------------------------------------------------
+// How well an index buffer uses the post-transform cache
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int verticesTransformed;	// Cache misses
+	float acmr;		// Average cache miss ratio: misses per triangle (0.5 is ideal, 3 is worst)
+	float atvr;		// Average transform to vertex ratio: misses per vertex (1 is ideal)
+};
+
+// Reorders triangles (in place) so that they reuse recently transformed vertices
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// Reorders clusters of triangles (in place) so outward facing ones draw first, reducing overdraw
+void OptimizeOverdraw(const Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount);
+
+// Reorders vertices (in place) into the order the indices first use them, returning how many are used
+size_t OptimizeVertexFetch(Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount);
+
+// Runs all of the above in the right order, dropping unused vertices
+void OptimizeMesh(std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+// Simulates a FIFO post-transform cache to measure an index buffer
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize = VertexCacheFifoSize);
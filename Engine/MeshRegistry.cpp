@@ -0,0 +1,84 @@
+#include "MeshRegistry.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+#include <cwctype>
+#include <future>
+
+// --------------------------------------------------------
+// Lower case with forward slashes, so different spellings
+// of the same path find the same mesh
+// --------------------------------------------------------
+static std::wstring NormalizePath(const std::wstring& path)
+{
+	std::wstring normalized = path;
+	for (wchar_t& c : normalized)
+		c = c == L'\\' ? L'/' : (wchar_t)towlower(c);
+
+	return normalized;
+}
+
+// --------------------------------------------------------
+// Gets the mesh for a model, starting a background load if
+// this is the first time it's been asked for.  Never blocks
+// on parsing or processing, though hashing a new model's
+// source happens here so duplicates can be found right away.
+//
+// objFile - The source model
+// --------------------------------------------------------
+std::shared_ptr<Mesh> MeshRegistry::Load(const std::wstring& objFile)
+{
+	std::wstring key = NormalizePath(objFile);
+	auto existing = byPath.find(key);
+	if (existing != byPath.end())
+	{
+		pathHits++;
+		return existing->second;
+	}
+
+	// A new path might still be a model we already have
+	bool hashed = false;
+	uint64_t sourceHash = 0;
+#ifndef NUBIX_COOKED_MESHES_ONLY
+	MappedFile source;
+	if (source.Open(objFile.c_str()))
+	{
+		hashed = true;
+		sourceHash = HashBytes(source.GetData(), source.GetSize());
+
+		auto sameContent = byContent.find(sourceHash);
+		if (sameContent != byContent.end())
+		{
+			contentHits++;
+			byPath[key] = sameContent->second;
+			return sameContent->second;
+		}
+	}
+	source.Close();
+#endif
+
+	// Do the CPU work on another thread; the mesh uploads it when first used
+	std::future<std::unique_ptr<MeshLoadData>> pendingLoad = std::async(std::launch::async,
+		[objFile, hashed, sourceHash]()
+		{
+			std::unique_ptr<MeshLoadData> data(new MeshLoadData());
+			Mesh::LoadData(objFile.c_str(), hashed ? &sourceHash : 0, *data);
+			return data;
+		});
+
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(std::move(pendingLoad));
+	byPath[key] = mesh;
+	if (hashed)
+		byContent[sourceHash] = mesh;
+
+	return mesh;
+}
+
+// --------------------------------------------------------
+// Blocks until every mesh has loaded and uploaded its data
+// --------------------------------------------------------
+void MeshRegistry::WaitForAll()
+{
+	for (auto& entry : byPath)
+		entry.second->WaitUntilLoaded();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// Hands out shared meshes so each model is only loaded and
+// uploaded once.  Meshes are matched by path first, then by
+// the contents of their source file (so copies of a model
+// under different names share one mesh too).
+//
+// New meshes load on background threads: Load() returns
+// right away, and the mesh only blocks whoever first asks
+// it for something (see Mesh::WaitUntilLoaded()).  That
+// first touch has to be on the thread that records GPU
+// uploads, since it's what creates the buffers.
+// --------------------------------------------------------
+class MeshRegistry
+{
+public:
+	std::shared_ptr<Mesh> Load(const std::wstring& objFile);
+
+	// Finishes every pending load, for when a scene needs everything
+	void WaitForAll();
+
+	size_t GetMeshCount() const { return byPath.size(); }
+	unsigned int GetPathHits() const { return pathHits; }
+	unsigned int GetContentHits() const { return contentHits; }
+
+private:
+	std::unordered_map<std::wstring, std::shared_ptr<Mesh>> byPath;
+	std::unordered_map<uint64_t, std::shared_ptr<Mesh>> byContent;
+	unsigned int pathHits = 0;
+	unsigned int contentHits = 0;
+};
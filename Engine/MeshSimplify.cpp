@@ -0,0 +1,467 @@
+#include "MeshSimplify.h"
+#include "MeshProcessing.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// A quadric error metric (Garland and Heckbert): the sum of
+	// squared distances to a set of planes, each weighted by
+	// the area of the triangle it came from.  Kept in doubles
+	// since large scenes square some large coordinates.
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double a2, b2, c2, ab, ac, bc;
+		double ad, bd, cd, d2;
+		double weight;
+
+		void Clear()
+		{
+			memset(this, 0, sizeof(Quadric));
+		}
+
+		void AddPlane(double a, double b, double c, double d, double w)
+		{
+			a2 += a * a * w; b2 += b * b * w; c2 += c * c * w;
+			ab += a * b * w; ac += a * c * w; bc += b * c * w;
+			ad += a * d * w; bd += b * d * w; cd += c * d * w;
+			d2 += d * d * w;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a2 += q.a2; b2 += q.b2; c2 += q.c2;
+			ab += q.ab; ac += q.ac; bc += q.bc;
+			ad += q.ad; bd += q.bd; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+
+		// Weighted sum of squared distances from p to every plane
+		double Evaluate(const XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double result =
+				a2 * x * x + b2 * y * y + c2 * z * z +
+				2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+				2.0 * (ad * x + bd * y + cd * z) +
+				d2;
+
+			return result > 0.0 ? result : 0.0;
+		}
+	};
+
+	// A possible collapse of one vertex onto a neighbor
+	struct Collapse
+	{
+		unsigned int source;
+		unsigned int target;
+		float cost;		// Mean squared distance the surface would move
+	};
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	// --------------------------------------------------------
+	// Simplifies a mesh by repeatedly collapsing vertices onto
+	// one of their neighbors (half-edge collapses), so the
+	// results only ever reference the original vertices.  Its
+	// state carries over between calls to SimplifyTo(), which
+	// is how each level of detail builds on the last one.
+	//
+	// Vertices on open borders, on uv/normal seams (a position
+	// shared by several vertices) or on non-manifold edges are
+	// locked in place, so seams and silhouettes never tear.
+	// Other vertices can still collapse onto locked ones.
+	// --------------------------------------------------------
+	class Simplifier
+	{
+	public:
+		Simplifier(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount) :
+			verts(verts),
+			vertexCount(vertexCount),
+			indices(indices, indices + indexCount - indexCount % 3),
+			quadrics(vertexCount),
+			locked(vertexCount, false),
+			error(0.0f)
+		{
+			for (Quadric& q : quadrics)
+				q.Clear();
+
+			FindLockedVertices();
+			AddTrianglePlanes();
+		}
+
+		const std::vector<unsigned int>& GetIndices() const { return indices; }
+		float GetError() const { return error; }
+
+		// --------------------------------------------------------
+		// Collapses the cheapest vertices in passes until there
+		// are at most targetIndexCount indices, or nothing else
+		// can be collapsed
+		// --------------------------------------------------------
+		void SimplifyTo(size_t targetIndexCount)
+		{
+			while (indices.size() > targetIndexCount)
+			{
+				size_t trianglesToRemove = (indices.size() - targetIndexCount) / 3;
+				if (trianglesToRemove == 0 || !CollapsePass(trianglesToRemove))
+					break;
+			}
+		}
+
+	private:
+		const Vertex* verts;
+		size_t vertexCount;
+		std::vector<unsigned int> indices;
+		std::vector<Quadric> quadrics;
+		std::vector<bool> locked;
+		float error;
+
+		// Vertex -> triangle adjacency for the current indices
+		std::vector<unsigned int> adjacencyStart;
+		std::vector<unsigned int> adjacency;
+
+		const XMFLOAT3& Position(unsigned int v) const { return verts[v].Position; }
+
+		// --------------------------------------------------------
+		// Locks every vertex that sits on a seam, an open border
+		// or a non-manifold edge
+		// --------------------------------------------------------
+		void FindLockedVertices()
+		{
+			// Give every vertex the index of the first vertex
+			// with exactly the same position
+			std::vector<unsigned int> positionId(vertexCount);
+			{
+				std::vector<unsigned int> order(vertexCount);
+				for (size_t v = 0; v < vertexCount; v++)
+					order[v] = (unsigned int)v;
+
+				auto less = [this](unsigned int a, unsigned int b)
+				{
+					const XMFLOAT3& pa = Position(a);
+					const XMFLOAT3& pb = Position(b);
+					if (pa.x != pb.x) return pa.x < pb.x;
+					if (pa.y != pb.y) return pa.y < pb.y;
+					if (pa.z != pb.z) return pa.z < pb.z;
+					return a < b;
+				};
+				std::sort(order.begin(), order.end(), less);
+
+				for (size_t i = 0; i < vertexCount; i++)
+				{
+					const XMFLOAT3& p = Position(order[i]);
+					bool same = i > 0 && memcmp(&p, &Position(order[i - 1]), sizeof(XMFLOAT3)) == 0;
+					positionId[order[i]] = same ? positionId[order[i - 1]] : order[i];
+
+					// Several vertices here means a seam
+					if (same)
+					{
+						locked[order[i]] = true;
+						locked[order[i - 1]] = true;
+					}
+				}
+			}
+
+			// Count how many triangles use each edge (by position, so
+			// seams don't look like borders).  Anything other than
+			// two is a border or a non-manifold edge.
+			std::vector<uint64_t> edges;
+			edges.reserve(indices.size());
+			for (size_t t = 0; t < indices.size(); t += 3)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					uint64_t a = positionId[indices[t + e]];
+					uint64_t b = positionId[indices[t + (e + 1) % 3]];
+					edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+
+			std::vector<bool> lockedPosition(vertexCount, false);
+			for (size_t i = 0; i < edges.size();)
+			{
+				size_t run = i + 1;
+				while (run < edges.size() && edges[run] == edges[i]) run++;
+
+				if (run - i != 2)
+				{
+					lockedPosition[(unsigned int)(edges[i] >> 32)] = true;
+					lockedPosition[(unsigned int)(edges[i] & 0xFFFFFFFF)] = true;
+				}
+				i = run;
+			}
+
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				if (lockedPosition[positionId[v]])
+					locked[v] = true;
+			}
+		}
+
+		// --------------------------------------------------------
+		// Adds each triangle's plane to its corners' quadrics
+		// --------------------------------------------------------
+		void AddTrianglePlanes()
+		{
+			for (size_t t = 0; t < indices.size(); t += 3)
+			{
+				const XMFLOAT3& p0 = Position(indices[t + 0]);
+				XMFLOAT3 normal = Cross(Subtract(Position(indices[t + 1]), p0), Subtract(Position(indices[t + 2]), p0));
+
+				double length = sqrt((double)Dot(normal, normal));
+				if (length <= 0.0)
+					continue;
+
+				double a = normal.x / length;
+				double b = normal.y / length;
+				double c = normal.z / length;
+				double d = -(a * p0.x + b * p0.y + c * p0.z);
+				double area = length * 0.5;
+
+				for (int c0 = 0; c0 < 3; c0++)
+					quadrics[indices[t + c0]].AddPlane(a, b, c, d, area);
+			}
+		}
+
+		// --------------------------------------------------------
+		// Rebuilds the vertex -> triangle adjacency
+		// --------------------------------------------------------
+		void BuildAdjacency()
+		{
+			adjacencyStart.assign(vertexCount + 1, 0);
+			for (unsigned int v : indices)
+				adjacencyStart[v + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				adjacencyStart[v + 1] += adjacencyStart[v];
+
+			adjacency.resize(indices.size());
+			std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+
+		// Mean squared distance moving source onto target would add
+		float CollapseCost(unsigned int source, unsigned int target) const
+		{
+			Quadric q = quadrics[source];
+			q.Add(quadrics[target]);
+			return q.weight > 0.0 ? (float)(q.Evaluate(Position(target)) / q.weight) : 0.0f;
+		}
+
+		// --------------------------------------------------------
+		// Whether moving source onto target would flip any of
+		// the triangles that stay behind
+		// --------------------------------------------------------
+		bool CollapseFlipsTriangles(unsigned int source, unsigned int target) const
+		{
+			for (unsigned int a = adjacencyStart[source]; a < adjacencyStart[source + 1]; a++)
+			{
+				const unsigned int* tri = &indices[adjacency[a] * 3];
+				if (tri[0] == target || tri[1] == target || tri[2] == target)
+					continue;
+
+				XMFLOAT3 p[3];
+				XMFLOAT3 moved[3];
+				for (int c = 0; c < 3; c++)
+				{
+					p[c] = Position(tri[c]);
+					moved[c] = tri[c] == source ? Position(target) : p[c];
+				}
+
+				XMFLOAT3 before = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+				XMFLOAT3 after = Cross(Subtract(moved[1], moved[0]), Subtract(moved[2], moved[0]));
+				if (Dot(before, after) <= 0.0f)
+					return true;
+			}
+
+			return false;
+		}
+
+		// --------------------------------------------------------
+		// Finds the cheapest collapses that don't touch each
+		// other, applies them, and drops the triangles that
+		// became degenerate.  Returns false if nothing could be
+		// collapsed.
+		// --------------------------------------------------------
+		bool CollapsePass(size_t trianglesToRemove)
+		{
+			BuildAdjacency();
+
+			// The cheaper direction of every edge with an unlocked end.
+			// Interior edges show up once in each direction, so only
+			// the one with the smaller index first is used.
+			std::vector<Collapse> collapses;
+			collapses.reserve(indices.size() / 2);
+			for (size_t t = 0; t < indices.size(); t += 3)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					unsigned int a = indices[t + e];
+					unsigned int b = indices[t + (e + 1) % 3];
+					if (a > b || (locked[a] && locked[b]))
+						continue;
+
+					Collapse collapse;
+					float costA = locked[a] ? FLT_MAX : CollapseCost(a, b);
+					float costB = locked[b] ? FLT_MAX : CollapseCost(b, a);
+					collapse.source = costA <= costB ? a : b;
+					collapse.target = costA <= costB ? b : a;
+					collapse.cost = costA <= costB ? costA : costB;
+					collapses.push_back(collapse);
+				}
+			}
+
+			if (collapses.empty())
+				return false;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			// Take the cheapest ones whose neighborhoods don't overlap.
+			// Each collapse removes about two triangles.
+			std::vector<unsigned int> remap(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++)
+				remap[v] = (unsigned int)v;
+
+			std::vector<bool> touched(vertexCount, false);
+			size_t collapseLimit = trianglesToRemove / 2 + 1;
+			size_t applied = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (applied >= collapseLimit)
+					break;
+
+				if (touched[collapse.source] || touched[collapse.target] ||
+					CollapseFlipsTriangles(collapse.source, collapse.target))
+					continue;
+
+				remap[collapse.source] = collapse.target;
+				quadrics[collapse.target].Add(quadrics[collapse.source]);
+				error = std::max(error, sqrtf(collapse.cost));
+				applied++;
+
+				// Nothing else this pass may change these triangles
+				touched[collapse.target] = true;
+				for (unsigned int a = adjacencyStart[collapse.source]; a < adjacencyStart[collapse.source + 1]; a++)
+				{
+					const unsigned int* tri = &indices[adjacency[a] * 3];
+					touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+				}
+			}
+
+			if (applied == 0)
+				return false;
+
+			// Apply the collapses, dropping triangles that lost a corner
+			size_t write = 0;
+			for (size_t t = 0; t < indices.size(); t += 3)
+			{
+				unsigned int a = remap[indices[t + 0]];
+				unsigned int b = remap[indices[t + 1]];
+				unsigned int c = remap[indices[t + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+			return true;
+		}
+	};
+}
+
+
+// --------------------------------------------------------
+// Simplifies a triangle list using quadric error metrics.
+// The results reference the same vertices as the original.
+//
+// verts - The mesh's vertices
+// vertexCount - How many vertices
+// indices - Triangle list to simplify
+// indexCount - How many indices
+// targetIndexCount - Index count to aim for
+// result - Receives the simplified triangle list
+// Returns how far (in object space) the surface moved
+// --------------------------------------------------------
+float SimplifyMesh(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, size_t targetIndexCount, std::vector<unsigned int>& result)
+{
+	if (indexCount < 3)
+	{
+		result.assign(indices, indices + indexCount);
+		return 0.0f;
+	}
+
+	Simplifier simplifier(verts, vertexCount, indices, indexCount);
+	simplifier.SimplifyTo(targetIndexCount);
+	result = simplifier.GetIndices();
+	return simplifier.GetError();
+}
+
+
+// --------------------------------------------------------
+// Builds up to MaxMeshLods levels of detail, each with about
+// half the triangles of the one before, and appends them all
+// to a single index buffer (starting with the original).
+// Each level is simplified further from the previous one and
+// reordered for the vertex cache.
+//
+// verts - The mesh's vertices (shared by every level)
+// vertexCount - How many vertices
+// indices - The full detail triangle list
+// indexCount - How many indices
+// lodIndices - Receives every level's indices, one after another
+// lods - Receives the range and error of each level
+// --------------------------------------------------------
+void BuildMeshLods(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, std::vector<unsigned int>& lodIndices, std::vector<MeshLod>& lods)
+{
+	lodIndices.assign(indices, indices + indexCount);
+	lods.clear();
+
+	MeshLod original = { 0, (uint32_t)indexCount, 0.0f };
+	lods.push_back(original);
+
+	if (indexCount / 3 < MeshLodMinimumTriangles * 2)
+		return;
+
+	Simplifier simplifier(verts, vertexCount, indices, indexCount);
+	while (lods.size() < (size_t)MaxMeshLods)
+	{
+		size_t previousCount = lods.back().indexCount;
+		size_t target = (size_t)(previousCount / 3 * MeshLodReduction) * 3;
+		simplifier.SimplifyTo(target);
+
+		const std::vector<unsigned int>& simplified = simplifier.GetIndices();
+		if (simplified.size() > previousCount * MeshLodMinimumReduction)
+			break;
+
+		MeshLod lod;
+		lod.firstIndex = (uint32_t)lodIndices.size();
+		lod.indexCount = (uint32_t)simplified.size();
+		lod.error = simplifier.GetError();
+		lods.push_back(lod);
+
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+		OptimizeVertexCache(&lodIndices[lod.firstIndex], lod.indexCount, vertexCount);
+
+		if (simplified.size() / 3 < MeshLodMinimumTriangles * 2)
+			break;
+	}
+}
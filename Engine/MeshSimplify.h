@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// One level of detail within a mesh's index buffer.  Every
+// level uses the same vertex buffer, so drawing a level is
+// just drawing a different range of indices.
+// --------------------------------------------------------
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;		// Object space distance the surface moved by (0 for the original)
+};
+
+// Most levels (including the original) BuildMeshLods() makes
+const int MaxMeshLods = 5;
+
+// Each level aims for this fraction of the previous level's triangles
+const float MeshLodReduction = 0.5f;
+
+// Levels that can't get below this fraction of the previous
+// level's triangles (usually because of seams) end the chain
+const float MeshLodMinimumReduction = 0.8f;
+
+// Levels stop once they get this small
+const size_t MeshLodMinimumTriangles = 64;
+
+// Simplifies a triangle list down to (at most) the target index count
+float SimplifyMesh(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, size_t targetIndexCount, std::vector<unsigned int>& result);
+
+// Builds a chain of simplified levels, all appended to one index buffer
+void BuildMeshLods(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, std::vector<unsigned int>& lodIndices, std::vector<MeshLod>& lods);
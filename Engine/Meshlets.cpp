@@ -0,0 +1,382 @@
+#include "Meshlets.h"
+#include "MeshBounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Triangles that all face within about 84 degrees of each
+	// other, and no wider, get a usable normal cone
+	const float MinimumConeSpread = 0.1f;
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	float LengthSquared(const XMFLOAT3& a) { return Dot(a, a); }
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	XMFLOAT3 Normalize(const XMFLOAT3& a)
+	{
+		float length = sqrtf(LengthSquared(a));
+		return length > 0.0f ? XMFLOAT3(a.x / length, a.y / length, a.z / length) : XMFLOAT3(0, 0, 0);
+	}
+
+	// --------------------------------------------------------
+	// Works out a meshlet's bounding sphere and the cone that
+	// holds all of its triangles' normals
+	// --------------------------------------------------------
+	MeshletBounds CalculateMeshletBounds(const Vertex* verts, const MeshletData& data, const Meshlet& meshlet)
+	{
+		MeshletBounds bounds = {};
+		const uint32_t* vertices = &data.vertices[meshlet.vertexOffset];
+		const uint8_t* triangles = &data.triangles[meshlet.triangleOffset];
+		CalculateBoundingSphere(verts, vertices, meshlet.vertexCount, bounds.center, bounds.radius);
+
+		// No cone unless something below proves one works
+		bounds.coneApex = bounds.center;
+		bounds.coneAxis = XMFLOAT3(0, 0, 0);
+		bounds.coneCutoff = 1.0f;
+
+		// Unit normals of every non-degenerate triangle (outward
+		// is cross(p1 - p0, p2 - p0) for the engine's winding)
+		XMFLOAT3 normals[MaxMeshletTriangles];
+		const XMFLOAT3* corners[MaxMeshletTriangles];
+		size_t normalCount = 0;
+		XMFLOAT3 sum(0, 0, 0);
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const XMFLOAT3& p0 = verts[vertices[triangles[t * 3 + 0]]].Position;
+			const XMFLOAT3& p1 = verts[vertices[triangles[t * 3 + 1]]].Position;
+			const XMFLOAT3& p2 = verts[vertices[triangles[t * 3 + 2]]].Position;
+
+			XMFLOAT3 normal = Normalize(Cross(Subtract(p1, p0), Subtract(p2, p0)));
+			if (LengthSquared(normal) == 0.0f)
+				continue;
+
+			normals[normalCount] = normal;
+			corners[normalCount] = &p0;
+			normalCount++;
+			sum = XMFLOAT3(sum.x + normal.x, sum.y + normal.y, sum.z + normal.z);
+		}
+
+		XMFLOAT3 axis = Normalize(sum);
+		if (normalCount == 0 || LengthSquared(axis) == 0.0f)
+			return bounds;
+
+		float minimumDot = 1.0f;
+		for (size_t i = 0; i < normalCount; i++)
+			minimumDot = fminf(minimumDot, Dot(axis, normals[i]));
+
+		if (minimumDot <= MinimumConeSpread)
+			return bounds;
+
+		// Slide the apex back along the axis until it's behind
+		// every triangle's plane, which keeps the test exact for
+		// viewers close to the meshlet
+		float maxT = 0.0f;
+		for (size_t i = 0; i < normalCount; i++)
+		{
+			float t = Dot(Subtract(bounds.center, *corners[i]), normals[i]) / Dot(axis, normals[i]);
+			maxT = fmaxf(maxT, t);
+		}
+
+		bounds.coneApex = XMFLOAT3(bounds.center.x - axis.x * maxT, bounds.center.y - axis.y * maxT, bounds.center.z - axis.z * maxT);
+		bounds.coneAxis = axis;
+		bounds.coneCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+		return bounds;
+	}
+
+	XMFLOAT4 NormalizePlane(float a, float b, float c, float d)
+	{
+		float length = sqrtf(a * a + b * b + c * c);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		return XMFLOAT4(a * scale, b * scale, c * scale, d * scale);
+	}
+}
+
+
+// --------------------------------------------------------
+// Splits a triangle list into meshlets of at most
+// MaxMeshletVertices vertices and MaxMeshletTriangles
+// triangles.  Each meshlet grows from a seed triangle by
+// adding whichever neighboring triangle needs the fewest new
+// vertices (then whichever is closest to the meshlet's
+// center), which keeps meshlets compact so their spheres
+// are small and their normal cones are narrow.
+//
+// verts - The mesh's vertices
+// vertexCount - How many vertices
+// indices - Triangle list to split
+// indexCount - How many indices
+// result - Receives the meshlets and their bounds
+// --------------------------------------------------------
+void BuildMeshlets(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, MeshletData& result)
+{
+	result.meshlets.clear();
+	result.bounds.clear();
+	result.vertices.clear();
+	result.triangles.clear();
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Vertex -> triangle adjacency.  Emitted triangles are
+	// swapped out of the lists, so only live ones get checked.
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	std::vector<uint32_t> adjacencyCount(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacencyCount[indices[i]]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + adjacencyCount[v];
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::fill(adjacencyCount.begin(), adjacencyCount.end(), 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		unsigned int v = indices[i];
+		adjacency[adjacencyStart[v] + adjacencyCount[v]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	size_t seedCursor = 0;
+
+	// Where each mesh vertex is in the current meshlet, if anywhere
+	std::vector<int> localIndex(vertexCount, -1);
+
+	Meshlet current = {};
+	XMFLOAT3 centerSum(0, 0, 0);
+
+	auto newVerticesFor = [&](uint32_t t)
+	{
+		const unsigned int* tri = &indices[t * 3];
+		return (localIndex[tri[0]] < 0 ? 1 : 0) +
+			(localIndex[tri[1]] < 0 && tri[1] != tri[0] ? 1 : 0) +
+			(localIndex[tri[2]] < 0 && tri[2] != tri[0] && tri[2] != tri[1] ? 1 : 0);
+	};
+
+	auto fits = [&](uint32_t t)
+	{
+		return current.vertexCount + newVerticesFor(t) <= MaxMeshletVertices &&
+			current.triangleCount < MaxMeshletTriangles;
+	};
+
+	auto emitTriangle = [&](uint32_t t)
+	{
+		emitted[t] = true;
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			if (localIndex[v] < 0)
+			{
+				localIndex[v] = (int)current.vertexCount++;
+				result.vertices.push_back(v);
+
+				const XMFLOAT3& p = verts[v].Position;
+				centerSum = XMFLOAT3(centerSum.x + p.x, centerSum.y + p.y, centerSum.z + p.z);
+			}
+			result.triangles.push_back((uint8_t)localIndex[v]);
+
+			// Remove it from this vertex's live triangles
+			uint32_t* live = &adjacency[adjacencyStart[v]];
+			uint32_t& count = adjacencyCount[v];
+			for (uint32_t a = 0; a < count; a++)
+			{
+				if (live[a] == t)
+				{
+					live[a] = live[--count];
+					break;
+				}
+			}
+		}
+		current.triangleCount++;
+	};
+
+	auto finishMeshlet = [&]()
+	{
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+			localIndex[result.vertices[current.vertexOffset + i]] = -1;
+
+		result.meshlets.push_back(current);
+		current.vertexOffset = (uint32_t)result.vertices.size();
+		current.triangleOffset = (uint32_t)result.triangles.size();
+		current.vertexCount = 0;
+		current.triangleCount = 0;
+		centerSum = XMFLOAT3(0, 0, 0);
+	};
+
+	size_t remaining = triangleCount;
+	uint32_t seed = 0;
+	while (remaining > 0)
+	{
+		// Seeds come from the last meshlet's leftover neighbors when
+		// possible, otherwise the next unused triangle in index order
+		emitTriangle(seed);
+		remaining--;
+
+		while (remaining > 0)
+		{
+			float inverseCount = 1.0f / current.vertexCount;
+			XMFLOAT3 center(centerSum.x * inverseCount, centerSum.y * inverseCount, centerSum.z * inverseCount);
+
+			uint32_t best = UINT32_MAX;
+			int bestNew = 4;
+			float bestDistance = 0.0f;
+			for (uint32_t i = 0; i < current.vertexCount; i++)
+			{
+				uint32_t v = result.vertices[current.vertexOffset + i];
+				for (uint32_t a = 0; a < adjacencyCount[v]; a++)
+				{
+					uint32_t t = adjacency[adjacencyStart[v] + a];
+					int newVertices = newVerticesFor(t);
+					if (newVertices > bestNew || !fits(t))
+						continue;
+
+					const unsigned int* tri = &indices[t * 3];
+					const XMFLOAT3& p0 = verts[tri[0]].Position;
+					const XMFLOAT3& p1 = verts[tri[1]].Position;
+					const XMFLOAT3& p2 = verts[tri[2]].Position;
+					XMFLOAT3 centroid((p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f);
+					float distance = LengthSquared(Subtract(centroid, center));
+
+					if (newVertices < bestNew || distance < bestDistance)
+					{
+						best = t;
+						bestNew = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			if (best == UINT32_MAX)
+				break;
+
+			emitTriangle(best);
+			remaining--;
+		}
+
+		// Pick the next seed before the meshlet's vertices are forgotten
+		seed = UINT32_MAX;
+		for (uint32_t i = 0; i < current.vertexCount && seed == UINT32_MAX; i++)
+		{
+			uint32_t v = result.vertices[current.vertexOffset + i];
+			if (adjacencyCount[v] > 0)
+				seed = adjacency[adjacencyStart[v]];
+		}
+
+		finishMeshlet();
+
+		if (seed == UINT32_MAX && remaining > 0)
+		{
+			while (emitted[seedCursor]) seedCursor++;
+			seed = (uint32_t)seedCursor;
+		}
+	}
+
+	result.bounds.reserve(result.meshlets.size());
+	for (const Meshlet& meshlet : result.meshlets)
+		result.bounds.push_back(CalculateMeshletBounds(verts, result, meshlet));
+}
+
+
+// --------------------------------------------------------
+// Pulls the six clip planes out of a view projection matrix
+// (Gribb and Hartmann), using D3D's 0 to 1 depth range.
+// DirectXMath matrices multiply row vectors, so each plane
+// comes from the matrix's columns.
+//
+// viewProjection - Matrix taking points to clip space
+// --------------------------------------------------------
+MeshletFrustum ExtractMeshletFrustum(const XMFLOAT4X4& viewProjection)
+{
+	const float(*m)[4] = viewProjection.m;
+	auto column = [m](int c, int r) { return m[r][c]; };
+
+	MeshletFrustum frustum;
+	for (int p = 0; p < 6; p++)
+	{
+		float plane[4];
+		for (int r = 0; r < 4; r++)
+		{
+			float w = column(3, r);
+			switch (p)
+			{
+			case 0: plane[r] = w + column(0, r); break;	// Left
+			case 1: plane[r] = w - column(0, r); break;	// Right
+			case 2: plane[r] = w + column(1, r); break;	// Bottom
+			case 3: plane[r] = w - column(1, r); break;	// Top
+			case 4: plane[r] = column(2, r); break;		// Near
+			default: plane[r] = w - column(2, r); break;	// Far
+			}
+		}
+
+		frustum.planes[p] = NormalizePlane(plane[0], plane[1], plane[2], plane[3]);
+	}
+
+	return frustum;
+}
+
+
+// --------------------------------------------------------
+// Tests every meshlet's sphere against the frustum and its
+// normal cone against the viewer.  Everything must be in
+// the same space; in object space the cone test assumes the
+// object isn't scaled unevenly.
+//
+// data - Meshlets to test
+// frustum - Planes of the view volume
+// viewer - Where the camera is
+// visible - Receives the indices of meshlets that survive
+// stats - Optionally receives what was culled and why
+// Returns how many meshlets survived
+// --------------------------------------------------------
+size_t CullMeshlets(const MeshletData& data, const MeshletFrustum& frustum, const XMFLOAT3& viewer, std::vector<uint32_t>& visible, MeshletCullStats* stats)
+{
+	visible.clear();
+	size_t frustumCulled = 0;
+	size_t coneCulled = 0;
+
+	for (size_t i = 0; i < data.bounds.size(); i++)
+	{
+		const MeshletBounds& b = data.bounds[i];
+
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++)
+		{
+			const XMFLOAT4& plane = frustum.planes[p];
+			outside = plane.x * b.center.x + plane.y * b.center.y + plane.z * b.center.z + plane.w < -b.radius;
+		}
+
+		if (outside)
+		{
+			frustumCulled++;
+			continue;
+		}
+
+		// Backfacing: the whole cone points away from the viewer
+		XMFLOAT3 view = Subtract(b.coneApex, viewer);
+		float viewLength = sqrtf(LengthSquared(view));
+		if (Dot(view, b.coneAxis) >= b.coneCutoff * viewLength && viewLength > 0.0f)
+		{
+			coneCulled++;
+			continue;
+		}
+
+		visible.push_back((uint32_t)i);
+	}
+
+	if (stats)
+	{
+		stats->tested = data.bounds.size();
+		stats->frustumCulled = frustumCulled;
+		stats->coneCulled = coneCulled;
+	}
+
+	return visible.size();
+}
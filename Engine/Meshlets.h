@@ -0,0 +1,82 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+
+// Limits that fit mesh shader output and keep triangle
+// indices in a byte (124 triangles keeps each meshlet's
+// triangle list a multiple of four bytes)
+const size_t MaxMeshletVertices = 64;
+const size_t MaxMeshletTriangles = 124;
+
+// --------------------------------------------------------
+// A small cluster of a mesh's triangles.  Its vertices are
+// indices into the mesh's vertex buffer, and its triangles
+// are byte indices into its own vertex list.
+// --------------------------------------------------------
+struct Meshlet
+{
+	uint32_t vertexOffset;		// First entry in MeshletData::vertices
+	uint32_t triangleOffset;	// First entry in MeshletData::triangles (3 per triangle)
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+
+// --------------------------------------------------------
+// Culling data for one meshlet, in object space.  Every
+// triangle faces away from a viewer when
+//   dot(normalize(coneApex - viewer), coneAxis) >= coneCutoff
+// A cutoff of 1 (with a zero axis) means the triangles face
+// too many ways for the cone to ever cull them.
+// --------------------------------------------------------
+struct MeshletBounds
+{
+	DirectX::XMFLOAT3 center;
+	float radius;
+	DirectX::XMFLOAT3 coneApex;
+	DirectX::XMFLOAT3 coneAxis;
+	float coneCutoff;			// Sine of the cone's half angle
+};
+
+// --------------------------------------------------------
+// Every meshlet of a mesh, sharing a few flat arrays
+// --------------------------------------------------------
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;	// One per meshlet
+	std::vector<uint32_t> vertices;
+	std::vector<uint8_t> triangles;
+};
+
+// --------------------------------------------------------
+// Six planes facing into a view volume (xyz is the unit
+// normal, w the offset), in whatever space the matrix they
+// came from starts in.  Extracting from world * view *
+// projection gives object space planes.
+// --------------------------------------------------------
+struct MeshletFrustum
+{
+	DirectX::XMFLOAT4 planes[6];
+};
+
+// How much work a culling pass did, and why meshlets were dropped
+struct MeshletCullStats
+{
+	size_t tested;
+	size_t frustumCulled;
+	size_t coneCulled;
+};
+
+// Splits a triangle list into meshlets and works out their bounds
+void BuildMeshlets(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, MeshletData& result);
+
+// Finds the planes of the volume a (row vector) view projection matrix sees
+MeshletFrustum ExtractMeshletFrustum(const DirectX::XMFLOAT4X4& viewProjection);
+
+// Collects the meshlets that could be visible from the given viewer
+size_t CullMeshlets(const MeshletData& data, const MeshletFrustum& frustum, const DirectX::XMFLOAT3& viewer, std::vector<uint32_t>& visible, MeshletCullStats* stats = 0);
@@ -0,0 +1,698 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	// Where each chunk's streams start in the merged streams
+	struct ObjDataOffsets
+	{
+		size_t positions;
+		size_t normals;
+		size_t uvs;
+		size_t corners;
+	};
+
+	// A face corner whose indices were relative (negative) in
+	// the file.  When a chunk is parsed on its own, these were
+	// resolved against the chunk's own counts, so they still
+	// need the chunk's offsets added once chunks are merged.
+	struct ObjRelativeCorner
+	{
+		size_t corner;		// Which corner in the chunk's stream
+		unsigned int mask;	// Which of its indices were relative
+	};
+
+	const unsigned int RelativePosition = 1 << 0;
+	const unsigned int RelativeUV = 1 << 1;
+	const unsigned int RelativeNormal = 1 << 2;
+
+	// Exact powers of ten representable by a double, used to
+	// scale the integer mantissa built up by ParseFloat()
+	const double powersOfTen[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const int maxPowerOfTen = 22;
+
+	bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+	bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+	const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p)) p++;
+		return p;
+	}
+
+	const char* SkipLine(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n') p++;
+		return p < end ? p + 1 : end;
+	}
+
+	// --------------------------------------------------------
+	// Reads a decimal float (with optional sign, fraction and
+	// exponent) starting at p.  This ignores the C locale on
+	// purpose - OBJ files always use '.' as the separator.
+	// Returns the position after the number, or null if there
+	// was no number to read.
+	// --------------------------------------------------------
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		p = SkipSpaces(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			p++;
+		}
+
+		// Gather up to 19 significant digits into an integer,
+		// tracking where the decimal point should end up
+		uint64_t mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+
+		for (; p < end && IsDigit(*p); p++)
+		{
+			anyDigits = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) significantDigits++;
+			}
+			else
+			{
+				exponent++;
+			}
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && IsDigit(*p); p++)
+			{
+				anyDigits = true;
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa != 0) significantDigits++;
+					exponent--;
+				}
+			}
+		}
+
+		if (!anyDigits)
+			return 0;
+
+		// Optional exponent
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* expStart = p++;
+			bool negativeExp = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negativeExp = (*p == '-');
+				p++;
+			}
+
+			if (p < end && IsDigit(*p))
+			{
+				int value = 0;
+				for (; p < end && IsDigit(*p); p++)
+				{
+					if (value < 10000) value = value * 10 + (*p - '0');
+				}
+				exponent += negativeExp ? -value : value;
+			}
+			else
+			{
+				// Not actually an exponent, so don't consume it
+				p = expStart;
+			}
+		}
+
+		// Scale by the power of ten in as few steps as possible
+		double result = (double)mantissa;
+		while (exponent < -maxPowerOfTen && result != 0.0)
+		{
+			result /= powersOfTen[maxPowerOfTen];
+			exponent += maxPowerOfTen;
+		}
+		while (exponent > maxPowerOfTen)
+		{
+			result *= powersOfTen[maxPowerOfTen];
+			exponent -= maxPowerOfTen;
+		}
+		if (exponent < 0) result /= powersOfTen[-exponent];
+		else result *= powersOfTen[exponent];
+
+		out = (float)(negative ? -result : result);
+		return p;
+	}
+
+	// --------------------------------------------------------
+	// Reads a (possibly signed) decimal integer starting at p.
+	// Returns the position after the number, or null if there
+	// was no number to read or it doesn't fit in an int.
+	// --------------------------------------------------------
+	const char* ParseInt(const char* p, const char* end, int& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			p++;
+		}
+
+		if (p >= end || !IsDigit(*p))
+			return 0;
+
+		// Stop accumulating once it's out of range, but still
+		// read every digit so the number is rejected as a whole
+		int64_t value = 0;
+		for (; p < end && IsDigit(*p); p++)
+		{
+			if (value <= INT_MAX)
+				value = value * 10 + (*p - '0');
+		}
+
+		if (value > INT_MAX)
+			return 0;
+
+		out = (int)(negative ? -value : value);
+		return p;
+	}
+
+	// --------------------------------------------------------
+	// Reads a single face corner in any of the OBJ forms:
+	// "v", "v/vt", "v//vn" or "v/vt/vn".  Indices are left
+	// exactly as written (1-based or negative), with 0 for
+	// anything that wasn't specified.
+	// --------------------------------------------------------
+	const char* ParseCorner(const char* p, const char* end, ObjCorner& corner)
+	{
+		corner.position = 0;
+		corner.uv = 0;
+		corner.normal = 0;
+
+		p = ParseInt(p, end, corner.position);
+		if (!p || p >= end || *p != '/') return p;
+
+		// The uv is optional ("v//vn")
+		p++;
+		if (p < end && *p != '/')
+		{
+			p = ParseInt(p, end, corner.uv);
+			if (!p) return 0;
+		}
+		if (p >= end || *p != '/') return p;
+
+		return ParseInt(p + 1, end, corner.normal);
+	}
+
+	// --------------------------------------------------------
+	// Converts an index as written in the file to a 0-based
+	// absolute index.  Negative indices count back from the
+	// most recent element, so they need to know how many
+	// elements have been read so far.
+	// --------------------------------------------------------
+	int ResolveIndex(int index, size_t count)
+	{
+		if (index > 0) return index - 1;
+		if (index < 0) return (int)count + index;
+		return ObjMissingIndex;
+	}
+
+	// --------------------------------------------------------
+	// Parses OBJ text into the given streams.  If relative is
+	// given, every corner that used a negative index is also
+	// recorded there so it can be fixed up later.
+	// --------------------------------------------------------
+	void ParseObjChunk(const char* text, size_t length, ObjData& obj, std::vector<ObjRelativeCorner>* relative)
+	{
+		const char* p = text;
+		const char* end = text + length;
+
+		// Corners of the current face (and which of their indices
+		// were relative), reused for every face
+		std::vector<ObjCorner> face;
+		std::vector<unsigned int> faceRelative;
+		face.reserve(16);
+		faceRelative.reserve(16);
+
+		while (p < end)
+		{
+			p = SkipSpaces(p, end);
+			if (p >= end) break;
+
+			// Check the type of line
+			if (p[0] == 'v' && p + 1 < end && p[1] == 'n' && p + 2 < end && IsSpace(p[2]))
+			{
+				XMFLOAT3 norm = {};
+				const char* q = ParseFloat(p + 2, end, norm.x);
+				if (q) q = ParseFloat(q, end, norm.y);
+				if (q) q = ParseFloat(q, end, norm.z);
+				if (q) obj.normals.push_back(norm);
+				else obj.malformedLines++;
+			}
+			else if (p[0] == 'v' && p + 1 < end && p[1] == 't' && p + 2 < end && IsSpace(p[2]))
+			{
+				XMFLOAT2 uv = {};
+				const char* q = ParseFloat(p + 2, end, uv.x);
+				if (q) q = ParseFloat(q, end, uv.y);
+				if (q) obj.uvs.push_back(uv);
+				else obj.malformedLines++;
+			}
+			else if (p[0] == 'v' && p + 1 < end && IsSpace(p[1]))
+			{
+				XMFLOAT3 pos = {};
+				const char* q = ParseFloat(p + 1, end, pos.x);
+				if (q) q = ParseFloat(q, end, pos.y);
+				if (q) q = ParseFloat(q, end, pos.z);
+				if (q) obj.positions.push_back(pos);
+				else obj.malformedLines++;
+			}
+			else if (p[0] == 'f' && p + 1 < end && IsSpace(p[1]))
+			{
+				// Read every corner on the line
+				face.clear();
+				const char* q = p + 1;
+				while (true)
+				{
+					q = SkipSpaces(q, end);
+					ObjCorner corner;
+					q = ParseCorner(q, end, corner);
+					if (!q) break;
+					face.push_back(corner);
+				}
+
+				if (face.size() < 3)
+					obj.malformedLines++;
+
+				// Resolve the indices and fan-triangulate the polygon
+				// around its first corner: (0,1,2), (0,2,3), ...
+				if (face.size() >= 3)
+				{
+					bool anyRelative = false;
+					faceRelative.resize(face.size());
+					for (size_t c = 0; c < face.size(); c++)
+					{
+						ObjCorner& corner = face[c];
+						faceRelative[c] =
+							(corner.position < 0 ? RelativePosition : 0) |
+							(corner.uv < 0 ? RelativeUV : 0) |
+							(corner.normal < 0 ? RelativeNormal : 0);
+						anyRelative |= faceRelative[c] != 0;
+
+						corner.position = ResolveIndex(corner.position, obj.positions.size());
+						corner.uv = ResolveIndex(corner.uv, obj.uvs.size());
+						corner.normal = ResolveIndex(corner.normal, obj.normals.size());
+					}
+
+					for (size_t c = 1; c + 1 < face.size(); c++)
+					{
+						const size_t triangle[3] = { 0, c, c + 1 };
+						for (size_t i : triangle)
+						{
+							if (relative && anyRelative && faceRelative[i])
+							{
+								ObjRelativeCorner fixup;
+								fixup.corner = obj.corners.size();
+								fixup.mask = faceRelative[i];
+								relative->push_back(fixup);
+							}
+							obj.corners.push_back(face[i]);
+						}
+					}
+				}
+			}
+
+			p = SkipLine(p, end);
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Parses OBJ text that is already in memory, appending the
+// results to the given ObjData.  Faces may have any number
+// of corners in any of the OBJ index forms.  Unknown line
+// types (materials, groups, comments, etc.) are skipped, and
+// malformed ones are skipped and counted.
+//
+// text - Start of the OBJ text (need not be null terminated)
+// length - Number of bytes of text
+// obj - Where to put the results
+// --------------------------------------------------------
+void ParseObjText(const char* text, size_t length, ObjData& obj)
+{
+	ParseObjChunk(text, length, obj, 0);
+}
+
+
+// --------------------------------------------------------
+// Appends one chunk's stream to the final stream at the
+// given element offset.  The destination must already be
+// large enough.
+// --------------------------------------------------------
+template<typename T>
+static void CopyStream(const std::vector<T>& source, std::vector<T>& dest, size_t offset)
+{
+	if (!source.empty())
+		memcpy(&dest[offset], &source[0], sizeof(T) * source.size());
+}
+
+
+// --------------------------------------------------------
+// Parses OBJ text on several threads at once.  The text is
+// split into chunks at line boundaries, each chunk is parsed
+// into its own streams, and the streams are then merged in
+// file order.  The results are identical to ParseObjText().
+//
+// text - Start of the OBJ text (need not be null terminated)
+// length - Number of bytes of text
+// obj - Where to put the results
+// threadCount - How many chunks (and threads) to use
+// --------------------------------------------------------
+void ParseObjTextParallel(const char* text, size_t length, ObjData& obj, unsigned int threadCount)
+{
+	if (threadCount <= 1 || length < threadCount)
+	{
+		ParseObjText(text, length, obj);
+		return;
+	}
+
+	// Find the chunk boundaries, moving each split point
+	// forward so that it lands just after a newline
+	const char* end = text + length;
+	std::vector<const char*> splits(threadCount + 1);
+	splits[0] = text;
+	splits[threadCount] = end;
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		const char* split = text + (length / threadCount) * i;
+		if (split < splits[i - 1]) split = splits[i - 1];
+		while (split < end && split[-1] != '\n') split++;
+		splits[i] = split;
+	}
+
+	// Parse each chunk into its own streams
+	std::vector<ObjData> chunks(threadCount);
+	std::vector<std::vector<ObjRelativeCorner>> relative(threadCount);
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount - 1);
+		for (unsigned int i = 1; i < threadCount; i++)
+		{
+			workers.push_back(std::thread([&splits, &chunks, &relative, i]()
+			{
+				ParseObjChunk(splits[i], splits[i + 1] - splits[i], chunks[i], &relative[i]);
+			}));
+		}
+
+		// This thread handles the first chunk itself
+		ParseObjChunk(splits[0], splits[1] - splits[0], chunks[0], &relative[0]);
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	// Figure out where each chunk lands in the final streams
+	std::vector<ObjDataOffsets> offsets(threadCount + 1);
+	offsets[0].positions = obj.positions.size();
+	offsets[0].normals = obj.normals.size();
+	offsets[0].uvs = obj.uvs.size();
+	offsets[0].corners = obj.corners.size();
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		offsets[i + 1].positions = offsets[i].positions + chunks[i].positions.size();
+		offsets[i + 1].normals = offsets[i].normals + chunks[i].normals.size();
+		offsets[i + 1].uvs = offsets[i].uvs + chunks[i].uvs.size();
+		offsets[i + 1].corners = offsets[i].corners + chunks[i].corners.size();
+	}
+
+	obj.positions.resize(offsets[threadCount].positions);
+	obj.normals.resize(offsets[threadCount].normals);
+	obj.uvs.resize(offsets[threadCount].uvs);
+	obj.corners.resize(offsets[threadCount].corners);
+	for (const ObjData& chunk : chunks)
+		obj.malformedLines += chunk.malformedLines;
+
+	// Merge the chunks back together in file order
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount);
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			workers.push_back(std::thread([&chunks, &relative, &offsets, &obj, i]()
+			{
+				CopyStream(chunks[i].positions, obj.positions, offsets[i].positions);
+				CopyStream(chunks[i].normals, obj.normals, offsets[i].normals);
+				CopyStream(chunks[i].uvs, obj.uvs, offsets[i].uvs);
+				CopyStream(chunks[i].corners, obj.corners, offsets[i].corners);
+
+				// Relative indices were resolved against this chunk's
+				// own counts, so shift them by everything before it
+				for (const ObjRelativeCorner& fixup : relative[i])
+				{
+					ObjCorner& corner = obj.corners[offsets[i].corners + fixup.corner];
+					if (fixup.mask & RelativePosition) corner.position += (int)offsets[i].positions;
+					if (fixup.mask & RelativeUV) corner.uv += (int)offsets[i].uvs;
+					if (fixup.mask & RelativeNormal) corner.normal += (int)offsets[i].normals;
+				}
+			}));
+		}
+		for (std::thread& worker : workers) worker.join();
+	}
+}
+
+
+// --------------------------------------------------------
+// Picks a thread count for a file of the given size.
+// Small files aren't worth the cost of starting threads.
+// --------------------------------------------------------
+static unsigned int ChooseObjThreadCount(size_t length, unsigned int requested)
+{
+	if (requested > 0)
+		return requested;
+
+	if (length < ObjParallelThresholdInBytes)
+		return 1;
+
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 0 ? hardwareThreads : 1;
+}
+
+
+// --------------------------------------------------------
+// Parses OBJ text that is already in memory (usually a
+// mapped file), picking a thread count based on its size.
+//
+// text - Start of the OBJ text (need not be null terminated)
+// length - Number of bytes of text
+// obj - Where to put the results
+// stats - Optional, receives size, timing and how many lines were malformed
+// threadCount - Threads to parse with (0 picks automatically)
+// --------------------------------------------------------
+void ParseObjMemory(const char* text, size_t length, ObjData& obj, ObjParseStats* stats, unsigned int threadCount)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	size_t malformedBefore = obj.malformedLines;
+
+	threadCount = ChooseObjThreadCount(length, threadCount);
+	ParseObjTextParallel(text, length, obj, threadCount);
+
+	if (stats)
+	{
+		stats->bytes = length;
+		stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		stats->threads = threadCount;
+		stats->malformedLines = obj.malformedLines - malformedBefore;
+	}
+}
+
+
+// --------------------------------------------------------
+// Memory-maps an OBJ file and parses it.  Returns false if
+// the file couldn't be opened.
+//
+// file - The OBJ file to load
+// obj - Where to put the results
+// stats - Optional, receives size and timing information
+// threadCount - Threads to parse with (0 picks automatically)
+// --------------------------------------------------------
+template<typename CharType>
+static bool LoadObjFileImpl(const CharType* file, ObjData& obj, ObjParseStats* stats, unsigned int threadCount)
+{
+	MappedFile mapped;
+	if (!mapped.Open(file))
+		return false;
+
+	ParseObjMemory(mapped.GetData(), mapped.GetSize(), obj, stats, threadCount);
+	return true;
+}
+
+bool LoadObjFile(const wchar_t* file, ObjData& obj, ObjParseStats* stats, unsigned int threadCount) { return LoadObjFileImpl(file, obj, stats, threadCount); }
+bool LoadObjFile(const char* file, ObjData& obj, ObjParseStats* stats, unsigned int threadCount) { return LoadObjFileImpl(file, obj, stats, threadCount); }
+
+
+// --------------------------------------------------------
+// Hashes all three indices of a face corner together
+// --------------------------------------------------------
+static uint32_t HashCorner(const ObjCorner& corner)
+{
+	uint32_t h = (uint32_t)corner.position * 0x9E3779B1u;
+	h ^= (uint32_t)corner.uv * 0x85EBCA77u + (h << 6) + (h >> 2);
+	h ^= (uint32_t)corner.normal * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+	return h ^ (h >> 15);
+}
+
+
+// --------------------------------------------------------
+// Calculates the (normalized) normal of a triangle from its
+// positions, for faces that don't specify normals
+// --------------------------------------------------------
+static XMFLOAT3 CalculateFaceNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	float x1 = b.x - a.x, y1 = b.y - a.y, z1 = b.z - a.z;
+	float x2 = c.x - a.x, y2 = c.y - a.y, z2 = c.z - a.z;
+
+	XMFLOAT3 n(
+		y1 * z2 - z1 * y2,
+		z1 * x2 - x1 * z2,
+		x1 * y2 - y1 * x2);
+
+	float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+	float scale = length > 0.0f ? 1.0f / length : 0.0f;
+	return XMFLOAT3(n.x * scale, n.y * scale, n.z * scale);
+}
+
+
+// --------------------------------------------------------
+// Creates the final vertices by looking up each face
+// corner's data in the parsed streams.  Corners that share
+// the same position/uv/normal indices share one vertex, so
+// the results are a unique vertex array plus a real index
+// buffer.  Corners without a uv get (0,0), and corners
+// without a normal get their triangle's flat normal (and so
+// are only shared within that triangle).  Triangles that
+// reference data that doesn't exist are skipped.
+//
+// obj - Parsed OBJ data
+// verts - Receives the assembled vertices
+// indices - Receives the indices of those vertices
+// --------------------------------------------------------
+void BuildObjVertices(const ObjData& obj, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	indices.reserve(indices.size() + obj.corners.size());
+
+	const int positionCount = (int)obj.positions.size();
+	const int uvCount = (int)obj.uvs.size();
+	const int normalCount = (int)obj.normals.size();
+
+	// Open-addressed hash table from a corner's index triple to
+	// the vertex made for it.  Keeping it at most half full
+	// keeps the probe sequences short.
+	const unsigned int emptySlot = 0xFFFFFFFF;
+	size_t tableSize = 16;
+	while (tableSize < obj.corners.size() * 2) tableSize *= 2;
+	std::vector<unsigned int> table(tableSize, emptySlot);
+	std::vector<ObjCorner> vertexKeys;
+	vertexKeys.reserve(obj.corners.size() / 2);
+
+	const unsigned int firstVertex = (unsigned int)verts.size();
+
+	for (size_t t = 0; t + 2 < obj.corners.size(); t += 3)
+	{
+		// Validate the whole triangle before adding any of it
+		bool valid = true;
+		bool missingNormal = false;
+		for (size_t c = t; c < t + 3; c++)
+		{
+			const ObjCorner& corner = obj.corners[c];
+			if (corner.position < 0 || corner.position >= positionCount ||
+				(corner.uv != ObjMissingIndex && (corner.uv < 0 || corner.uv >= uvCount)) ||
+				(corner.normal != ObjMissingIndex && (corner.normal < 0 || corner.normal >= normalCount)))
+				valid = false;
+
+			missingNormal |= corner.normal == ObjMissingIndex;
+		}
+		if (!valid) continue;
+
+		XMFLOAT3 faceNormal(0, 0, 0);
+		if (missingNormal)
+		{
+			faceNormal = CalculateFaceNormal(
+				obj.positions[obj.corners[t].position],
+				obj.positions[obj.corners[t + 1].position],
+				obj.positions[obj.corners[t + 2].position]);
+		}
+
+		// Add the corners (flipping the winding order)
+		const size_t order[3] = { t, t + 2, t + 1 };
+		for (size_t c : order)
+		{
+			ObjCorner corner = obj.corners[c];
+
+			// Flat normals belong to this triangle alone, so give
+			// the key a (negative) normal index that is unique to it
+			if (corner.normal == ObjMissingIndex)
+				corner.normal = -2 - (int)(t / 3);
+
+			// Have we already made a vertex for this exact corner?
+			size_t slot = HashCorner(corner) & (tableSize - 1);
+			while (table[slot] != emptySlot)
+			{
+				const ObjCorner& existing = vertexKeys[table[slot]];
+				if (existing.position == corner.position &&
+					existing.uv == corner.uv &&
+					existing.normal == corner.normal)
+					break;
+				slot = (slot + 1) & (tableSize - 1);
+			}
+
+			if (table[slot] != emptySlot)
+			{
+				indices.push_back(firstVertex + table[slot]);
+				continue;
+			}
+
+			// New corner, so make a new vertex
+			Vertex v;
+			v.Position = obj.positions[corner.position];
+			v.UV = corner.uv >= 0 ? obj.uvs[corner.uv] : XMFLOAT2(0, 0);
+			v.Normal = corner.normal >= 0 ? obj.normals[corner.normal] : faceNormal;
+			v.Tangent = XMFLOAT4(0, 0, 0, 1);
+
+			// The model is most likely in a right-handed space,
+			// especially if it came from Maya.  We want to convert
+			// to a left-handed space for DirectX.  This means we
+			// need to:
+			//  - Invert the Z position
+			//  - Invert the normal's Z
+			//  - Flip the winding order
+			// We also need to flip the UV coordinate since DirectX
+			// defines (0,0) as the top left of the texture, and many
+			// 3D modeling packages use the bottom left as (0,0)
+			v.UV.y = 1.0f - v.UV.y;
+			v.Position.z *= -1.0f;
+			v.Normal.z *= -1.0f;
+
+			table[slot] = (unsigned int)vertexKeys.size();
+			vertexKeys.push_back(corner);
+			indices.push_back((unsigned int)verts.size());
+			verts.push_back(v);
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <vector>
+
+#include "Vertex.h"
+
+// Index stored in an ObjCorner for data the face didn't
+// specify (e.g. the uv of a "v//vn" corner)
+const int ObjMissingIndex = -1;
+
+// --------------------------------------------------------
+// One corner of an OBJ face.  Indices have already been
+// converted from OBJ's 1-based (or negative, relative)
+// scheme to 0-based absolute indices.
+// --------------------------------------------------------
+struct ObjCorner
+{
+	int position;
+	int uv;
+	int normal;
+};
+
+// --------------------------------------------------------
+// Raw data streams read from an OBJ file, before being
+// assembled into vertices.  Faces are stored as triangles
+// (three corners each) in the file's own winding order, with
+// larger polygons fan-triangulated.
+// --------------------------------------------------------
+struct ObjData
+{
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<ObjCorner> corners;
+
+	// Lines that were skipped because they couldn't be read
+	// (a "v" with a missing coordinate, a face with fewer than
+	// three usable corners, ...).  A skipped v, vt or vn line
+	// shifts every later index, so any of these means the
+	// file is probably damaged.
+	size_t malformedLines = 0;
+};
+
+// --------------------------------------------------------
+// Timing information from a single OBJ load
+// --------------------------------------------------------
+struct ObjParseStats
+{
+	size_t bytes;
+	double milliseconds;
+	unsigned int threads;
+	size_t malformedLines;		// See ObjData::malformedLines
+
+	double GetMegabytesPerSecond() const
+	{
+		return milliseconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / (milliseconds / 1000.0) : 0.0;
+	}
+};
+
+// Files smaller than this are always parsed on a single
+// thread when the thread count is picked automatically
+const size_t ObjParallelThresholdInBytes = 1024 * 1024;
+
+// Memory-maps and parses an entire OBJ file.  A thread count
+// of 0 picks one automatically based on the file size.
+bool LoadObjFile(const wchar_t* file, ObjData& obj, ObjParseStats* stats = 0, unsigned int threadCount = 0);
+bool LoadObjFile(const char* file, ObjData& obj, ObjParseStats* stats = 0, unsigned int threadCount = 0);
+
+// Parses OBJ text that is already in memory, choosing threads like LoadObjFile()
+void ParseObjMemory(const char* text, size_t length, ObjData& obj, ObjParseStats* stats = 0, unsigned int threadCount = 0);
+
+// Parses OBJ text that is already in memory on the calling thread
+void ParseObjText(const char* text, size_t length, ObjData& obj);
+
+// Same results as ParseObjText(), but splits the work across threads
+void ParseObjTextParallel(const char* text, size_t length, ObjData& obj, unsigned int threadCount);
+
+// Turns parsed OBJ streams into DirectX-ready, deduplicated
+// vertices and the indices that reference them
+void BuildObjVertices(const ObjData& obj, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
@@ -341,6 +341,10 @@ void Physics::FetchSimulationResults()
 void Physics::AddMeshToBlast(std::shared_ptr<GameEntity> e)
 {
 	renderEntities.push_back(e);
+
+	// The mesh's vertex and index vectors are read directly below
+	e->GetMesh()->WaitUntilLoaded();
+
 	// Step 1: Mesh creation and cleaning
 	std::vector<uint32_t> blastIndices;
 	std::vector<NvcVec3> blastVerts;
@@ -192,6 +192,9 @@ public:
     // TkEventListener interface
     void receive(const Nv::Blast::TkEvent* events, uint32_t eventCount) override
     {
+        // Every chunk mesh created for these events uploads in one submission
+        DX12Helper::GetInstance().BeginUploadBatch();
+
         // Events are batched into an event buffer.  Loop over all events:
         for (uint32_t i = 0; i < eventCount; ++i)
         {
@@ -305,7 +308,7 @@ public:
                                 vert.Position = DirectX::XMFLOAT3(convexVertices[faceIndices[v]].x, convexVertices[faceIndices[v]].y, convexVertices[faceIndices[v]].z);
                                 vert.Normal = DirectX::XMFLOAT3(polygonData.mPlane[0], polygonData.mPlane[1], polygonData.mPlane[2]);
                                 vert.UV = DirectX::XMFLOAT2(meshData.uvs[closestVertexIndex].y, meshData.uvs[closestVertexIndex].x);
-                                vert.Tangent = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);  // Tangent will be calculated
+                                vert.Tangent = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);  // Tangent will be calculated
 
                                 physxRenderVertices.push_back(vert);
                             }
@@ -366,6 +369,8 @@ public:
                 break;
             }
         }
+
+        DX12Helper::GetInstance().EndUploadBatch();
     }
 
 private:
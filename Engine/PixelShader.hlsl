@@ -16,7 +16,7 @@ struct VertexToPixel
 	float4 screenPosition	: SV_POSITION;
 	float2 uv				: TEXCOORD;
 	float3 normal			: NORMAL;
-	float3 tangent			: TANGENT;
+	float4 tangent			: TANGENT;
 	float3 worldPos			: POSITION;
 };
 
@@ -34,7 +34,7 @@ float4 main(VertexToPixel input) : SV_TARGET
 {
 	// Clean up un-normalized normals
 	input.normal = normalize(input.normal);
-	input.tangent = normalize(input.tangent);
+	input.tangent.xyz = normalize(input.tangent.xyz);
 	
 	// Scale and offset uv as necessary
 	input.uv = input.uv * uvScale + uvOffset;
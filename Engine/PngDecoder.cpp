@@ -0,0 +1,531 @@
+#include "PngDecoder.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Deflate's bits, least significant first, kept topped up
+	// 64 bits at a time.  Reading past the end gives zeros, and
+	// the inflater checks it never used any of them.
+	// --------------------------------------------------------
+	struct BitReader
+	{
+		const uint8_t* data;
+		size_t size;
+		size_t position;
+		uint64_t bits;
+		uint32_t count;
+
+		void Refill()
+		{
+			while (count <= 56)
+			{
+				uint64_t byte = position < size ? data[position] : 0;
+				bits |= byte << count;
+				position++;
+				count += 8;
+			}
+		}
+
+		uint32_t Take(uint32_t bitCount)
+		{
+			if (count < bitCount)
+				Refill();
+
+			uint32_t value = (uint32_t)(bits & ((1ull << bitCount) - 1));
+			bits >>= bitCount;
+			count -= bitCount;
+			return value;
+		}
+
+		// Whether any bits past the end of the data were used
+		bool Overran() const { return position - count / 8 > size; }
+	};
+
+	// --------------------------------------------------------
+	// A Huffman code as one lookup table, indexed by the next
+	// longestCode bits of the stream.  Each entry is the
+	// symbol << 4 | its code length (0 for unused codes).
+	// --------------------------------------------------------
+	struct HuffmanTable
+	{
+		std::vector<uint16_t> entries;
+		uint32_t longestCode;
+
+		bool Build(const uint8_t* lengths, uint32_t symbolCount)
+		{
+			uint32_t lengthCounts[16] = {};
+			for (uint32_t s = 0; s < symbolCount; s++)
+				lengthCounts[lengths[s]]++;
+			lengthCounts[0] = 0;
+
+			// Canonical codes start at these values for each length,
+			// and no length can have more codes than fit
+			uint32_t nextCode[16] = {};
+			uint32_t code = 0;
+			longestCode = 0;
+			for (uint32_t length = 1; length < 16; length++)
+			{
+				code = (code + lengthCounts[length - 1]) << 1;
+				nextCode[length] = code;
+				if (lengthCounts[length] > 0)
+				{
+					longestCode = length;
+					if (code + lengthCounts[length] > (1u << length))
+						return false;
+				}
+			}
+			if (longestCode == 0)
+				longestCode = 1;
+
+			entries.assign((size_t)1 << longestCode, 0);
+			for (uint32_t s = 0; s < symbolCount; s++)
+			{
+				uint32_t length = lengths[s];
+				if (length == 0)
+					continue;
+
+				// Codes arrive most significant bit first, so index by the reversed code
+				uint32_t c = nextCode[length]++;
+				uint32_t reversed = 0;
+				for (uint32_t b = 0; b < length; b++)
+					reversed |= ((c >> b) & 1) << (length - 1 - b);
+
+				uint16_t entry = (uint16_t)(s << 4 | length);
+				for (uint32_t i = reversed; i < entries.size(); i += 1u << length)
+					entries[i] = entry;
+			}
+			return true;
+		}
+
+		// Returns the next symbol, or -1 for a code that isn't in the table
+		int Decode(BitReader& reader) const
+		{
+			if (reader.count < longestCode)
+				reader.Refill();
+
+			uint16_t entry = entries[reader.bits & ((1ull << longestCode) - 1)];
+			uint32_t length = entry & 15;
+			if (length == 0)
+				return -1;
+
+			reader.bits >>= length;
+			reader.count -= length;
+			return entry >> 4;
+		}
+	};
+
+	const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// Order the code length code's lengths are stored in
+	const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// --------------------------------------------------------
+	// Reads a dynamic block's literal/length and distance codes
+	// --------------------------------------------------------
+	bool ReadDynamicTables(BitReader& reader, HuffmanTable& literals, HuffmanTable& distances)
+	{
+		uint32_t literalCount = reader.Take(5) + 257;
+		uint32_t distanceCount = reader.Take(5) + 1;
+		uint32_t codeLengthCount = reader.Take(4) + 4;
+
+		uint8_t codeLengthLengths[19] = {};
+		for (uint32_t i = 0; i < codeLengthCount; i++)
+			codeLengthLengths[CodeLengthOrder[i]] = (uint8_t)reader.Take(3);
+
+		HuffmanTable codeLengths;
+		if (!codeLengths.Build(codeLengthLengths, 19))
+			return false;
+
+		// Both codes' lengths are one run, and repeats can cross between them
+		uint8_t lengths[286 + 30] = {};
+		uint32_t total = literalCount + distanceCount;
+		uint32_t i = 0;
+		while (i < total)
+		{
+			int symbol = codeLengths.Decode(reader);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 16)
+			{
+				lengths[i++] = (uint8_t)symbol;
+				continue;
+			}
+
+			uint8_t value = 0;
+			uint32_t repeat;
+			if (symbol == 16)
+			{
+				if (i == 0)
+					return false;
+				value = lengths[i - 1];
+				repeat = 3 + reader.Take(2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + reader.Take(3);
+			else
+				repeat = 11 + reader.Take(7);
+
+			if (i + repeat > total)
+				return false;
+			memset(lengths + i, value, repeat);
+			i += repeat;
+		}
+
+		return lengths[256] != 0 &&
+			literals.Build(lengths, literalCount) &&
+			distances.Build(lengths + literalCount, distanceCount);
+	}
+
+	// --------------------------------------------------------
+	// Decodes one Huffman compressed block, writing at out
+	// --------------------------------------------------------
+	bool InflateBlock(BitReader& reader, const HuffmanTable& literals, const HuffmanTable& distances, uint8_t* output, size_t outputSize, size_t& out)
+	{
+		for (;;)
+		{
+			int symbol = literals.Decode(reader);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 256)
+			{
+				if (out >= outputSize)
+					return false;
+				output[out++] = (uint8_t)symbol;
+				continue;
+			}
+
+			if (symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			uint32_t length = LengthBase[symbol] + reader.Take(LengthExtra[symbol]);
+
+			int distanceSymbol = distances.Decode(reader);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = DistanceBase[distanceSymbol] + reader.Take(DistanceExtra[distanceSymbol]);
+
+			if (distance > out || length > outputSize - out)
+				return false;
+
+			// Matches can overlap what they copy, which repeats it
+			const uint8_t* from = output + out - distance;
+			uint8_t* to = output + out;
+			if (distance >= length)
+				memcpy(to, from, length);
+			else
+				for (uint32_t b = 0; b < length; b++)
+					to[b] = from[b];
+			out += length;
+		}
+	}
+
+	// --------------------------------------------------------
+	// PNG's filter predictor that picks whichever neighbor is
+	// closest to left + up - upLeft
+	// --------------------------------------------------------
+	uint8_t Paeth(uint8_t left, uint8_t up, uint8_t upLeft)
+	{
+		int p = left + up - upLeft;
+		int pa = abs(p - left);
+		int pb = abs(p - up);
+		int pc = abs(p - upLeft);
+		if (pa <= pb && pa <= pc)
+			return left;
+		return pb <= pc ? up : upLeft;
+	}
+
+	// --------------------------------------------------------
+	// Undoes every row's filter in place.  Each row is a
+	// filter type byte followed by stride bytes.
+	// --------------------------------------------------------
+	bool Unfilter(uint8_t* rows, uint32_t height, size_t stride, uint32_t bytesPerPixel)
+	{
+		const uint8_t* previous = 0;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			uint8_t filter = rows[0];
+			uint8_t* row = rows + 1;
+			switch (filter)
+			{
+			case 0:
+				break;
+
+			case 1:
+				for (size_t i = bytesPerPixel; i < stride; i++)
+					row[i] = (uint8_t)(row[i] + row[i - bytesPerPixel]);
+				break;
+
+			case 2:
+				if (previous)
+					for (size_t i = 0; i < stride; i++)
+						row[i] = (uint8_t)(row[i] + previous[i]);
+				break;
+
+			case 3:
+				for (size_t i = 0; i < stride; i++)
+				{
+					uint32_t left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+					uint32_t up = previous ? previous[i] : 0;
+					row[i] = (uint8_t)(row[i] + ((left + up) >> 1));
+				}
+				break;
+
+			case 4:
+				for (size_t i = 0; i < stride; i++)
+				{
+					uint8_t left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+					uint8_t up = previous ? previous[i] : 0;
+					uint8_t upLeft = previous && i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+					row[i] = (uint8_t)(row[i] + Paeth(left, up, upLeft));
+				}
+				break;
+
+			default:
+				return false;
+			}
+
+			previous = row;
+			rows += stride + 1;
+		}
+		return true;
+	}
+
+	uint32_t ReadBigEndian(const uint8_t* bytes)
+	{
+		return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+	}
+}
+
+// --------------------------------------------------------
+// Inflates a whole zlib stream (RFC 1950/1951).  The size
+// of the result has to be known up front, which it is for
+// PNG, and anything that doesn't come out to exactly that
+// size is treated as damaged.
+//
+// data - The zlib stream, header and all
+// size - Bytes in the stream
+// output - Where the inflated bytes go
+// outputSize - Exactly how many bytes the stream holds
+// --------------------------------------------------------
+bool InflateZlib(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize)
+{
+	// Deflate compression with no preset dictionary, and a valid header check
+	if (size < 2 || (data[0] & 15) != 8 || (data[0] * 256 + data[1]) % 31 != 0 || (data[1] & 32))
+		return false;
+
+	BitReader reader = { data, size, 2, 0, 0 };
+	size_t out = 0;
+	bool last = false;
+
+	HuffmanTable literals;
+	HuffmanTable distances;
+
+	while (!last)
+	{
+		last = reader.Take(1) != 0;
+		uint32_t type = reader.Take(2);
+
+		if (type == 0)
+		{
+			// Stored: skip to a byte boundary, then a length and its complement
+			reader.Take(reader.count & 7);
+			uint32_t length = reader.Take(16);
+			if ((reader.Take(16) ^ 0xFFFF) != length || length > outputSize - out)
+				return false;
+
+			// Whole bytes left in the bit buffer come first, the rest straight from the data
+			while (length > 0 && reader.count >= 8)
+			{
+				output[out++] = (uint8_t)reader.Take(8);
+				length--;
+			}
+			if (reader.position > reader.size || length > reader.size - reader.position)
+				return false;
+			memcpy(output + out, reader.data + reader.position, length);
+			reader.position += length;
+			out += length;
+		}
+		else if (type == 1)
+		{
+			// Fixed codes, from the spec
+			uint8_t lengths[288 + 30];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			memset(lengths + 288, 5, 30);
+			literals.Build(lengths, 288);
+			distances.Build(lengths + 288, 30);
+
+			if (!InflateBlock(reader, literals, distances, output, outputSize, out))
+				return false;
+		}
+		else if (type == 2)
+		{
+			if (!ReadDynamicTables(reader, literals, distances) ||
+				!InflateBlock(reader, literals, distances, output, outputSize, out))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+
+		if (reader.Overran())
+			return false;
+	}
+
+	return out == outputSize;
+}
+
+// --------------------------------------------------------
+// Reads the chunks of a PNG, inflates and unfilters its
+// image data, and expands it to the output layout.
+//
+// data - The whole file
+// size - Bytes in the file
+// image - Receives the pixels
+// --------------------------------------------------------
+bool DecodePng(const uint8_t* data, size_t size, DecodedImage& image)
+{
+	static const uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (size < 8 + 25 || memcmp(data, Signature, 8) != 0)
+		return false;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint8_t colorType = 0;
+	uint8_t palette[256][4];
+	uint32_t paletteSize = 0;
+	std::vector<uint8_t> compressed;
+
+	// Chunks are a length, a type, the data and a CRC
+	// (which isn't checked - the inflater catches damage)
+	size_t position = 8;
+	bool sawHeader = false;
+	bool sawEnd = false;
+	while (!sawEnd && position + 12 <= size)
+	{
+		uint32_t length = ReadBigEndian(data + position);
+		const uint8_t* type = data + position + 4;
+		const uint8_t* chunk = data + position + 8;
+		if (length > size - position - 12)
+			return false;
+
+		if (memcmp(type, "IHDR", 4) == 0 && length == 13)
+		{
+			width = ReadBigEndian(chunk);
+			height = ReadBigEndian(chunk + 4);
+			uint8_t bitDepth = chunk[8];
+			colorType = chunk[9];
+			uint8_t interlace = chunk[12];
+
+			if (width == 0 || height == 0 || width > 16384 || height > 16384 ||
+				bitDepth != 8 || interlace != 0 ||
+				(colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6))
+				return false;
+			sawHeader = true;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = length / 3;
+			if (paletteSize > 256)
+				return false;
+			for (uint32_t i = 0; i < paletteSize; i++)
+			{
+				palette[i][0] = chunk[i * 3 + 0];
+				palette[i][1] = chunk[i * 3 + 1];
+				palette[i][2] = chunk[i * 3 + 2];
+				palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && colorType == 3)
+		{
+			for (uint32_t i = 0; i < length && i < paletteSize; i++)
+				palette[i][3] = chunk[i];
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			sawEnd = true;
+		}
+
+		position += 12 + (size_t)length;
+	}
+
+	if (!sawHeader || compressed.empty() || (colorType == 3 && paletteSize == 0))
+		return false;
+
+	// Bytes per pixel as stored: gray, -, RGB, palette index, gray + alpha, -, RGBA
+	static const uint32_t StoredBytesPerPixel[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	uint32_t bytesPerPixel = StoredBytesPerPixel[colorType];
+	size_t stride = (size_t)width * bytesPerPixel;
+
+	std::vector<uint8_t> rows((stride + 1) * height);
+	if (!InflateZlib(compressed.data(), compressed.size(), rows.data(), rows.size()) ||
+		!Unfilter(rows.data(), height, stride, bytesPerPixel))
+		return false;
+
+	image.width = width;
+	image.height = height;
+	image.channels = colorType == 0 ? 1 : 4;
+	image.pixels.resize((size_t)width * height * image.channels);
+
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const uint8_t* source = rows.data() + y * (stride + 1) + 1;
+		uint8_t* destination = image.pixels.data() + (size_t)y * width * image.channels;
+
+		switch (colorType)
+		{
+		case 0:
+		case 6:
+			memcpy(destination, source, stride);
+			break;
+
+		case 2:
+			for (uint32_t x = 0; x < width; x++, source += 3, destination += 4)
+			{
+				destination[0] = source[0];
+				destination[1] = source[1];
+				destination[2] = source[2];
+				destination[3] = 255;
+			}
+			break;
+
+		case 3:
+			for (uint32_t x = 0; x < width; x++, destination += 4)
+			{
+				uint8_t index = source[x];
+				if (index >= paletteSize)
+					return false;
+				memcpy(destination, palette[index], 4);
+			}
+			break;
+
+		case 4:
+			for (uint32_t x = 0; x < width; x++, source += 2, destination += 4)
+			{
+				destination[0] = destination[1] = destination[2] = source[0];
+				destination[3] = source[1];
+			}
+			break;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Pixels decoded from an image file, rows packed tightly
+// top to bottom.  Grayscale images keep their one channel;
+// everything else is expanded to RGBA.
+// --------------------------------------------------------
+struct DecodedImage
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;		// 1 or 4
+	std::vector<uint8_t> pixels;
+};
+
+// --------------------------------------------------------
+// Decodes a PNG that's already in memory, with no help from
+// the OS (so it runs on any thread, and anywhere).  Handles
+// the 8 bit, non-interlaced images the engine's assets use:
+// grayscale, RGB, RGBA, gray + alpha and palettes.  Returns
+// false for anything else (or a damaged file), so callers
+// can fall back to a full decoder.
+// --------------------------------------------------------
+bool DecodePng(const uint8_t* data, size_t size, DecodedImage& image);
+
+// Inflates a zlib stream into exactly outputSize bytes
+bool InflateZlib(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize);
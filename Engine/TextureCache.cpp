@@ -0,0 +1,301 @@
+#include "TextureCache.h"
+
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	// --------------------------------------------------------
+	// The parts of the DDS format cooked textures use: the
+	// classic header with a "DX10" pixel format, followed by
+	// the DX10 header naming the DXGI format.  The engine's
+	// own tag goes in the header's reserved space.
+	// --------------------------------------------------------
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t masks[4];
+	};
+
+	struct DdsHeader
+	{
+		uint32_t magic;				// "DDS "
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t cookedTag;			// Reserved by DDS: "NBXT"
+		uint32_t cookedVersion;		// CookedTextureVersion when written
+		uint32_t sourceHashLow;		// HashBytes() of the source image
+		uint32_t sourceHashHigh;
+		uint32_t reserved[7];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps[4];
+		uint32_t reserved2;
+
+		// DX10 extension
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DdsHeader) == 4 + 124 + 20, "DDS header layout is wrong");
+
+	const uint32_t DdsMagic = 0x20534444;			// "DDS "
+	const uint32_t CookedTextureTag = 0x5458424E;	// "NBXT"
+	const uint32_t Dx10FourCC = 0x30315844;			// "DX10"
+
+	const uint32_t DdsFlagCaps = 0x1;
+	const uint32_t DdsFlagHeight = 0x2;
+	const uint32_t DdsFlagWidth = 0x4;
+	const uint32_t DdsFlagPitch = 0x8;
+	const uint32_t DdsFlagPixelFormat = 0x1000;
+	const uint32_t DdsFlagMipMapCount = 0x20000;
+	const uint32_t DdsFlagLinearSize = 0x80000;
+	const uint32_t DdsPixelFormatFourCC = 0x4;
+	const uint32_t DdsCapsComplex = 0x8;
+	const uint32_t DdsCapsTexture = 0x1000;
+	const uint32_t DdsCapsMipMap = 0x400000;
+	const uint32_t DdsDimensionTexture2D = 3;
+
+	// DXGI_FORMAT values for each TextureFormat (DDS files store these)
+	const uint32_t DxgiFormats[] = { 61, 28, 71, 77, 80, 83, 98 };
+
+	// --------------------------------------------------------
+	// Reads a mapped DDS file back into a CookedTexture, if
+	// it's one this version of the engine cooked
+	// --------------------------------------------------------
+	bool ReadMappedTexture(const MappedFile& mapped, uint64_t expectedSourceHash, bool fullMipChain, CookedTexture& texture)
+	{
+		if (mapped.GetSize() < sizeof(DdsHeader))
+			return false;
+
+		DdsHeader header;
+		memcpy(&header, mapped.GetData(), sizeof(header));
+		uint64_t sourceHash = (uint64_t)header.sourceHashHigh << 32 | header.sourceHashLow;
+		if (header.magic != DdsMagic ||
+			header.cookedTag != CookedTextureTag ||
+			header.cookedVersion != CookedTextureVersion ||
+			(expectedSourceHash != AnySourceHash && sourceHash != expectedSourceHash) ||
+			header.pixelFormat.fourCC != Dx10FourCC ||
+			header.width == 0 || header.height == 0 || header.mipMapCount == 0 || header.mipMapCount > 32)
+			return false;
+
+		// A full chain goes down to 1x1
+		uint32_t fullCount = 1;
+		while ((header.width >> fullCount) > 0 || (header.height >> fullCount) > 0)
+			fullCount++;
+		if (header.mipMapCount != (fullMipChain ? fullCount : 1))
+			return false;
+
+		int format = -1;
+		for (int f = 0; f < (int)(sizeof(DxgiFormats) / sizeof(DxgiFormats[0])); f++)
+			if (DxgiFormats[f] == header.dxgiFormat)
+				format = f;
+		if (format < 0)
+			return false;
+
+		texture = CookedTexture();
+		texture.format = (TextureFormat)format;
+		texture.channels = texture.format == TextureFormat_R8 ? 1 : 4;
+
+		size_t offset = 0;
+		uint32_t width = header.width;
+		uint32_t height = header.height;
+		for (uint32_t i = 0; i < header.mipMapCount; i++)
+		{
+			TextureMip mip = { width, height, offset };
+			texture.mips.push_back(mip);
+			offset += texture.GetSlicePitch(i);
+
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+
+		if (mapped.GetSize() != sizeof(DdsHeader) + offset)
+		{
+			texture = CookedTexture();
+			return false;
+		}
+
+		const uint8_t* data = (const uint8_t*)mapped.GetData() + sizeof(DdsHeader);
+		texture.pixels.assign(data, data + offset);
+		return true;
+	}
+
+	bool WriteTextureToFile(FILE* out, const CookedTexture& texture, uint64_t sourceHash)
+	{
+		DdsHeader header = {};
+		header.magic = DdsMagic;
+		header.size = 124;
+		header.flags = DdsFlagCaps | DdsFlagHeight | DdsFlagWidth | DdsFlagPixelFormat | DdsFlagMipMapCount |
+			(IsBlockCompressed(texture.format) ? DdsFlagLinearSize : DdsFlagPitch);
+		header.height = texture.mips[0].height;
+		header.width = texture.mips[0].width;
+		header.pitchOrLinearSize = (uint32_t)(IsBlockCompressed(texture.format) ? texture.GetSlicePitch(0) : texture.GetRowPitch(0));
+		header.mipMapCount = (uint32_t)texture.mips.size();
+		header.cookedTag = CookedTextureTag;
+		header.cookedVersion = CookedTextureVersion;
+		header.sourceHashLow = (uint32_t)sourceHash;
+		header.sourceHashHigh = (uint32_t)(sourceHash >> 32);
+		header.pixelFormat.size = sizeof(DdsPixelFormat);
+		header.pixelFormat.flags = DdsPixelFormatFourCC;
+		header.pixelFormat.fourCC = Dx10FourCC;
+		header.caps[0] = DdsCapsTexture | (texture.mips.size() > 1 ? DdsCapsComplex | DdsCapsMipMap : 0);
+		header.dxgiFormat = DxgiFormats[texture.format];
+		header.resourceDimension = DdsDimensionTexture2D;
+		header.arraySize = 1;
+
+		return fwrite(&header, sizeof(header), 1, out) == 1 &&
+			fwrite(texture.pixels.data(), 1, texture.pixels.size(), out) == texture.pixels.size();
+	}
+
+	// Splits off the folder (with its trailing slash, if any) and the file name without its extension
+	template<typename StringType>
+	void SplitPath(const StringType& file, StringType& folder, StringType& name)
+	{
+		size_t slash = file.find_last_of(StringType(1, '/') + StringType(1, '\\'));
+		folder = slash == StringType::npos ? StringType() : file.substr(0, slash + 1);
+		name = slash == StringType::npos ? file : file.substr(slash + 1);
+
+		size_t dot = name.find_last_of('.');
+		if (dot != StringType::npos)
+			name = name.substr(0, dot);
+	}
+
+	// --------------------------------------------------------
+	// Makes the folder a cooked file goes in (just the last
+	// level, since the source's folder already exists)
+	// --------------------------------------------------------
+	void CreateCookedFolder(const std::string& file)
+	{
+		std::string folder, name;
+		SplitPath(file, folder, name);
+		if (folder.empty())
+			return;
+
+		folder.pop_back();
+#ifdef _WIN32
+		_mkdir(folder.c_str());
+#else
+		mkdir(folder.c_str(), 0755);
+#endif
+	}
+
+#ifdef _WIN32
+	void CreateCookedFolder(const std::wstring& file)
+	{
+		std::wstring folder, name;
+		SplitPath(file, folder, name);
+		if (folder.empty())
+			return;
+
+		folder.pop_back();
+		_wmkdir(folder.c_str());
+	}
+#endif
+}
+
+// --------------------------------------------------------
+// Builds the cooked path for a source image, replacing its
+// extension and moving it into the cooked folder
+// --------------------------------------------------------
+template<typename StringType>
+static StringType GetCookedTexturePathImpl(const StringType& sourceFile, const StringType& folderName, const StringType& extension)
+{
+	StringType folder, name;
+	SplitPath(sourceFile, folder, name);
+	return folder + folderName + StringType(1, '/') + name + extension;
+}
+
+std::wstring GetCookedTexturePath(const std::wstring& sourceFile) { return GetCookedTexturePathImpl(sourceFile, std::wstring(L"" COOKED_TEXTURE_FOLDER), std::wstring(L"" COOKED_TEXTURE_EXTENSION)); }
+std::string GetCookedTexturePath(const std::string& sourceFile) { return GetCookedTexturePathImpl(sourceFile, std::string(COOKED_TEXTURE_FOLDER), std::string(COOKED_TEXTURE_EXTENSION)); }
+
+bool ReadCookedTexture(const wchar_t* file, uint64_t expectedSourceHash, bool fullMipChain, CookedTexture& texture)
+{
+	MappedFile mapped;
+	return mapped.Open(file) && ReadMappedTexture(mapped, expectedSourceHash, fullMipChain, texture);
+}
+
+bool ReadCookedTexture(const char* file, uint64_t expectedSourceHash, bool fullMipChain, CookedTexture& texture)
+{
+	MappedFile mapped;
+	return mapped.Open(file) && ReadMappedTexture(mapped, expectedSourceHash, fullMipChain, texture);
+}
+
+// --------------------------------------------------------
+// Writes a texture and every one of its mips to a DDS file
+// that the engine can load straight back.  A partly written
+// file is removed.
+//
+// file - Where to write it (see GetCookedTexturePath())
+// texture - The texture, usually block compressed
+// sourceHash - HashBytes() of the image it was cooked from
+// --------------------------------------------------------
+bool WriteCookedTexture(const wchar_t* file, const CookedTexture& texture, uint64_t sourceHash)
+{
+	if (!texture.IsValid())
+		return false;
+
+#ifdef _WIN32
+	CreateCookedFolder(std::wstring(file));
+
+	FILE* out = 0;
+	if (_wfopen_s(&out, file, L"wb") != 0 || !out)
+		return false;
+
+	bool written = WriteTextureToFile(out, texture, sourceHash);
+	fclose(out);
+	if (!written) _wremove(file);
+	return written;
+#else
+	// POSIX paths are narrow, so convert using the current locale
+	size_t length = wcstombs(0, file, 0);
+	if (length == (size_t)-1)
+		return false;
+
+	std::string narrow(length, '\0');
+	wcstombs(&narrow[0], file, length + 1);
+	return WriteCookedTexture(narrow.c_str(), texture, sourceHash);
+#endif
+}
+
+bool WriteCookedTexture(const char* file, const CookedTexture& texture, uint64_t sourceHash)
+{
+	if (!texture.IsValid())
+		return false;
+
+	CreateCookedFolder(std::string(file));
+
+	FILE* out = 0;
+#ifdef _WIN32
+	if (fopen_s(&out, file, "wb") != 0) out = 0;
+#else
+	out = fopen(file, "wb");
+#endif
+	if (!out)
+		return false;
+
+	bool written = WriteTextureToFile(out, texture, sourceHash);
+	fclose(out);
+	if (!written) remove(file);
+	return written;
+}
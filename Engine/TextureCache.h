@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "TextureProcessing.h"
+
+// Bump this whenever the encoders or the cooked layout change
+// so that stale cache files are ignored and rewritten
+const uint32_t CookedTextureVersion = 1;
+
+// Cooked textures are DDS files in a folder of this name next
+// to the source image (so any DDS viewer can open them)
+#define COOKED_TEXTURE_FOLDER "Cooked"
+#define COOKED_TEXTURE_EXTENSION ".dds"
+
+// Where the cooked version of a source image lives
+std::wstring GetCookedTexturePath(const std::wstring& sourceFile);
+std::string GetCookedTexturePath(const std::string& sourceFile);
+
+// --------------------------------------------------------
+// Reads a cooked texture if it was written by this version
+// of the cooker from a source with the given HashBytes()
+// hash (AnySourceHash accepts any), with the expected mips:
+// a full chain, or just level 0.
+// --------------------------------------------------------
+bool ReadCookedTexture(const wchar_t* file, uint64_t expectedSourceHash, bool fullMipChain, CookedTexture& texture);
+bool ReadCookedTexture(const char* file, uint64_t expectedSourceHash, bool fullMipChain, CookedTexture& texture);
+
+// Writes a texture (any format) as a DDS file, creating the cooked folder if needed
+bool WriteCookedTexture(const wchar_t* file, const CookedTexture& texture, uint64_t sourceHash);
+bool WriteCookedTexture(const char* file, const CookedTexture& texture, uint64_t sourceHash);
@@ -0,0 +1,588 @@
+#include "TextureProcessing.h"
+
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "PngDecoder.h"
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Every x86 target has SSE2, which is all the averaging
+// needs; anything else gets the scalar loop
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define NUBIX_MIPS_SSE 1
+#endif
+
+namespace
+{
+	// --------------------------------------------------------
+	// Averages 2x2 blocks from a pair of source rows into one
+	// destination row, for output pixels first to last.  Edge
+	// pixels are repeated when a dimension is 1.
+	// --------------------------------------------------------
+	void DownsampleRowScalar(const uint8_t* rowA, const uint8_t* rowB, uint32_t width, uint32_t channels, uint8_t* destination, uint32_t first, uint32_t last)
+	{
+		for (uint32_t x = first; x < last; x++)
+		{
+			const uint8_t* a0 = rowA + (size_t)std::min(x * 2, width - 1) * channels;
+			const uint8_t* a1 = rowA + (size_t)std::min(x * 2 + 1, width - 1) * channels;
+			const uint8_t* b0 = rowB + (size_t)std::min(x * 2, width - 1) * channels;
+			const uint8_t* b1 = rowB + (size_t)std::min(x * 2 + 1, width - 1) * channels;
+
+			uint8_t* out = destination + (size_t)x * channels;
+			for (uint32_t c = 0; c < channels; c++)
+				out[c] = (uint8_t)((a0[c] + a1[c] + b0[c] + b1[c] + 2) >> 2);
+		}
+	}
+
+#ifdef NUBIX_MIPS_SSE
+	// --------------------------------------------------------
+	// Same as the scalar row, with the same rounding, for
+	// single channel images: 8 outputs from 16 source bytes of
+	// each row, splitting even and odd bytes into 16 bit lanes
+	// --------------------------------------------------------
+	uint32_t DownsampleRowR8SSE2(const uint8_t* rowA, const uint8_t* rowB, uint8_t* destination, uint32_t outputs)
+	{
+		const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+		const __m128i rounding = _mm_set1_epi16(2);
+
+		uint32_t x = 0;
+		for (; x + 8 <= outputs; x += 8)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(rowA + x * 2));
+			__m128i b = _mm_loadu_si128((const __m128i*)(rowB + x * 2));
+
+			__m128i sum = _mm_add_epi16(
+				_mm_add_epi16(_mm_and_si128(a, lowBytes), _mm_srli_epi16(a, 8)),
+				_mm_add_epi16(_mm_and_si128(b, lowBytes), _mm_srli_epi16(b, 8)));
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+
+			_mm_storel_epi64((__m128i*)(destination + x), _mm_packus_epi16(sum, sum));
+		}
+		return x;
+	}
+
+	// --------------------------------------------------------
+	// RGBA images: 2 outputs from 4 source pixels of each row.
+	// Widening puts pixel pairs in the two halves of a register,
+	// so regrouping the halves lines up each pair to add.
+	// --------------------------------------------------------
+	uint32_t DownsampleRowRGBA8SSE2(const uint8_t* rowA, const uint8_t* rowB, uint8_t* destination, uint32_t outputs)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+
+		uint32_t x = 0;
+		for (; x + 2 <= outputs; x += 2)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(rowA + x * 8));
+			__m128i b = _mm_loadu_si128((const __m128i*)(rowB + x * 8));
+
+			// Columns summed down both rows: pixels 0 and 1, then 2 and 3
+			__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+			// (0 + 1, 2 + 3)
+			__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+
+			_mm_storel_epi64((__m128i*)(destination + x * 4), _mm_packus_epi16(sum, sum));
+		}
+		return x;
+	}
+#endif
+
+	double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void AddStats(TextureCookStats& total, const TextureCookStats& more)
+	{
+		total.textures += more.textures;
+		total.failed += more.failed;
+		total.fileBytes += more.fileBytes;
+		total.pixelBytes += more.pixelBytes;
+		total.decodeMilliseconds += more.decodeMilliseconds;
+		total.mipMilliseconds += more.mipMilliseconds;
+		total.compressMilliseconds += more.compressMilliseconds;
+		total.cacheHits += more.cacheHits;
+	}
+}
+
+size_t CookedTexture::GetRowPitch(size_t mip) const
+{
+	if (IsBlockCompressed(format))
+		return (size_t)((mips[mip].width + 3) / 4) * GetBlockBytes((BlockFormat)(format - TextureFormat_BC1));
+	return (size_t)mips[mip].width * channels;
+}
+
+size_t CookedTexture::GetSlicePitch(size_t mip) const
+{
+	uint32_t rows = IsBlockCompressed(format) ? (mips[mip].height + 3) / 4 : mips[mip].height;
+	return GetRowPitch(mip) * rows;
+}
+
+// --------------------------------------------------------
+// Looks at the last word of the file name, so that both
+// "Lion_Normal.png" and "bronze_normals.png" are normal maps
+// --------------------------------------------------------
+template<typename CharType>
+static TextureUsage GuessTextureUsageImpl(const CharType* file)
+{
+	std::string name;
+	for (const CharType* c = file; *c; c++)
+		name += (char)tolower((int)(*c & 0x7F));
+
+	size_t slash = name.find_last_of("/\\");
+	if (slash != std::string::npos) name = name.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	if (dot != std::string::npos) name = name.substr(0, dot);
+	size_t underscore = name.find_last_of('_');
+	if (underscore != std::string::npos) name = name.substr(underscore + 1);
+
+	if (name == "normal" || name == "normals")
+		return TextureUsage_Normal;
+	if (name == "roughness" || name == "metal" || name == "metallic")
+		return TextureUsage_Mask;
+	return TextureUsage_Color;
+}
+
+TextureUsage GuessTextureUsage(const wchar_t* file) { return GuessTextureUsageImpl(file); }
+TextureUsage GuessTextureUsage(const char* file) { return GuessTextureUsageImpl(file); }
+
+BlockFormat GetCookedBlockFormat(TextureUsage usage)
+{
+	switch (usage)
+	{
+	case TextureUsage_Normal: return BlockFormat_BC5;
+	case TextureUsage_Mask: return BlockFormat_BC4;
+	case TextureUsage_RoughnessMetal: return BlockFormat_BC5;
+	default: return BlockFormat_BC7;
+	}
+}
+
+bool IsMipKernelSupported(MipKernel kernel)
+{
+	switch (kernel)
+	{
+	case MipKernel_Auto:
+	case MipKernel_Scalar:
+		return true;
+#ifdef NUBIX_MIPS_SSE
+	case MipKernel_SSE2:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+// --------------------------------------------------------
+// Makes the next mip down: each output pixel is the rounded
+// average of the 2x2 block it covers.  Odd sizes drop the
+// last row or column, as D3D's mip sizes round down.
+//
+// source - The level to downsample, rows packed tightly
+// width, height - Its size
+// channels - Bytes per pixel
+// destination - Room for max(1, width / 2) * max(1, height / 2) pixels
+// kernel - Instruction set to use (falls back to scalar)
+// --------------------------------------------------------
+void DownsampleBox(const uint8_t* source, uint32_t width, uint32_t height, uint32_t channels, uint8_t* destination, MipKernel kernel)
+{
+	uint32_t outWidth = std::max(1u, width / 2);
+	uint32_t outHeight = std::max(1u, height / 2);
+	size_t stride = (size_t)width * channels;
+
+	if (kernel == MipKernel_Auto || !IsMipKernelSupported(kernel))
+		kernel = IsMipKernelSupported(MipKernel_SSE2) ? MipKernel_SSE2 : MipKernel_Scalar;
+
+	// The SIMD rows never clamp, so only use them when every block is whole
+	bool simd = kernel == MipKernel_SSE2 && width >= 2 && height >= 2 && (channels == 1 || channels == 4);
+
+	for (uint32_t y = 0; y < outHeight; y++)
+	{
+		const uint8_t* rowA = source + std::min(y * 2, height - 1) * stride;
+		const uint8_t* rowB = source + std::min(y * 2 + 1, height - 1) * stride;
+		uint8_t* out = destination + (size_t)y * outWidth * channels;
+
+		uint32_t done = 0;
+#ifdef NUBIX_MIPS_SSE
+		if (simd)
+			done = channels == 1 ?
+				DownsampleRowR8SSE2(rowA, rowB, out, outWidth) :
+				DownsampleRowRGBA8SSE2(rowA, rowB, out, outWidth);
+#else
+		(void)simd;
+#endif
+		DownsampleRowScalar(rowA, rowB, width, channels, out, done, outWidth);
+	}
+}
+
+// --------------------------------------------------------
+// Builds the whole mip chain down to 1x1 after level 0,
+// growing the pixel storage once to fit it all
+// --------------------------------------------------------
+void GenerateMips(CookedTexture& texture, MipKernel kernel)
+{
+	if (texture.mips.size() != 1)
+		return;
+
+	// Lay out every level first
+	size_t total = texture.pixels.size();
+	uint32_t width = texture.mips[0].width;
+	uint32_t height = texture.mips[0].height;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+
+		TextureMip mip = { width, height, total };
+		texture.mips.push_back(mip);
+		total += (size_t)width * height * texture.channels;
+	}
+	texture.pixels.resize(total);
+
+	for (size_t i = 1; i < texture.mips.size(); i++)
+	{
+		const TextureMip& above = texture.mips[i - 1];
+		DownsampleBox(
+			texture.pixels.data() + above.offset,
+			above.width,
+			above.height,
+			texture.channels,
+			texture.pixels.data() + texture.mips[i].offset,
+			kernel);
+	}
+}
+
+// --------------------------------------------------------
+// Replaces every level of an R8 or RGBA8 texture with its
+// blocks.  D3D needs the top level of a block compressed
+// texture to be whole blocks, so other sizes are left alone.
+// --------------------------------------------------------
+bool CompressTexture(CookedTexture& texture, BlockFormat format)
+{
+	if (!texture.IsValid() || IsBlockCompressed(texture.format) ||
+		texture.mips[0].width % 4 != 0 || texture.mips[0].height % 4 != 0)
+		return false;
+
+	CookedTexture compressed;
+	compressed.format = (TextureFormat)(TextureFormat_BC1 + format);
+	compressed.channels = 4;
+
+	size_t total = 0;
+	for (const TextureMip& level : texture.mips)
+	{
+		TextureMip mip = { level.width, level.height, total };
+		compressed.mips.push_back(mip);
+		total += GetCompressedSize(format, level.width, level.height);
+	}
+	compressed.pixels.resize(total);
+
+	for (size_t i = 0; i < texture.mips.size(); i++)
+	{
+		const TextureMip& level = texture.mips[i];
+		CompressBlocks(
+			texture.pixels.data() + level.offset,
+			level.width,
+			level.height,
+			texture.channels,
+			format,
+			compressed.pixels.data() + compressed.mips[i].offset);
+	}
+
+	texture = std::move(compressed);
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies the first channel of a map's level 0 into every
+// fourth byte of a width x height destination, resampling
+// bilinearly (texel centers lined up) when the sizes differ
+// --------------------------------------------------------
+static void CopyFirstChannel(const CookedTexture& map, uint32_t width, uint32_t height, uint8_t* destination)
+{
+	uint32_t mapWidth = map.mips[0].width;
+	uint32_t mapHeight = map.mips[0].height;
+	const uint8_t* source = map.pixels.data() + map.mips[0].offset;
+	uint32_t channels = map.channels;
+
+	if (mapWidth == width && mapHeight == height)
+	{
+		for (size_t i = 0; i < (size_t)width * height; i++)
+			destination[i * 4] = source[i * channels];
+		return;
+	}
+
+	for (uint32_t y = 0; y < height; y++)
+	{
+		float sourceY = std::max(0.0f, (y + 0.5f) * mapHeight / height - 0.5f);
+		uint32_t y0 = std::min((uint32_t)sourceY, mapHeight - 1);
+		uint32_t y1 = std::min(y0 + 1, mapHeight - 1);
+		float fy = sourceY - y0;
+
+		for (uint32_t x = 0; x < width; x++)
+		{
+			float sourceX = std::max(0.0f, (x + 0.5f) * mapWidth / width - 0.5f);
+			uint32_t x0 = std::min((uint32_t)sourceX, mapWidth - 1);
+			uint32_t x1 = std::min(x0 + 1, mapWidth - 1);
+			float fx = sourceX - x0;
+
+			float top = source[((size_t)y0 * mapWidth + x0) * channels] * (1 - fx) + source[((size_t)y0 * mapWidth + x1) * channels] * fx;
+			float bottom = source[((size_t)y1 * mapWidth + x0) * channels] * (1 - fx) + source[((size_t)y1 * mapWidth + x1) * channels] * fx;
+			destination[((size_t)y * width + x) * 4] = (uint8_t)(top * (1 - fy) + bottom * fy + 0.5f);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Builds level 0 of a packed roughness/metal texture (see
+// the header), taking the first channel of each map (they're
+// grayscale, even when stored as RGB).  Blue is left 0 and
+// alpha 1, which BC5 drops anyway.
+// --------------------------------------------------------
+bool PackRoughnessMetalTexture(const CookedTexture& roughness, const CookedTexture& metal, CookedTexture& packed)
+{
+	const CookedTexture* maps[] = { &roughness, &metal };
+	for (const CookedTexture* map : maps)
+		if (!map->IsValid() || IsBlockCompressed(map->format))
+			return false;
+
+	uint32_t width = roughness.mips[0].width;
+	uint32_t height = roughness.mips[0].height;
+
+	packed = CookedTexture();
+	packed.format = TextureFormat_RGBA8;
+	packed.channels = 4;
+	packed.pixels.resize((size_t)width * height * 4);
+	TextureMip top = { width, height, 0 };
+	packed.mips.push_back(top);
+
+	for (int c = 0; c < 2; c++)
+		CopyFirstChannel(*maps[c], width, height, packed.pixels.data() + c);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		packed.pixels[i * 4 + 2] = 0;
+		packed.pixels[i * 4 + 3] = 255;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Where a texture's cooked version is cached.  Cooked files
+// live next to their source, and a packed texture is named
+// after both of its maps ("Cooked/Vase_roughness+Vase_metal
+// .dds"), since any two maps can be packed together.
+// --------------------------------------------------------
+template<typename CharType>
+static std::basic_string<CharType> GetCookedPath(const TextureSource<CharType>& source)
+{
+	typedef std::basic_string<CharType> String;
+	String file(source.file);
+	if (source.metal)
+	{
+		const CharType separators[] = { '/', '\\', 0 };
+		String metal(source.metal);
+		size_t slash = metal.find_last_of(separators);
+		size_t dot = metal.find_last_of('.');
+		size_t first = slash == String::npos ? 0 : slash + 1;
+		size_t last = dot == String::npos || dot < first ? metal.size() : dot;
+
+		// Insert "+<metal name>" before the roughness map's extension
+		slash = file.find_last_of(separators);
+		dot = file.find_last_of('.');
+		size_t insert = dot == String::npos || (slash != String::npos && dot < slash) ? file.size() : dot;
+		file.insert(insert, String(1, '+') + metal.substr(first, last - first));
+	}
+	return GetCookedTexturePath(file);
+}
+
+static bool DecodeMappedImage(const MappedFile& mapped, CookedTexture& texture)
+{
+	DecodedImage image = {};
+	if (!DecodePng((const uint8_t*)mapped.GetData(), mapped.GetSize(), image))
+		return false;
+
+	TextureMip top = { image.width, image.height, 0 };
+	texture = CookedTexture();
+	texture.format = image.channels == 1 ? TextureFormat_R8 : TextureFormat_RGBA8;
+	texture.channels = image.channels;
+	texture.pixels = std::move(image.pixels);
+	texture.mips.push_back(top);
+	return true;
+}
+
+// --------------------------------------------------------
+// Decodes a file (or packs the maps of a packed texture) and
+// builds its mips, or with the cache on, loads the cooked
+// version when it matches the sources' hash (and compresses
+// and writes it when it doesn't)
+// --------------------------------------------------------
+template<typename CharType>
+static bool CookTextureImpl(const TextureSource<CharType>& source, CookedTexture& texture, bool generateMips, TextureCacheMode cache, TextureCookStats* stats)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	texture = CookedTexture();
+
+	TextureCookStats fileStats = {};
+	fileStats.textures = 1;
+	fileStats.threads = 1;
+
+	// The image (or roughness map) and the metal map
+	bool packed = source.metal != 0;
+	MappedFile sources[2];
+	bool opened = sources[0].Open(source.file) && (!packed || sources[1].Open(source.metal));
+	for (const MappedFile& mapped : sources)
+		fileStats.fileBytes += mapped.GetSize();
+
+	// The sources are hashed rather than trusting timestamps, like cooked
+	// meshes, and a packed texture changes when either of its maps does
+	uint64_t sourceHash = 0;
+	if (opened && cache != TextureCache_Off)
+	{
+		uint64_t hashes[2] = {};
+		for (int i = 0; i < 2; i++)
+			if (sources[i].IsOpen())
+				hashes[i] = HashBytes(sources[i].GetData(), sources[i].GetSize());
+		sourceHash = packed ? HashBytes(hashes, sizeof(hashes)) : hashes[0];
+
+		if (cache == TextureCache_Use && ReadCookedTexture(GetCookedPath(source).c_str(), sourceHash, generateMips, texture))
+		{
+			fileStats.cacheHits = 1;
+			fileStats.pixelBytes = texture.pixels.size();
+			fileStats.decodeMilliseconds = fileStats.totalMilliseconds = MillisecondsSince(start);
+			if (stats)
+				*stats = fileStats;
+			return true;
+		}
+	}
+
+	bool decoded = false;
+	if (opened && !packed)
+	{
+		decoded = DecodeMappedImage(sources[0], texture);
+	}
+	else if (opened)
+	{
+		CookedTexture roughness;
+		CookedTexture metal;
+		decoded =
+			DecodeMappedImage(sources[0], roughness) &&
+			DecodeMappedImage(sources[1], metal) &&
+			PackRoughnessMetalTexture(roughness, metal, texture);
+	}
+	fileStats.decodeMilliseconds = MillisecondsSince(start);
+
+	if (decoded)
+	{
+		if (generateMips)
+		{
+			auto mipStart = std::chrono::high_resolution_clock::now();
+			GenerateMips(texture);
+			fileStats.mipMilliseconds = MillisecondsSince(mipStart);
+		}
+
+		// Sizes that aren't whole blocks stay uncompressed (and aren't cached)
+		if (cache != TextureCache_Off)
+		{
+			auto compressStart = std::chrono::high_resolution_clock::now();
+			TextureUsage usage = packed ? TextureUsage_RoughnessMetal : GuessTextureUsage(source.file);
+			if (CompressTexture(texture, GetCookedBlockFormat(usage)))
+				WriteCookedTexture(GetCookedPath(source).c_str(), texture, sourceHash);
+			fileStats.compressMilliseconds = MillisecondsSince(compressStart);
+		}
+		fileStats.pixelBytes = texture.pixels.size();
+	}
+	else
+	{
+		fileStats.failed = 1;
+	}
+
+	fileStats.totalMilliseconds = MillisecondsSince(start);
+	if (stats)
+		*stats = fileStats;
+	return decoded;
+}
+
+template<typename CharType>
+static TextureSource<CharType> ImageSource(const CharType* file)
+{
+	TextureSource<CharType> source = { file, 0 };
+	return source;
+}
+
+bool CookTextureFile(const wchar_t* file, CookedTexture& texture, bool generateMips, TextureCacheMode cache, TextureCookStats* stats) { return CookTextureImpl(ImageSource(file), texture, generateMips, cache, stats); }
+bool CookTextureFile(const char* file, CookedTexture& texture, bool generateMips, TextureCacheMode cache, TextureCookStats* stats) { return CookTextureImpl(ImageSource(file), texture, generateMips, cache, stats); }
+bool CookTexture(const TextureSource<wchar_t>& source, CookedTexture& texture, bool generateMips, TextureCacheMode cache, TextureCookStats* stats) { return CookTextureImpl(source, texture, generateMips, cache, stats); }
+bool CookTexture(const TextureSource<char>& source, CookedTexture& texture, bool generateMips, TextureCacheMode cache, TextureCookStats* stats) { return CookTextureImpl(source, texture, generateMips, cache, stats); }
+
+// --------------------------------------------------------
+// Workers (the calling thread included) take the next
+// uncooked file until there are none left, so big and small
+// files even out across threads.  Each texture lands at the
+// same index as its file.
+// --------------------------------------------------------
+template<typename CharType>
+static void CookTexturesImpl(const TextureSource<CharType>* sources, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache, TextureCookStats* stats, unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	textures.clear();
+	textures.resize(count);
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = (unsigned int)std::max<size_t>(1, std::min<size_t>(threadCount, count));
+
+	std::vector<TextureCookStats> fileStats(count, TextureCookStats());
+	std::atomic<size_t> next(0);
+	auto work = [&]()
+	{
+		for (size_t i = next++; i < count; i = next++)
+			CookTextureImpl(sources[i], textures[i], generateMips, cache, &fileStats[i]);
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount - 1);
+	for (unsigned int i = 1; i < threadCount; i++)
+		workers.push_back(std::thread(work));
+
+	work();
+	for (std::thread& worker : workers) worker.join();
+
+	if (stats)
+	{
+		*stats = TextureCookStats();
+		for (const TextureCookStats& file : fileStats)
+			AddStats(*stats, file);
+		stats->threads = threadCount;
+		stats->totalMilliseconds = MillisecondsSince(start);
+	}
+}
+
+template<typename CharType>
+static void CookTextureFilesImpl(const CharType* const* files, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache, TextureCookStats* stats, unsigned int threadCount)
+{
+	std::vector<TextureSource<CharType>> sources;
+	sources.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		sources.push_back(ImageSource(files[i]));
+	CookTexturesImpl(sources.data(), count, textures, generateMips, cache, stats, threadCount);
+}
+
+void CookTextureFiles(const wchar_t* const* files, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache, TextureCookStats* stats, unsigned int threadCount) { CookTextureFilesImpl(files, count, textures, generateMips, cache, stats, threadCount); }
+void CookTextureFiles(const char* const* files, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache, TextureCookStats* stats, unsigned int threadCount) { CookTextureFilesImpl(files, count, textures, generateMips, cache, stats, threadCount); }
+void CookTextures(const TextureSource<wchar_t>* sources, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache, TextureCookStats* stats, unsigned int threadCount) { CookTexturesImpl(sources, count, textures, generateMips, cache, stats, threadCount); }
+void CookTextures(const TextureSource<char>* sources, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache, TextureCookStats* stats, unsigned int threadCount) { CookTexturesImpl(sources, count, textures, generateMips, cache, stats, threadCount); }
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// CPU-side texture loading shared by the engine and the
+// offline cooker: decoding on worker threads, building mip
+// chains and block compressing them, with compressed results
+// cached on disk (see TextureCache.h), ready to hand to the
+// GPU in one upload.  None of this touches the GPU.
+// --------------------------------------------------------
+
+// Instruction sets the mip downsample can use
+enum MipKernel
+{
+	MipKernel_Auto,			// Widest one the CPU supports
+	MipKernel_Scalar,
+	MipKernel_SSE2,			// 16 bytes of each source row at a time
+};
+
+// Whether this build and CPU can run the given kernel
+bool IsMipKernelSupported(MipKernel kernel);
+
+// What a texture holds, which decides how it's compressed
+enum TextureUsage
+{
+	TextureUsage_Color,		// Albedo and the like: BC7
+	TextureUsage_Normal,	// Tangent space normals, only x and y kept: BC5
+	TextureUsage_Mask,		// One channel (roughness, metal): BC4
+	TextureUsage_RoughnessMetal,	// Roughness and metal packed in red and green: BC5
+};
+
+// Guesses a texture's usage from the end of its file name ("_normal",
+// "_roughness", "_metal" and so on), treating anything else as color
+TextureUsage GuessTextureUsage(const wchar_t* file);
+TextureUsage GuessTextureUsage(const char* file);
+
+// The block format each usage is cooked to
+BlockFormat GetCookedBlockFormat(TextureUsage usage);
+
+// How a CookedTexture's pixels are stored
+enum TextureFormat
+{
+	TextureFormat_R8,
+	TextureFormat_RGBA8,
+	TextureFormat_BC1,
+	TextureFormat_BC3,
+	TextureFormat_BC4,
+	TextureFormat_BC5,
+	TextureFormat_BC7,
+};
+
+// Whether pixels are stored in 4x4 blocks
+inline bool IsBlockCompressed(TextureFormat format) { return format >= TextureFormat_BC1; }
+
+// How CookTextureFile() treats the cache of compressed textures
+enum TextureCacheMode
+{
+	TextureCache_Off,		// Just decode (and build mips), never compressing
+	TextureCache_Use,		// Load the cached version if it's up to date, otherwise cook and cache it
+	TextureCache_Rebuild,	// Always cook and cache
+};
+
+// One level of a CookedTexture's mip chain
+struct TextureMip
+{
+	uint32_t width;
+	uint32_t height;
+	size_t offset;		// Into CookedTexture::pixels
+};
+
+// --------------------------------------------------------
+// A decoded texture and its mips, every level packed tightly
+// one after another in pixels (level 0 first).  Compressed
+// levels are rows of blocks.  An empty mip list means the
+// file couldn't be decoded.
+// --------------------------------------------------------
+struct CookedTexture
+{
+	TextureFormat format;
+	uint32_t channels;		// 1 (R8) or 4 (RGBA8) when uncompressed
+	std::vector<uint8_t> pixels;
+	std::vector<TextureMip> mips;
+
+	bool IsValid() const { return !mips.empty(); }
+	size_t GetRowPitch(size_t mip) const;
+	size_t GetSlicePitch(size_t mip) const;
+};
+
+// --------------------------------------------------------
+// Timing for a set of textures.  Decode and mip times are
+// added up over every thread; the total is wall time.
+// --------------------------------------------------------
+struct TextureCookStats
+{
+	size_t textures;
+	size_t failed;
+	uint64_t fileBytes;
+	uint64_t pixelBytes;		// Every mip of every texture
+	double decodeMilliseconds;
+	double mipMilliseconds;
+	double compressMilliseconds;
+	double totalMilliseconds;
+	size_t cacheHits;		// Loaded straight from the cache
+	unsigned int threads;
+};
+
+// Halves an image in each direction (down to 1) with a 2x2 box filter
+void DownsampleBox(const uint8_t* source, uint32_t width, uint32_t height, uint32_t channels, uint8_t* destination, MipKernel kernel = MipKernel_Auto);
+
+// Fills in every mip below level 0 (which must be the only one so far)
+void GenerateMips(CookedTexture& texture, MipKernel kernel = MipKernel_Auto);
+
+// Compresses every level of an uncompressed texture (level 0 must be a multiple of 4 in size)
+bool CompressTexture(CookedTexture& texture, BlockFormat format);
+
+// --------------------------------------------------------
+// Roughness and metal maps packed into the red and green of
+// one texture, so a material samples one texture instead of
+// two.  These aren't authored: they're cooked from whichever
+// two maps the material names, at the roughness map's size,
+// and compressed to BC5 (the same 8 bits per pixel as the
+// two maps as BC4, with no channel wasted).
+// --------------------------------------------------------
+bool PackRoughnessMetalTexture(const CookedTexture& roughness, const CookedTexture& metal, CookedTexture& packed);
+
+// --------------------------------------------------------
+// What one texture is cooked from: an image file, or when a
+// metal map is given too, the two maps of a packed
+// roughness/metal texture
+// --------------------------------------------------------
+template<typename CharType>
+struct TextureSource
+{
+	const CharType* file;		// The image, or the roughness map of a packed texture
+	const CharType* metal;		// The metal map packed with it, or null for a plain image
+};
+
+// Memory-maps and decodes one image file (PNG only), optionally with
+// mips, or loads/writes its compressed version in the cache
+bool CookTextureFile(const wchar_t* file, CookedTexture& texture, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0);
+bool CookTextureFile(const char* file, CookedTexture& texture, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0);
+
+// Same as CookTextureFile(), but for an image or a packed texture
+bool CookTexture(const TextureSource<wchar_t>& source, CookedTexture& texture, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0);
+bool CookTexture(const TextureSource<char>& source, CookedTexture& texture, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0);
+
+// Cooks many files at once, each on whichever worker thread is free.  A
+// thread count of 0 uses every core (but never more threads than files).
+void CookTextureFiles(const wchar_t* const* files, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0, unsigned int threadCount = 0);
+void CookTextureFiles(const char* const* files, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0, unsigned int threadCount = 0);
+
+// Same as CookTextureFiles(), but for images and packed textures
+void CookTextures(const TextureSource<wchar_t>* sources, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0, unsigned int threadCount = 0);
+void CookTextures(const TextureSource<char>* sources, size_t count, std::vector<CookedTexture>& textures, bool generateMips, TextureCacheMode cache = TextureCache_Off, TextureCookStats* stats = 0, unsigned int threadCount = 0);
@@ -0,0 +1,312 @@
+#include "TlsfAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// --------------------------------------------------------
+// Index of the highest and lowest set bits (v can't be 0)
+// --------------------------------------------------------
+static uint32_t HighestBit(uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, v);
+	return index;
+#else
+	return 63 - __builtin_clzll(v);
+#endif
+}
+
+static uint32_t LowestBit(uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, v);
+	return index;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity) :
+	capacity(capacity & ~(TlsfGranularity - 1)),
+	allocations(0),
+	usedBytes(0),
+	freeBlockCount(0),
+	unusedBlocks(None),
+	firstLevelMap(0)
+{
+	for (uint32_t f = 0; f < FirstLevelCount; f++)
+	{
+		secondLevelMaps[f] = 0;
+		for (uint32_t s = 0; s < SecondLevelCount; s++)
+			freeLists[f][s] = None;
+	}
+
+	// Everything starts out as one free block
+	if (this->capacity > 0)
+		InsertFree(NewBlock(0, this->capacity));
+}
+
+// --------------------------------------------------------
+// Finds the size class a block belongs in.  Below the
+// linear cutoff each granule has its own class; above it,
+// each power of two is split into SecondLevelCount classes.
+// --------------------------------------------------------
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	if (size < (1ull << FirstLevelShift))
+	{
+		firstLevel = 0;
+		secondLevel = (uint32_t)(size / TlsfGranularity);
+	}
+	else
+	{
+		uint32_t high = HighestBit(size);
+		secondLevel = (uint32_t)(size >> (high - SecondLevelBits)) ^ SecondLevelCount;
+		firstLevel = high - FirstLevelShift + 1;
+	}
+}
+
+// --------------------------------------------------------
+// Hands out a range of at least the given size, starting on
+// a multiple of the alignment.  Returns false if no free
+// block is big enough.
+//
+// size - Bytes needed (rounded up to TlsfGranularity)
+// alignment - Power of two the offset must be a multiple of
+// allocation - Receives the range
+// --------------------------------------------------------
+bool TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, TlsfAllocation& allocation)
+{
+	size = AlignUp(size > 0 ? size : 1, TlsfGranularity);
+	if (alignment < TlsfGranularity)
+		alignment = TlsfGranularity;
+
+	// Offsets are already granule aligned, so a block this
+	// much bigger always has room to pad up to the alignment
+	uint64_t needed = size + alignment - TlsfGranularity;
+	if (needed > capacity)
+		return false;
+
+	uint32_t index = FindFree(needed);
+	if (index == None)
+		return false;
+	RemoveFree(index);
+
+	// Give any padding before the aligned offset back as its own block
+	uint64_t padding = AlignUp(blocks[index].offset, alignment) - blocks[index].offset;
+	if (padding > 0)
+	{
+		uint32_t aligned = Split(index, padding);
+		InsertFree(index);
+		index = aligned;
+	}
+
+	// And whatever's left after the range
+	if (blocks[index].size > size)
+		InsertFree(Split(index, size));
+
+	allocations++;
+	usedBytes += blocks[index].size;
+
+	allocation.offset = blocks[index].offset;
+	allocation.size = blocks[index].size;
+	allocation.block = index;
+	return true;
+}
+
+// --------------------------------------------------------
+// Returns a range, merging it with any free neighbors
+// --------------------------------------------------------
+void TlsfAllocator::Free(const TlsfAllocation& allocation)
+{
+	uint32_t index = allocation.block;
+	allocations--;
+	usedBytes -= blocks[index].size;
+
+	uint32_t next = blocks[index].next;
+	if (next != None && blocks[next].free)
+	{
+		RemoveFree(next);
+		Merge(index, next);
+	}
+
+	uint32_t previous = blocks[index].previous;
+	if (previous != None && blocks[previous].free)
+	{
+		RemoveFree(previous);
+		Merge(previous, index);
+		index = previous;
+	}
+
+	InsertFree(index);
+}
+
+TlsfStats TlsfAllocator::GetStats() const
+{
+	TlsfStats stats = {};
+	stats.capacity = capacity;
+	stats.usedBytes = usedBytes;
+	stats.freeBytes = capacity - usedBytes;
+	stats.allocations = allocations;
+	stats.freeBlocks = freeBlockCount;
+
+	// The largest free block is somewhere in the highest non-empty list
+	if (firstLevelMap != 0)
+	{
+		uint32_t f = HighestBit(firstLevelMap);
+		uint32_t s = HighestBit(secondLevelMaps[f]);
+		for (uint32_t i = freeLists[f][s]; i != None; i = blocks[i].nextFree)
+		{
+			if (blocks[i].size > stats.largestFreeBlock)
+				stats.largestFreeBlock = blocks[i].size;
+		}
+	}
+
+	return stats;
+}
+
+uint32_t TlsfAllocator::NewBlock(uint64_t offset, uint64_t size)
+{
+	uint32_t index = unusedBlocks;
+	if (index != None)
+	{
+		unusedBlocks = blocks[index].nextFree;
+	}
+	else
+	{
+		index = (uint32_t)blocks.size();
+		blocks.push_back(Block());
+	}
+
+	Block& block = blocks[index];
+	block.offset = offset;
+	block.size = size;
+	block.previous = None;
+	block.next = None;
+	block.previousFree = None;
+	block.nextFree = None;
+	block.free = false;
+	return index;
+}
+
+void TlsfAllocator::DeleteBlock(uint32_t index)
+{
+	blocks[index].nextFree = unusedBlocks;
+	unusedBlocks = index;
+}
+
+void TlsfAllocator::InsertFree(uint32_t index)
+{
+	uint32_t f, s;
+	Mapping(blocks[index].size, f, s);
+
+	uint32_t head = freeLists[f][s];
+	blocks[index].free = true;
+	blocks[index].previousFree = None;
+	blocks[index].nextFree = head;
+	if (head != None)
+		blocks[head].previousFree = index;
+
+	freeLists[f][s] = index;
+	secondLevelMaps[f] |= 1u << s;
+	firstLevelMap |= 1ull << f;
+	freeBlockCount++;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t index)
+{
+	uint32_t f, s;
+	Mapping(blocks[index].size, f, s);
+
+	Block& block = blocks[index];
+	if (block.previousFree != None)
+		blocks[block.previousFree].nextFree = block.nextFree;
+	if (block.nextFree != None)
+		blocks[block.nextFree].previousFree = block.previousFree;
+
+	if (freeLists[f][s] == index)
+	{
+		freeLists[f][s] = block.nextFree;
+		if (block.nextFree == None)
+		{
+			secondLevelMaps[f] &= ~(1u << s);
+			if (secondLevelMaps[f] == 0)
+				firstLevelMap &= ~(1ull << f);
+		}
+	}
+
+	block.free = false;
+	block.previousFree = None;
+	block.nextFree = None;
+	freeBlockCount--;
+}
+
+// --------------------------------------------------------
+// Finds a free block of at least the given size.  The size
+// is rounded up to the next class boundary first, so any
+// block in the class that's found is big enough.
+// --------------------------------------------------------
+uint32_t TlsfAllocator::FindFree(uint64_t size)
+{
+	if (size >= (1ull << FirstLevelShift))
+		size += (1ull << (HighestBit(size) - SecondLevelBits)) - 1;
+
+	uint32_t f, s;
+	Mapping(size, f, s);
+	if (f >= FirstLevelCount)
+		return None;
+
+	// Anything in this first level class that's big enough, otherwise any larger class
+	uint32_t secondLevelMap = secondLevelMaps[f] & (~0u << s);
+	if (secondLevelMap == 0)
+	{
+		uint64_t firstLevelMapAbove = f + 1 < 64 ? firstLevelMap & (~0ull << (f + 1)) : 0;
+		if (firstLevelMapAbove == 0)
+			return None;
+
+		f = LowestBit(firstLevelMapAbove);
+		secondLevelMap = secondLevelMaps[f];
+	}
+
+	return freeLists[f][LowestBit(secondLevelMap)];
+}
+
+// --------------------------------------------------------
+// Cuts a block in two, keeping the first size bytes in the
+// original and returning the new block for the rest
+// --------------------------------------------------------
+uint32_t TlsfAllocator::Split(uint32_t index, uint64_t size)
+{
+	uint32_t rest = NewBlock(blocks[index].offset + size, blocks[index].size - size);
+
+	// NewBlock() may have moved the blocks, so index again from here
+	blocks[rest].previous = index;
+	blocks[rest].next = blocks[index].next;
+	if (blocks[index].next != None)
+		blocks[blocks[index].next].previous = rest;
+
+	blocks[index].next = rest;
+	blocks[index].size = size;
+	return rest;
+}
+
+// --------------------------------------------------------
+// Folds a block into the physical neighbor before it
+// --------------------------------------------------------
+void TlsfAllocator::Merge(uint32_t first, uint32_t second)
+{
+	blocks[first].size += blocks[second].size;
+	blocks[first].next = blocks[second].next;
+	if (blocks[second].next != None)
+		blocks[blocks[second].next].previous = first;
+
+	DeleteBlock(second);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Every range starts and ends on a multiple of this
+const uint64_t TlsfGranularity = 16;
+
+// One range handed out by a TlsfAllocator
+struct TlsfAllocation
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t block;		// Needed to free it
+};
+
+// How a TlsfAllocator's space is split up right now
+struct TlsfStats
+{
+	uint64_t capacity;
+	uint64_t usedBytes;
+	uint64_t freeBytes;
+	uint64_t largestFreeBlock;
+	size_t allocations;
+	size_t freeBlocks;
+
+	// 0 when all free space is one block, approaching 1 as it splinters
+	float GetFragmentation() const { return freeBytes > 0 ? 1.0f - (float)largestFreeBlock / freeBytes : 0.0f; }
+};
+
+// --------------------------------------------------------
+// Two-level segregated fit allocator for ranges of some
+// fixed-size space (like one big GPU buffer).  It never
+// touches the space itself, just tracks offsets.  Free
+// blocks are kept in lists by size class, so allocating and
+// freeing are constant time, and a freed range merges with
+// free neighbors straight away.
+// --------------------------------------------------------
+class TlsfAllocator
+{
+public:
+	explicit TlsfAllocator(uint64_t capacity);
+
+	// Finds an aligned range (alignment must be a power of two)
+	bool Allocate(uint64_t size, uint64_t alignment, TlsfAllocation& allocation);
+	void Free(const TlsfAllocation& allocation);
+
+	TlsfStats GetStats() const;
+	uint64_t GetCapacity() const { return capacity; }
+	bool IsEmpty() const { return allocations == 0; }
+
+private:
+	// Second level lists per first level class, and where the
+	// first level stops being linear (below it, one class per granule)
+	static const uint32_t SecondLevelBits = 5;
+	static const uint32_t SecondLevelCount = 1 << SecondLevelBits;
+	static const uint32_t FirstLevelShift = SecondLevelBits + 4;	// log2(TlsfGranularity) is 4
+	static const uint32_t FirstLevelCount = 64 - FirstLevelShift + 1;
+	static const uint32_t None = 0xFFFFFFFF;
+
+	struct Block
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t previous;		// Physical neighbors
+		uint32_t next;
+		uint32_t previousFree;	// Free list links (or the next unused entry)
+		uint32_t nextFree;
+		bool free;
+	};
+
+	uint64_t capacity;
+	size_t allocations;
+	uint64_t usedBytes;
+	size_t freeBlockCount;
+
+	std::vector<Block> blocks;
+	uint32_t unusedBlocks;		// Recycled Block entries
+
+	uint64_t firstLevelMap;
+	uint32_t secondLevelMaps[FirstLevelCount];
+	uint32_t freeLists[FirstLevelCount][SecondLevelCount];
+
+	static void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	uint32_t NewBlock(uint64_t offset, uint64_t size);
+	void DeleteBlock(uint32_t index);
+	void InsertFree(uint32_t index);
+	void RemoveFree(uint32_t index);
+	uint32_t FindFree(uint64_t size);
+	uint32_t Split(uint32_t index, uint64_t size);
+	void Merge(uint32_t first, uint32_t second);
+};
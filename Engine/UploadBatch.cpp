@@ -0,0 +1,141 @@
+#include "UploadBatch.h"
+
+#include <cstring>
+
+UploadBatch::UploadBatch(UploadBatchBackend& backend, uint64_t arenaSize, size_t maxPooledArenas) :
+	backend(backend),
+	arenaSize(arenaSize),
+	maxPooledArenas(maxPooledArenas),
+	depth(0),
+	current(),
+	stats()
+{
+}
+
+// --------------------------------------------------------
+// Releases everything, assuming the GPU is done with it
+// (callers wait for the GPU before tearing down)
+// --------------------------------------------------------
+UploadBatch::~UploadBatch()
+{
+	for (const Arena& arena : arenas)
+		backend.ReleaseArena(arena.handle);
+	for (const RetiredArena& retiredArena : retired)
+		backend.ReleaseArena(retiredArena.arena.handle);
+	for (const Arena& arena : pool)
+		backend.ReleaseArena(arena.handle);
+}
+
+void UploadBatch::Begin()
+{
+	if (depth++ == 0)
+	{
+		ReleaseCompleted();
+		current = UploadBatchStats();
+	}
+}
+
+// --------------------------------------------------------
+// Copies one buffer's data into the batch's staging memory
+// and records the copy to its destination.  The data can be
+// freed as soon as this returns.
+//
+// destination - Backend buffer to fill
+// destinationOffset - Where in the buffer the data goes
+// data - Bytes to upload
+// size - How many bytes
+// --------------------------------------------------------
+void UploadBatch::Stage(void* destination, uint64_t destinationOffset, const void* data, uint64_t size)
+{
+	// Buffers share the most recent arena until it fills up
+	Arena* arena = arenas.empty() ? 0 : &arenas.back();
+	uint64_t offset = arena ? (arena->used + UploadBatchAlignment - 1) & ~(UploadBatchAlignment - 1) : 0;
+	if (!arena || offset + size > arena->size)
+	{
+		arenas.push_back(TakeArena(size));
+
+		arena = &arenas.back();
+		offset = 0;
+		current.arenas++;
+	}
+
+	memcpy(arena->memory + offset, data, (size_t)size);
+	arena->used = offset + size;
+
+	backend.RecordCopy(destination, destinationOffset, arena->handle, offset, size);
+	backend.RecordFinished(destination);
+
+	current.buffers++;
+	current.bytes += size;
+}
+
+// --------------------------------------------------------
+// Closes a batch.  The outermost End() submits everything
+// staged since Begin() (without waiting for it) and returns
+// the fence value that signals when it's all on the GPU;
+// nested ones return 0.
+// --------------------------------------------------------
+uint64_t UploadBatch::End()
+{
+	if (depth == 0 || --depth > 0)
+		return 0;
+
+	uint64_t fenceValue = backend.Submit();
+	for (const Arena& arena : arenas)
+	{
+		RetiredArena done = { fenceValue, arena };
+		retired.push_back(done);
+	}
+	arenas.clear();
+	stats = current;
+
+	ReleaseCompleted();
+	return fenceValue;
+}
+
+// --------------------------------------------------------
+// Arenas of batches the GPU has finished go back to the
+// pool.  Oversized ones (made for a single big buffer) and
+// any that would grow the pool past its limit are released.
+// --------------------------------------------------------
+void UploadBatch::ReleaseCompleted()
+{
+	uint64_t completed = backend.GetCompletedFenceValue();
+	while (!retired.empty() && retired.front().fenceValue <= completed)
+	{
+		const Arena& arena = retired.front().arena;
+		if (arena.size == arenaSize && pool.size() < maxPooledArenas)
+			pool.push_back(arena);
+		else
+			backend.ReleaseArena(arena.handle);
+		retired.pop_front();
+	}
+}
+
+// --------------------------------------------------------
+// Gets an empty arena with room for at least size bytes:
+// a pooled one if the buffer fits in a regular arena and
+// the GPU is done with one, or else a new one
+// --------------------------------------------------------
+UploadBatch::Arena UploadBatch::TakeArena(uint64_t size)
+{
+	if (size <= arenaSize)
+	{
+		if (pool.empty())
+			ReleaseCompleted();
+
+		if (!pool.empty())
+		{
+			Arena reused = pool.back();
+			pool.pop_back();
+			reused.used = 0;
+			return reused;
+		}
+	}
+
+	Arena fresh = {};
+	fresh.size = size > arenaSize ? size : arenaSize;
+	fresh.handle = backend.CreateArena(fresh.size, fresh.memory);
+	current.createdArenas++;
+	return fresh;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Staged buffers start on multiples of this within an arena
+const uint64_t UploadBatchAlignment = 16;
+
+// --------------------------------------------------------
+// What a batch needs from a graphics API: CPU-writable
+// arenas to stage data in, copies out of them, and one
+// fenced submission.  Arenas and destinations are whatever
+// the backend uses for a buffer (ID3D12Resource* for D3D12).
+// --------------------------------------------------------
+class UploadBatchBackend
+{
+public:
+	virtual ~UploadBatchBackend() {}
+
+	// Creates staging memory, returning its handle and CPU address
+	virtual void* CreateArena(uint64_t size, uint8_t*& memory) = 0;
+	virtual void ReleaseArena(void* arena) = 0;
+
+	// Records a copy from an arena into a destination buffer
+	virtual void RecordCopy(void* destination, uint64_t destinationOffset, void* arena, uint64_t arenaOffset, uint64_t size) = 0;
+
+	// Records whatever a destination needs once its data is copied
+	virtual void RecordFinished(void* destination) = 0;
+
+	// Submits everything recorded, returning the fence value that signals when it's done
+	virtual uint64_t Submit() = 0;
+	virtual uint64_t GetCompletedFenceValue() = 0;
+};
+
+// Totals for the most recently submitted batch
+struct UploadBatchStats
+{
+	size_t buffers;
+	size_t arenas;
+	size_t createdArenas;	// The rest were reused
+	uint64_t bytes;
+};
+
+// --------------------------------------------------------
+// Uploads many static buffers with a single submission.
+// Begin() opens a batch, Stage() copies each buffer's data
+// into shared arenas (a buffer bigger than an arena gets
+// one of its own) and records its copy, and End() submits
+// them all at once without waiting.  Once the fence value
+// of their batch completes, arenas go back to a pool for
+// later batches (up to maxPooledArenas of them; the rest,
+// and any oversized ones, are released), so new ones are
+// only created when the pool is empty.  Batches nest, and
+// only the outermost End() submits.
+// --------------------------------------------------------
+class UploadBatch
+{
+public:
+	UploadBatch(UploadBatchBackend& backend, uint64_t arenaSize, size_t maxPooledArenas);
+	~UploadBatch();
+
+	void Begin();
+	void Stage(void* destination, uint64_t destinationOffset, const void* data, uint64_t size);
+	uint64_t End();
+
+	// Pools (or releases) the arenas of every batch the GPU has finished
+	void ReleaseCompleted();
+
+	bool IsOpen() const { return depth > 0; }
+	size_t GetLiveArenaCount() const { return arenas.size() + retired.size() + pool.size(); }
+	size_t GetPooledArenaCount() const { return pool.size(); }
+	const UploadBatchStats& GetStats() const { return stats; }
+
+private:
+	struct Arena
+	{
+		void* handle;
+		uint8_t* memory;
+		uint64_t size;
+		uint64_t used;
+	};
+
+	struct RetiredArena
+	{
+		uint64_t fenceValue;
+		Arena arena;
+	};
+
+	UploadBatchBackend& backend;
+	uint64_t arenaSize;
+	size_t maxPooledArenas;
+	int depth;
+
+	std::vector<Arena> arenas;		// Staging the open batch
+	std::deque<RetiredArena> retired;	// Waiting for their batch to finish
+	std::vector<Arena> pool;		// Finished with, ready for another batch
+	UploadBatchStats current;
+	UploadBatchStats stats;
+
+	Arena TakeArena(uint64_t size);
+};
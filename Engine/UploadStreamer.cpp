@@ -0,0 +1,104 @@
+#include "UploadStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+
+UploadStreamer::UploadStreamer(UploadBackend& backend, uint64_t ringCapacity, uint64_t budgetPerFrame) :
+	backend(backend),
+	ring(ringCapacity),
+	budgetPerFrame(budgetPerFrame),
+	nextTicket(1),
+	completedTicket(0),
+	bytesQueued(0),
+	stats()
+{
+}
+
+// --------------------------------------------------------
+// Adds an upload to the back of the queue.  Nothing is
+// copied until RecordUploads().
+//
+// destination - Backend buffer to fill
+// destinationOffset - Where in the buffer the data goes
+// data - Bytes to upload
+// size - How many bytes
+// owner - Keeps data alive until it has all been staged
+// Returns a ticket for checking when the upload is done
+// --------------------------------------------------------
+UploadTicket UploadStreamer::Queue(void* destination, uint64_t destinationOffset, const void* data, uint64_t size, std::shared_ptr<const void> owner)
+{
+	Request request;
+	request.ticket = nextTicket++;
+	request.destination = destination;
+	request.destinationOffset = destinationOffset;
+	request.data = (const uint8_t*)data;
+	request.size = size;
+	request.staged = 0;
+	request.owner = std::move(owner);
+	queue.push_back(std::move(request));
+
+	bytesQueued += size;
+	return queue.back().ticket;
+}
+
+// --------------------------------------------------------
+// Once per frame, before the frame's commands are submitted:
+// reclaims staging space from finished frames, then copies
+// queued data into the ring (up to the per-frame budget, or
+// until the ring is full) and records the copies.
+//
+// completedFenceValue - Most recent fence value the GPU has finished
+// submitFenceValue - Fence value the GPU will signal after this frame
+// --------------------------------------------------------
+void UploadStreamer::RecordUploads(uint64_t completedFenceValue, uint64_t submitFenceValue)
+{
+	ring.Reclaim(completedFenceValue);
+	while (!inFlight.empty() && inFlight.front().fenceValue <= completedFenceValue)
+	{
+		completedTicket = inFlight.front().ticket;
+		inFlight.pop_front();
+	}
+
+	uint64_t budget = budgetPerFrame;
+	UploadTicket lastRecorded = 0;
+	uint8_t* staging = backend.GetStagingMemory();
+
+	while (!queue.empty() && budget > 0)
+	{
+		Request& request = queue.front();
+
+		// As much of this upload as the budget and ring allow
+		uint64_t chunk = std::min(request.size - request.staged, std::min(budget, ring.GetLargestFreeBlock()));
+		uint64_t offset = 0;
+		if (request.size > 0 && (chunk == 0 || !ring.Allocate(chunk, offset)))
+			break;
+
+		if (chunk > 0)
+		{
+			memcpy(staging + offset, request.data + request.staged, (size_t)chunk);
+			backend.RecordCopy(request.destination, request.destinationOffset + request.staged, offset, chunk);
+			request.staged += chunk;
+			budget -= chunk;
+			bytesQueued -= chunk;
+		}
+
+		if (request.staged == request.size)
+		{
+			backend.RecordFinished(request.destination);
+			lastRecorded = request.ticket;
+			queue.pop_front();
+		}
+	}
+
+	ring.FinishFrame(submitFenceValue);
+	if (lastRecorded != 0)
+	{
+		InFlight frame = { submitFenceValue, lastRecorded };
+		inFlight.push_back(frame);
+	}
+
+	stats.bytesThisFrame = budgetPerFrame - budget;
+	stats.bytesQueued = bytesQueued;
+	stats.uploadsQueued = queue.size();
+	stats.ringUsed = ring.GetUsed();
+}
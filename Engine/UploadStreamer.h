@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "FrameRing.h"
+
+// Identifies one queued upload.  Uploads finish in the order
+// they were queued, and 0 never needs waiting for.
+typedef uint64_t UploadTicket;
+
+// --------------------------------------------------------
+// What the streamer needs from a graphics API: somewhere to
+// write staging data, and a way to record copies out of it.
+// Destinations are whatever the backend uses for a buffer
+// (an ID3D12Resource* for D3D12).
+// --------------------------------------------------------
+class UploadBackend
+{
+public:
+	virtual ~UploadBackend() {}
+
+	// CPU address of the staging ring's memory
+	virtual uint8_t* GetStagingMemory() = 0;
+
+	// Records a copy from the staging ring into a destination buffer
+	virtual void RecordCopy(void* destination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) = 0;
+
+	// Records whatever a destination needs once all of its data is copied
+	virtual void RecordFinished(void* destination) = 0;
+};
+
+// Totals from the most recent RecordUploads()
+struct UploadStreamerStats
+{
+	uint64_t bytesThisFrame;
+	uint64_t bytesQueued;		// Still waiting for staging space
+	size_t uploadsQueued;
+	uint64_t ringUsed;
+};
+
+// --------------------------------------------------------
+// Streams buffer data to the GPU a little at a time.  Each
+// frame, RecordUploads() copies up to the per-frame budget
+// of queued data into the staging ring and records copies
+// from there, splitting big uploads across frames.  Not
+// thread safe: queue and record from the rendering thread.
+// --------------------------------------------------------
+class UploadStreamer
+{
+public:
+	UploadStreamer(UploadBackend& backend, uint64_t ringCapacity, uint64_t budgetPerFrame);
+
+	// Queues data for a destination.  owner keeps data alive until it's staged.
+	UploadTicket Queue(void* destination, uint64_t destinationOffset, const void* data, uint64_t size, std::shared_ptr<const void> owner);
+
+	// Stages and records this frame's share of the queue
+	void RecordUploads(uint64_t completedFenceValue, uint64_t submitFenceValue);
+
+	bool IsComplete(UploadTicket ticket) const { return ticket <= completedTicket; }
+	bool IsIdle() const { return queue.empty() && inFlight.empty(); }
+	const UploadStreamerStats& GetStats() const { return stats; }
+
+private:
+	struct Request
+	{
+		UploadTicket ticket;
+		void* destination;
+		uint64_t destinationOffset;
+		const uint8_t* data;
+		uint64_t size;
+		uint64_t staged;
+		std::shared_ptr<const void> owner;
+	};
+
+	// The last upload a submitted frame finished recording
+	struct InFlight
+	{
+		uint64_t fenceValue;
+		UploadTicket ticket;
+	};
+
+	UploadBackend& backend;
+	FrameRing ring;
+	uint64_t budgetPerFrame;
+
+	std::deque<Request> queue;
+	std::deque<InFlight> inFlight;
+	UploadTicket nextTicket;
+	UploadTicket completedTicket;
+	uint64_t bytesQueued;
+	UploadStreamerStats stats;
+};
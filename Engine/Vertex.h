@@ -12,5 +12,5 @@ struct Vertex
 	DirectX::XMFLOAT3 Position;	    // The local position of the vertex
 	DirectX::XMFLOAT2 UV;			// The color of the vertex
 	DirectX::XMFLOAT3 Normal;		// Normal for lighting
-	DirectX::XMFLOAT3 Tangent;		// Tangent for normal mapping
+	DirectX::XMFLOAT4 Tangent;		// Tangent for normal mapping (w is the bitangent sign)
 };
\ No newline at end of file
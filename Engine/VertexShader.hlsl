@@ -1,20 +1,34 @@
 
 
-cbuffer ExternalData : register(b0)
+// Data that's the same for every object this frame
+cbuffer perFrame : register(b0)
 {
-	matrix world;
-	matrix worldInverseTranspose;
 	matrix view;
 	matrix projection;
 }
 
+// Which object this draw is (a root constant)
+cbuffer perDraw : register(b1)
+{
+	uint drawID;
+}
+
+// Data for every object drawn this frame
+struct ObjectData
+{
+	matrix world;
+	matrix worldInverseTranspose;
+	float4 color;
+};
+StructuredBuffer<ObjectData> objects : register(t0, space1);
+
 // Struct representing a single vertex worth of data
 struct VertexShaderInput
 {
 	float3 localPosition	: POSITION;
 	float2 uv				: TEXCOORD;
 	float3 normal			: NORMAL;
-	float3 tangent			: TANGENT;
+	float4 tangent			: TANGENT;	// w is the bitangent sign
 };
 
 // Struct representing the data we're sending down the pipeline
@@ -23,8 +37,9 @@ struct VertexToPixel
 	float4 screenPosition	: SV_POSITION;
 	float2 uv				: TEXCOORD;
 	float3 normal			: NORMAL;
-	float3 tangent			: TANGENT;
+	float4 tangent			: TANGENT;
 	float3 worldPos			: POSITION;
+	float4 color			: COLOR;
 };
 
 // --------------------------------------------------------
@@ -35,19 +50,24 @@ VertexToPixel main(VertexShaderInput input)
 	// Set up output struct
 	VertexToPixel output;
 
+	// This object's matrices
+	matrix world = objects[drawID].world;
+	matrix worldInverseTranspose = objects[drawID].worldInverseTranspose;
+
 	// Calc screen position
 	matrix wvp = mul(projection, mul(view, world));
 	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
 
 	// Make sure the lighting vectors are in world space
 	output.normal = normalize(mul((float3x3)worldInverseTranspose, input.normal));
-	output.tangent = normalize(mul((float3x3)world, input.tangent));
+	output.tangent = float4(normalize(mul((float3x3)world, input.tangent.xyz)), input.tangent.w);
 
 	// Calc vertex world pos
 	output.worldPos = mul(world, float4(input.localPosition, 1.0f)).xyz;
 
-	// Pass through the uv
+	// Pass through the uv and the object's color
 	output.uv = input.uv;
+	output.color = objects[drawID].color;
 
 	return output;
 }
\ No newline at end of file
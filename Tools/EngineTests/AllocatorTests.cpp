@@ -0,0 +1,350 @@
+#include "EngineTests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+#include "TlsfAllocator.h"
+
+
+// --------------------------------------------------------
+// Random allocations and frees, with every range checked for
+// alignment, bounds and overlap against a shadow map, and the
+// allocator's stats checked against the live set.  Freeing
+// everything at the end must leave one block again.
+// --------------------------------------------------------
+static int FuzzHeap(uint64_t capacity, int operations, unsigned int seed)
+{
+	TlsfAllocator heap(capacity);
+	std::mt19937 random(seed);
+	std::vector<TlsfAllocation> live;
+	std::map<uint64_t, uint64_t> shadow;	// Offset -> end of every live range
+	size_t errors = 0;
+	size_t failures = 0;
+	uint64_t liveBytes = 0;
+
+	for (int i = 0; i < operations; i++)
+	{
+		if (live.empty() || random() % 100 < 55)
+		{
+			// Sizes from a few bytes to a few MB, mostly small
+			uint64_t size = 1 + (random() % (1u << (random() % 22)));
+			uint64_t alignment = (random() % 8 == 0) ? 65536 : 1ull << (random() % 9);
+
+			TlsfAllocation allocation;
+			if (!heap.Allocate(size, alignment, allocation))
+			{
+				failures++;
+				continue;
+			}
+
+			uint64_t end = allocation.offset + allocation.size;
+			std::map<uint64_t, uint64_t>::iterator after = shadow.lower_bound(allocation.offset);
+			bool overlaps =
+				(after != shadow.end() && after->first < end) ||
+				(after != shadow.begin() && std::prev(after)->second > allocation.offset);
+			if (allocation.offset % alignment != 0 || allocation.size < size || end > capacity || overlaps)
+				errors++;
+
+			shadow[allocation.offset] = end;
+			live.push_back(allocation);
+			liveBytes += allocation.size;
+		}
+		else
+		{
+			size_t pick = random() % live.size();
+			shadow.erase(live[pick].offset);
+			liveBytes -= live[pick].size;
+			heap.Free(live[pick]);
+			live[pick] = live.back();
+			live.pop_back();
+		}
+
+		if (i % 1000 == 0)
+		{
+			TlsfStats stats = heap.GetStats();
+			if (stats.usedBytes != liveBytes || stats.allocations != live.size() || stats.largestFreeBlock > stats.freeBytes)
+				errors++;
+		}
+	}
+
+	for (const TlsfAllocation& allocation : live)
+		heap.Free(allocation);
+
+	TlsfStats stats = heap.GetStats();
+	if (!heap.IsEmpty() || stats.freeBlocks != 1 || stats.largestFreeBlock != heap.GetCapacity())
+		errors++;
+
+	printf("  Fuzz: %d operations, %zu out-of-space failures, %zu errors\n", operations, failures, errors);
+	return errors == 0 ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// Fills a heap with buffer-sized ranges the way meshes come
+// and go, then churns it and reports how splintered the free
+// space gets, next to what the same buffers would waste as
+// separate committed resources (64KB granularity each)
+// --------------------------------------------------------
+static void BenchmarkHeapFragmentation(uint64_t capacity, int churn, unsigned int seed)
+{
+	const uint64_t committedGranularity = 65536;
+
+	TlsfAllocator heap(capacity);
+	std::mt19937 random(seed);
+	std::lognormal_distribution<double> sizes(log(48.0 * 1024), 1.5);	// Mostly tens of KB, some MB
+	std::vector<TlsfAllocation> live;
+	std::vector<uint64_t> requested;
+
+	auto allocate = [&]()
+	{
+		uint64_t size = std::min((uint64_t)sizes(random) + 64, capacity / 16);
+		TlsfAllocation allocation;
+		if (!heap.Allocate(size, 256, allocation))
+			return false;
+		live.push_back(allocation);
+		requested.push_back(size);
+		return true;
+	};
+
+	// Fill to three quarters full
+	while (heap.GetStats().usedBytes < capacity * 3 / 4 && allocate()) {}
+
+	size_t failures = 0;
+	float worstFragmentation = 0.0f;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < churn; i++)
+	{
+		size_t pick = random() % live.size();
+		heap.Free(live[pick]);
+		live[pick] = live.back();
+		live.pop_back();
+		requested[pick] = requested.back();
+		requested.pop_back();
+
+		// Top back up to three quarters
+		while (heap.GetStats().usedBytes < capacity * 3 / 4)
+		{
+			if (!allocate())
+			{
+				failures++;
+				break;
+			}
+		}
+		worstFragmentation = std::max(worstFragmentation, heap.GetStats().GetFragmentation());
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	uint64_t requestedBytes = 0;
+	uint64_t committedBytes = 0;
+	for (uint64_t size : requested)
+	{
+		requestedBytes += size;
+		committedBytes += (size + committedGranularity - 1) / committedGranularity * committedGranularity;
+	}
+
+	TlsfStats stats = heap.GetStats();
+	printf("  Churn: %d replacements in %.2f ms, %zu failed allocations\n", churn, ms, failures);
+	printf("  %zu live buffers, %llu KB requested: %llu KB in the heap, %llu KB as committed resources\n",
+		live.size(),
+		(unsigned long long)(requestedBytes / 1024),
+		(unsigned long long)(stats.usedBytes / 1024),
+		(unsigned long long)(committedBytes / 1024));
+	printf("  %zu free blocks, largest %llu KB of %llu KB free, fragmentation %.3f (worst %.3f)\n",
+		stats.freeBlocks,
+		(unsigned long long)(stats.largestFreeBlock / 1024),
+		(unsigned long long)(stats.freeBytes / 1024),
+		stats.GetFragmentation(),
+		worstFragmentation);
+}
+
+int BenchmarkHeap()
+{
+	const uint64_t capacity = 64 * 1024 * 1024;
+	printf("TLSF heap of %llu MB\n", (unsigned long long)(capacity / (1024 * 1024)));
+
+	int result = FuzzHeap(capacity, 1000000, 1);
+
+	// Raw speed: allocate and free in a steady mix
+	{
+		TlsfAllocator heap(capacity);
+		std::mt19937 random(2);
+		std::vector<TlsfAllocation> live;
+		const int operations = 1000000;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < operations; i++)
+		{
+			TlsfAllocation allocation;
+			if (live.size() < 1000 && heap.Allocate(64 + random() % 65536, 256, allocation))
+			{
+				live.push_back(allocation);
+			}
+			else if (!live.empty())
+			{
+				size_t pick = random() % live.size();
+				heap.Free(live[pick]);
+				live[pick] = live.back();
+				live.pop_back();
+			}
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		printf("  Speed: %.1f ns per allocation or free\n", ms * 1e6 / operations);
+	}
+
+	BenchmarkHeapFragmentation(capacity, 100000, 3);
+	return result;
+}
+
+// --------------------------------------------------------
+// Material-like churn (mostly ranges of 4, some single
+// descriptors and the odd bigger range) with frees fenced on
+// the current frame and a GPU that finishes frames a few
+// behind.  Live descriptors are kept within three quarters
+// of the capacity, so with freed ranges merging back
+// together running out of space is an error too.  Every
+// slot's owner is shadowed, so handing out a slot that's
+// live or still pending is caught, as is a stale handle
+// that still looks valid.
+// --------------------------------------------------------
+static int FuzzDescriptors(uint32_t capacity, int frames, unsigned int seed)
+{
+	const uint64_t gpuLag = 3;
+	const uint32_t Free = 0xFFFFFFFF;
+	const uint32_t liveBudget = capacity / 4 * 3;
+
+	DescriptorAllocator allocator(capacity);
+	std::mt19937 random(seed);
+	std::vector<DescriptorHandle> live;
+	std::vector<DescriptorHandle> stale;
+	std::vector<uint32_t> owner(capacity, Free);		// Slot -> serial of the range using it
+	std::vector<uint64_t> readableUntil(capacity, 0);	// Slot -> fence value the GPU may read it until
+	uint32_t serial = 0;
+	size_t errors = 0;
+	size_t failures = 0;
+	size_t allocations = 0;
+	uint32_t liveDescriptors = 0;
+
+	for (uint64_t frame = 1; frame <= (uint64_t)frames; frame++)
+	{
+		uint64_t completed = frame > gpuLag ? frame - gpuLag : 0;
+		allocator.ReleaseCompleted(completed);
+
+		int operations = random() % 8;
+		for (int i = 0; i < operations; i++)
+		{
+			uint32_t count = random() % 10 < 7 ? 4 : (random() % 2 ? 1 : 2 + random() % 15);
+			if (live.empty() || (random() % 100 < 52 && liveDescriptors + count <= liveBudget))
+			{
+				DescriptorHandle handle;
+				if (!allocator.Allocate(count, handle))
+				{
+					failures++;
+					errors++;
+					continue;
+				}
+
+				allocations++;
+				liveDescriptors += count;
+				serial++;
+				if (handle.generation == 0 || handle.count != count || handle.index + count > capacity)
+					errors++;
+				for (uint32_t d = handle.index; d < handle.index + count && d < capacity; d++)
+				{
+					if (owner[d] != Free || readableUntil[d] > completed)
+						errors++;
+					owner[d] = serial;
+				}
+				live.push_back(handle);
+			}
+			else
+			{
+				size_t pick = random() % live.size();
+				DescriptorHandle handle = live[pick];
+				if (!allocator.Free(handle, frame))
+					errors++;
+				liveDescriptors -= handle.count;
+				for (uint32_t d = handle.index; d < handle.index + handle.count; d++)
+				{
+					owner[d] = Free;
+					readableUntil[d] = frame;
+				}
+
+				live[pick] = live.back();
+				live.pop_back();
+				stale.push_back(handle);
+			}
+		}
+
+		// Old handles must stay invalid (and freeing them again must be refused),
+		// even once their slots belong to something else
+		if (!stale.empty())
+		{
+			DescriptorHandle& handle = stale[random() % stale.size()];
+			if (allocator.IsValid(handle) || allocator.Free(handle, frame))
+				errors++;
+		}
+		if (stale.size() > 1000)
+			stale.erase(stale.begin(), stale.begin() + 500);
+
+		DescriptorAllocatorStats stats = allocator.GetStats();
+		if (stats.liveRanges != live.size() || stats.used > capacity || stats.pending > stats.used)
+			errors++;
+	}
+
+	for (const DescriptorHandle& handle : live)
+		allocator.Free(handle, frames);
+	allocator.ReleaseCompleted(frames);
+
+	DescriptorAllocatorStats stats = allocator.GetStats();
+	if (stats.used != 0 || stats.pending != 0 || stats.liveRanges != 0)
+		errors++;
+
+	printf("  Fuzz: %d frames, %zu allocations, %zu out-of-space failures, high water %u of %u, %zu errors\n",
+		frames, allocations, failures, stats.highWater, capacity, errors);
+	return errors == 0 ? 0 : 1;
+}
+
+int BenchmarkDescriptors()
+{
+	const uint32_t capacity = 1000;
+	printf("Descriptor allocator with %u descriptors\n", capacity);
+
+	int result = FuzzDescriptors(capacity, 200000, 1);
+
+	// Raw speed: allocate and free in a steady mix, releasing every "frame"
+	{
+		DescriptorAllocator allocator(1 << 20);
+		std::mt19937 random(2);
+		std::vector<DescriptorHandle> live;
+		const int operations = 1000000;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < operations; i++)
+		{
+			DescriptorHandle handle;
+			if (live.size() < 10000 && allocator.Allocate(random() % 4 == 0 ? 1 : 4, handle))
+			{
+				live.push_back(handle);
+			}
+			else if (!live.empty())
+			{
+				size_t pick = random() % live.size();
+				allocator.Free(live[pick], i / 100 + 1);
+				live[pick] = live.back();
+				live.pop_back();
+			}
+
+			if (i % 100 == 0)
+				allocator.ReleaseCompleted(i / 100 >= 2 ? i / 100 - 2 : 0);
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		printf("  Speed: %.1f ns per allocation or free\n", ms * 1e6 / operations);
+	}
+
+	return result;
+}
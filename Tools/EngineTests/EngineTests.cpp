@@ -0,0 +1,263 @@
+// --------------------------------------------------------
+// EngineTests
+//
+// Tests and benchmarks for the engine's CPU-side code: mesh
+// processing, the upload paths, the allocators, frame pacing
+// and textures.  Anything that would talk to the GPU runs
+// against a fake one instead.  Every mode returns non-zero
+// when a check fails, so CTest runs each one as a test.
+//
+// Mesh modes take OBJ files, and without any use built-in
+// spheres (the repository has no OBJ models of its own).
+//
+// Usage: EngineTests --benchmark-tangents [file.obj]
+//   Times every tangent kernel this machine supports on one
+//   model, single and multithreaded, and checks them against
+//   the single-threaded scalar version
+//
+//        EngineTests --benchmark-lods [file.obj]
+//   Times the level of detail chain for one model and reports
+//   the triangles and error of each level
+//
+//        EngineTests --benchmark-meshlets [file.obj ...]
+//   Builds meshlets for each model and times culling them
+//   from a ring of cameras
+//
+//        EngineTests --simulate-streaming [file.obj ...]
+//   Streams each model's buffers through the engine's upload
+//   streamer into a fake GPU that lags a few frames behind,
+//   and checks every buffer arrives intact before it's
+//   reported complete
+//
+//        EngineTests --simulate-batch [file.obj ...]
+//   Uploads each model's buffers in one nested upload batch
+//   through a fake GPU, three times over, and checks each
+//   batch is a single submission, that no staging arena is
+//   released or reused early, and that pooled arenas are
+//   reused once the GPU catches up
+//
+//        EngineTests --benchmark-heap
+//   Fuzzes the TLSF allocator that static buffers share heaps
+//   through (checking every range against a shadow copy), times
+//   it, and reports fragmentation under a mesh-like workload
+//
+//        EngineTests --simulate-frame-ring
+//   Runs the constant buffer and descriptor rings the way
+//   DX12Helper does against a fake GPU with 2 and 3 frames in
+//   flight, and checks no frame's data is overwritten before
+//   the GPU finishes it, even when one frame needs more than
+//   a whole ring
+//
+//        EngineTests --simulate-frames
+//   Paces frames through a fake queue with 1 to 3 frames in
+//   flight, checking no allocator is reset while the GPU is
+//   using it and that SubmitAndWait() covers everything
+//   recorded, and reports how much CPU and GPU time overlaps
+//
+//        EngineTests --benchmark-descriptors
+//   Churns the descriptor allocator through a fake GPU a few
+//   frames behind, checking no descriptor is handed out while
+//   it's live or the GPU may still read it, that it never
+//   runs out of space while three quarters of it is free of
+//   live ranges, and that stale handles are caught, then
+//   times it
+//
+//        EngineTests --benchmark-textures folder
+//   Decodes every PNG in a folder (like Assets/Textures/Sponza)
+//   and builds its mips, on one thread and then all of them,
+//   checking the results match and that the SIMD downsample
+//   matches the scalar one exactly
+//
+//        EngineTests --benchmark-bc folder
+//   Block compresses every PNG in a folder in the format its
+//   name implies, timing the encoders and checking the quality
+//   (PSNR) of each, and that cooked textures survive the cache
+//   round trip
+//
+//        EngineTests --pack-roughness-metal folder
+//   Packs each roughness map in a folder with the metal map
+//   of the same name, checking both channels against their
+//   sources, and compares the quality and size of the packed
+//   BC5 texture with separate BC4 ones
+// --------------------------------------------------------
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "EngineTests.h"
+#include "MappedFile.h"
+#include "ObjParser.h"
+
+namespace fs = std::filesystem;
+
+// --------------------------------------------------------
+// Loads one OBJ the same way Mesh.cpp does
+//
+// source - The OBJ file to load
+// model - Receives the file's name, vertices and indices
+// --------------------------------------------------------
+bool LoadTestModel(const fs::path& source, TestModel& model)
+{
+	MappedFile file;
+	if (!file.Open(source.c_str()))
+	{
+		printf("Could not open %s\n", source.string().c_str());
+		return false;
+	}
+
+	ObjData obj;
+	ParseObjMemory(file.GetData(), file.GetSize(), obj);
+
+	model.name = source.filename().string();
+	model.verts.clear();
+	model.indices.clear();
+	BuildObjVertices(obj, model.verts, model.indices);
+	if (model.verts.empty() || model.indices.empty())
+	{
+		printf("No faces in %s\n", source.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Makes a UV sphere the long way round, writing it out as
+// OBJ text and parsing that, so the parser is tested too.
+// Rows of quads with a triangle fan at each pole, and a
+// seam where the UVs wrap.
+//
+// segments - Quads around the sphere
+// rings - Rows of quads from pole to pole
+// model - Receives the sphere
+// --------------------------------------------------------
+void MakeTestSphere(unsigned int segments, unsigned int rings, TestModel& model)
+{
+	const float pi = 3.14159265f;
+	std::string text;
+	char line[128];
+
+	for (unsigned int r = 0; r <= rings; r++)
+	{
+		float theta = pi * r / rings;
+		for (unsigned int s = 0; s <= segments; s++)
+		{
+			float phi = 2.0f * pi * s / segments;
+			float x = sinf(theta) * cosf(phi);
+			float y = cosf(theta);
+			float z = sinf(theta) * sinf(phi);
+			snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn %f %f %f\n",
+				x, y, z,
+				(float)s / segments, 1.0f - (float)r / rings,
+				x, y, z);
+			text += line;
+		}
+	}
+
+	// Counter-clockwise from outside, like exported OBJ files
+	for (unsigned int r = 0; r < rings; r++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			unsigned int a = r * (segments + 1) + s + 1;
+			unsigned int b = a + 1;
+			unsigned int c = a + segments + 1;
+			unsigned int d = c + 1;
+			if (r == 0)
+				snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, d, d, d, c, c, c);
+			else if (r == rings - 1)
+				snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, d, d, d);
+			else
+				snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, d, d, d, c, c, c);
+			text += line;
+		}
+	}
+
+	ObjData obj;
+	ParseObjMemory(text.c_str(), text.size(), obj);
+
+	model.name = "sphere " + std::to_string(segments) + "x" + std::to_string(rings);
+	model.verts.clear();
+	model.indices.clear();
+	BuildObjVertices(obj, model.verts, model.indices);
+}
+
+// --------------------------------------------------------
+// Loads every OBJ named on the command line, or without any,
+// a big sphere (with buffers over a megabyte, so they don't
+// fit a single staging block) and a small one
+// --------------------------------------------------------
+static bool LoadTestModels(int count, char* files[], std::vector<TestModel>& models)
+{
+	if (count == 0)
+	{
+		models.resize(2);
+		MakeTestSphere(256, 128, models[0]);
+		MakeTestSphere(32, 16, models[1]);
+		return true;
+	}
+
+	models.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		if (!LoadTestModel(files[i], models[i]))
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* mode = argc >= 2 ? argv[1] : "";
+
+	if (argc == 2 && strcmp(mode, "--benchmark-heap") == 0)
+		return BenchmarkHeap();
+	if (argc == 2 && strcmp(mode, "--simulate-frame-ring") == 0)
+		return SimulateFrameRing();
+	if (argc == 2 && strcmp(mode, "--simulate-frames") == 0)
+		return SimulateFrames();
+	if (argc == 2 && strcmp(mode, "--benchmark-descriptors") == 0)
+		return BenchmarkDescriptors();
+	if (argc == 3 && strcmp(mode, "--benchmark-textures") == 0)
+		return BenchmarkTextures(argv[2]);
+	if (argc == 3 && strcmp(mode, "--benchmark-bc") == 0)
+		return BenchmarkBlockCompression(argv[2]);
+	if (argc == 3 && strcmp(mode, "--pack-roughness-metal") == 0)
+		return BenchmarkRoughnessMetalPacking(argv[2]);
+
+	// Tangents and LODs take one model, the rest any number
+	bool singleModel = strcmp(mode, "--benchmark-tangents") == 0 || strcmp(mode, "--benchmark-lods") == 0;
+	bool modelList = strcmp(mode, "--benchmark-meshlets") == 0 || strcmp(mode, "--simulate-streaming") == 0 || strcmp(mode, "--simulate-batch") == 0;
+	if ((singleModel && argc <= 3) || modelList)
+	{
+		std::vector<TestModel> models;
+		if (!LoadTestModels(argc - 2, argv + 2, models))
+			return 1;
+
+		if (strcmp(mode, "--benchmark-tangents") == 0)
+			return BenchmarkTangents(models[0]);
+		if (strcmp(mode, "--benchmark-lods") == 0)
+			return BenchmarkLods(models[0]);
+		if (strcmp(mode, "--benchmark-meshlets") == 0)
+			return BenchmarkMeshlets(models);
+		if (strcmp(mode, "--simulate-streaming") == 0)
+			return SimulateStreaming(models);
+		return SimulateBatch(models);
+	}
+
+	printf("Usage: %s --benchmark-tangents [file.obj]\n", argv[0]);
+	printf("       %s --benchmark-lods [file.obj]\n", argv[0]);
+	printf("       %s --benchmark-meshlets [file.obj ...]\n", argv[0]);
+	printf("       %s --simulate-streaming [file.obj ...]\n", argv[0]);
+	printf("       %s --simulate-batch [file.obj ...]\n", argv[0]);
+	printf("       %s --benchmark-heap\n", argv[0]);
+	printf("       %s --simulate-frame-ring\n", argv[0]);
+	printf("       %s --simulate-frames\n", argv[0]);
+	printf("       %s --benchmark-descriptors\n", argv[0]);
+	printf("       %s --benchmark-textures folder\n", argv[0]);
+	printf("       %s --benchmark-bc folder\n", argv[0]);
+	printf("       %s --pack-roughness-metal folder\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A model for the mesh tests: an OBJ file's vertices and
+// indices exactly as Mesh.cpp builds them (before any
+// optimization), or one of the built-in spheres
+// --------------------------------------------------------
+struct TestModel
+{
+	std::string name;
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+};
+
+bool LoadTestModel(const std::filesystem::path& source, TestModel& model);
+void MakeTestSphere(unsigned int segments, unsigned int rings, TestModel& model);
+
+// Mesh tests (MeshTests.cpp)
+int BenchmarkTangents(const TestModel& model);
+int BenchmarkLods(const TestModel& model);
+int BenchmarkMeshlets(const std::vector<TestModel>& models);
+
+// Upload tests (UploadTests.cpp)
+int SimulateStreaming(const std::vector<TestModel>& models);
+int SimulateBatch(const std::vector<TestModel>& models);
+
+// Allocator tests (AllocatorTests.cpp)
+int BenchmarkHeap();
+int BenchmarkDescriptors();
+
+// Frame pacing tests (FrameTests.cpp)
+int SimulateFrameRing();
+int SimulateFrames();
+
+// Texture tests (TextureTests.cpp)
+int BenchmarkTextures(const std::filesystem::path& folder);
+int BenchmarkBlockCompression(const std::filesystem::path& folder);
+int BenchmarkRoughnessMetalPacking(const std::filesystem::path& folder);
@@ -0,0 +1,296 @@
+#include "EngineTests.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "FramePacer.h"
+#include "FrameRing.h"
+
+
+// --------------------------------------------------------
+// A fake GPU that finishes each frame some number of frames
+// after it's submitted, so both rings in DX12Helper can be
+// run exactly as the engine does.  Every constant buffer is
+// stamped with its frame, and the stamps are checked when
+// that frame completes.  The overflow frame (if any) asks for
+// more constant buffers than fit, so some of its draws must
+// be skipped, and no others.
+// --------------------------------------------------------
+static int SimulateFrameRingLatency(int framesInFlight, int frames, unsigned int seed, int overflowFrame = 0)
+{
+	const uint64_t maxConstantBuffers = 4096;
+	const uint64_t cbAlignment = 256;
+
+	FrameRing cbRing(maxConstantBuffers * cbAlignment);
+	FrameRing descriptorRing(maxConstantBuffers);
+	std::vector<uint32_t> cbMemory((size_t)(cbRing.GetCapacity() / sizeof(uint32_t)));
+	std::vector<uint32_t> descriptors((size_t)maxConstantBuffers);
+
+	struct Use { uint64_t offset; uint64_t size; uint64_t descriptor; };
+	std::map<uint64_t, std::vector<Use>> submitted;	// Fence value -> what that frame used
+	std::mt19937 random(seed);
+	uint64_t completedFenceValue = 0;
+	size_t waits = 0;
+	size_t skipped = 0;
+	size_t skippedElsewhere = 0;
+	size_t corrupted = 0;
+	size_t constantBuffers = 0;
+	size_t mostInFlight = 0;
+
+	// The GPU finishing a frame: everything it used must still hold its stamp
+	auto complete = [&](uint64_t fenceValue)
+	{
+		for (; completedFenceValue < fenceValue; completedFenceValue++)
+		{
+			uint64_t frame = completedFenceValue + 1;
+			for (const Use& use : submitted[frame])
+			{
+				for (uint64_t i = use.offset; i < use.offset + use.size; i += sizeof(uint32_t))
+					corrupted += cbMemory[(size_t)(i / sizeof(uint32_t))] != frame;
+				corrupted += descriptors[(size_t)use.descriptor] != frame;
+			}
+			submitted.erase(frame);
+		}
+	};
+
+	// Same as DX12Helper::ReserveFrameRingSpace(), with waiting on
+	// the fence standing in for the GPU catching up
+	auto reserve = [&](FrameRing& ring, uint64_t size, uint64_t& offset)
+	{
+		return ring.AllocateWaiting(size, completedFenceValue, [&](uint64_t fenceValue) { complete(fenceValue); waits++; }, offset);
+	};
+
+	for (uint64_t frame = 1; frame <= (uint64_t)frames; frame++)
+	{
+		// Mostly light frames with the odd heavy one, so the rings fill up sometimes
+		size_t count = random() % 10 == 0 ? 600 + random() % 600 : 50 + random() % 400;
+		if (frame == (uint64_t)overflowFrame)
+			count = (size_t)maxConstantBuffers + 500;
+
+		for (size_t c = 0; c < count; c++)
+		{
+			uint64_t size = (64 + random() % 448 + cbAlignment - 1) & ~(cbAlignment - 1);
+			Use use;
+			use.size = size;
+			if (!reserve(cbRing, size, use.offset) || !reserve(descriptorRing, 1, use.descriptor))
+			{
+				// The draw this was for gets skipped
+				skipped++;
+				skippedElsewhere += frame != (uint64_t)overflowFrame;
+				continue;
+			}
+
+			std::fill(cbMemory.begin() + (size_t)(use.offset / sizeof(uint32_t)), cbMemory.begin() + (size_t)((use.offset + size) / sizeof(uint32_t)), (uint32_t)frame);
+			descriptors[(size_t)use.descriptor] = (uint32_t)frame;
+			submitted[frame].push_back(use);
+		}
+		constantBuffers += count;
+
+		// Submit, tagged with the value the fence will be signaled with
+		cbRing.FinishFrame(frame);
+		descriptorRing.FinishFrame(frame);
+
+		// The GPU stays framesInFlight frames behind
+		if (frame > (uint64_t)framesInFlight)
+			complete(frame - framesInFlight);
+		mostInFlight = std::max(mostInFlight, submitted.size());
+	}
+	complete(frames);
+
+	printf("  %d frames in flight%s: %d frames, %zu constant buffers, up to %zu frames in flight, %zu waits, %zu skipped, %zu corrupted\n",
+		framesInFlight, overflowFrame ? " (one frame overflowing)" : "", frames, constantBuffers, mostInFlight, waits, skipped, corrupted);
+
+	// Only the overflowing frame may go without (and it has to)
+	bool skippedRight = overflowFrame ? skipped > 0 && skippedElsewhere == 0 : skipped == 0;
+	return corrupted == 0 && skippedRight ? 0 : 1;
+}
+
+int SimulateFrameRing()
+{
+	int result = 0;
+	result |= SimulateFrameRingLatency(2, 10000, 1);
+	result |= SimulateFrameRingLatency(3, 10000, 2);
+	result |= SimulateFrameRingLatency(2, 1000, 3, 500);
+	return result;
+}
+
+// --------------------------------------------------------
+// A fake queue on a simulated clock: executed frames run
+// one after another on the "GPU", each fence value is
+// reached when the work before it is done, and waiting
+// moves the CPU's clock forward.  Resetting an allocator
+// whose commands haven't finished is counted as an error.
+// --------------------------------------------------------
+class SimulatedFrameQueue : public FrameQueueBackend
+{
+public:
+	SimulatedFrameQueue(unsigned int framesInFlight) :
+		cpuTime(0),
+		gpuTime(0),
+		stallTime(0),
+		gpuWorkTime(0),
+		errors(0),
+		lastSignaled(0),
+		allocatorDoneAt(framesInFlight, 0.0),
+		recording(framesInFlight, false)
+	{
+		recording[0] = true;
+	}
+
+	// What the next Execute() will cost the GPU
+	double nextGpuDuration = 0;
+
+	double cpuTime;
+	double gpuTime;		// When the GPU finishes everything executed so far
+	double stallTime;	// CPU time spent waiting
+	double gpuWorkTime;
+	size_t errors;
+
+	void Execute(unsigned int frame)
+	{
+		if (!recording[frame])
+			errors++;
+
+		// The GPU starts once it's submitted and the earlier work is done
+		gpuTime = std::max(gpuTime, cpuTime) + nextGpuDuration;
+		gpuWorkTime += nextGpuDuration;
+		allocatorDoneAt[frame] = gpuTime;
+		recording[frame] = false;
+	}
+
+	void Signal(uint64_t fenceValue)
+	{
+		if (fenceValue != lastSignaled + 1)
+			errors++;
+		lastSignaled = fenceValue;
+		fenceTimes[fenceValue] = gpuTime;
+	}
+
+	uint64_t GetCompletedFenceValue()
+	{
+		uint64_t completed = 0;
+		for (const auto& fence : fenceTimes)
+		{
+			if (fence.second > cpuTime)
+				break;
+			completed = fence.first;
+		}
+		return completed;
+	}
+
+	void WaitForFenceValue(uint64_t fenceValue)
+	{
+		std::map<uint64_t, double>::iterator fence = fenceTimes.find(fenceValue);
+		if (fence == fenceTimes.end())
+		{
+			errors++;	// Waiting forever
+			return;
+		}
+
+		if (fence->second > cpuTime)
+		{
+			stallTime += fence->second - cpuTime;
+			cpuTime = fence->second;
+		}
+	}
+
+	void Reset(unsigned int frame)
+	{
+		if (allocatorDoneAt[frame] > cpuTime)
+			errors++;
+		recording[frame] = true;
+	}
+
+	void Reopen(unsigned int frame)
+	{
+		if (recording[frame])
+			errors++;
+		recording[frame] = true;
+	}
+
+private:
+	uint64_t lastSignaled;
+	std::map<uint64_t, double> fenceTimes;	// Fence value -> when the GPU reaches it
+	std::vector<double> allocatorDoneAt;
+	std::vector<bool> recording;
+};
+
+static int SimulateFramesInFlight(unsigned int framesInFlight, int frames, unsigned int seed)
+{
+	SimulatedFrameQueue queue(framesInFlight);
+	FramePacer pacer(queue, framesInFlight);
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> cpuCost(4.0, 9.0);	// ms, so CPU and GPU are close
+	std::uniform_real_distribution<double> gpuCost(5.0, 8.0);
+	uint64_t lastFenceValue = 0;
+
+	for (int frame = 0; frame < frames; frame++)
+	{
+		// The odd frame also submits some uploads, like an upload batch,
+		// and even more rarely has to wait for them
+		if (random() % 50 == 0)
+		{
+			queue.cpuTime += 0.5;
+			queue.nextGpuDuration = 1.0;
+			pacer.SubmitAndWait();
+		}
+		else if (random() % 10 == 0)
+		{
+			queue.cpuTime += 0.5;
+			queue.nextGpuDuration = 1.0;
+			double stalledBefore = queue.stallTime;
+			pacer.SubmitAndContinue();
+			if (queue.stallTime != stalledBefore)
+				queue.errors++;
+		}
+
+		queue.cpuTime += cpuCost(random);
+		queue.nextGpuDuration = gpuCost(random);
+
+		unsigned int recordedWith = pacer.GetFrameIndex();
+		uint64_t fenceValue = pacer.EndFrame();
+		if (fenceValue <= lastFenceValue || pacer.GetFrameIndex() != (recordedWith + 1) % framesInFlight)
+			queue.errors++;
+		lastFenceValue = fenceValue;
+
+		// The CPU is never more than framesInFlight frames ahead
+		// (allowing for the extra upload submissions)
+		if (fenceValue - queue.GetCompletedFenceValue() > framesInFlight * 2)
+			queue.errors++;
+	}
+
+	// Work recorded (and tagged) since the last frame is submitted
+	// and done by the time submitting and waiting returns
+	queue.cpuTime += 1.0;
+	queue.nextGpuDuration = 3.0;
+	uint64_t tagged = pacer.GetNextFenceValue();
+	double workBefore = queue.gpuWorkTime;
+	pacer.SubmitAndWait();
+	if (queue.GetCompletedFenceValue() != pacer.GetLastFenceValue() ||
+		queue.GetCompletedFenceValue() < tagged ||
+		queue.gpuWorkTime == workBefore ||
+		queue.gpuTime > queue.cpuTime)
+		queue.errors++;
+
+	double total = std::max(queue.cpuTime, queue.gpuTime);
+	printf("  %u frames in flight: %.2f ms per frame, GPU busy %.0f%%, CPU stalled %.2f ms per frame, %zu waits, %zu errors\n",
+		framesInFlight,
+		total / frames,
+		100.0 * queue.gpuWorkTime / total,
+		queue.stallTime / frames,
+		pacer.GetWaitCount(),
+		queue.errors);
+	return queue.errors == 0 ? 0 : 1;
+}
+
+int SimulateFrames()
+{
+	// One frame in flight is the old wait-every-frame behavior
+	int result = 0;
+	for (unsigned int framesInFlight = 1; framesInFlight <= 3; framesInFlight++)
+		result |= SimulateFramesInFlight(framesInFlight, 10000, framesInFlight);
+	return result;
+}
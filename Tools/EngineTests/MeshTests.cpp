@@ -0,0 +1,319 @@
+#include "EngineTests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "MeshBounds.h"
+#include "Meshlets.h"
+#include "MeshProcessing.h"
+#include "MeshSimplify.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times each available CalculateTangents() kernel on one
+// model (on one thread and on all of them) and reports the
+// largest difference from the single-threaded scalar results,
+// failing if any kernel differs by more than rounding
+// --------------------------------------------------------
+int BenchmarkTangents(const TestModel& model)
+{
+	const std::vector<Vertex>& verts = model.verts;
+	const std::vector<unsigned int>& indices = model.indices;
+
+	printf("%s: %zu vertices, %zu triangles\n", model.name.c_str(), verts.size(), indices.size() / 3);
+
+	const TangentKernel kernels[] = { TangentKernel_Scalar, TangentKernel_SSE, TangentKernel_AVX2 };
+	const char* names[] = { "Scalar", "SSE", "AVX2" };
+	const int iterations = 10;
+	unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	// Each kernel sums in a different order, so allow a little rounding
+	const float maxAllowedError = 1e-4f;
+	int result = 0;
+
+	std::vector<Vertex> reference;
+	double scalarMs = 0.0;
+	for (int k = 0; k < 3; k++)
+	{
+		if (!IsTangentKernelSupported(kernels[k]))
+		{
+			printf("  %-6s  not supported\n", names[k]);
+			continue;
+		}
+
+		const unsigned int threadCounts[] = { 1, hardwareThreads };
+		for (unsigned int threads : threadCounts)
+		{
+			// Best of several runs, on a fresh copy each time
+			std::vector<Vertex> work;
+			double bestMs = 0.0;
+			for (int i = 0; i < iterations; i++)
+			{
+				work = verts;
+				auto start = std::chrono::high_resolution_clock::now();
+				CalculateTangents(&work[0], (int)work.size(), &indices[0], (int)indices.size(), kernels[k], threads);
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				if (i == 0 || ms < bestMs) bestMs = ms;
+			}
+
+			if (reference.empty())
+			{
+				reference = work;
+				scalarMs = bestMs;
+			}
+
+			float maxError = 0.0f;
+			size_t signMismatches = 0;
+			for (size_t v = 0; v < work.size(); v++)
+			{
+				const XMFLOAT4& a = work[v].Tangent;
+				const XMFLOAT4& b = reference[v].Tangent;
+				maxError = std::max(maxError, std::max(fabsf(a.x - b.x), std::max(fabsf(a.y - b.y), fabsf(a.z - b.z))));
+				if (a.w != b.w) signMismatches++;
+			}
+
+			printf("  %-6s %2u threads %8.2f ms  %5.2fx  max error %g, %zu sign mismatches\n",
+				names[k],
+				threads,
+				bestMs,
+				bestMs > 0.0 ? scalarMs / bestMs : 0.0,
+				maxError,
+				signMismatches);
+
+			if (maxError > maxAllowedError || signMismatches > 0)
+				result = 1;
+
+			if (hardwareThreads == 1)
+				break;
+		}
+	}
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Times BuildMeshLods() on one model and reports each level's
+// triangle count and error, both in object space and as a
+// fraction of the model's size
+// --------------------------------------------------------
+int BenchmarkLods(const TestModel& model)
+{
+	std::vector<Vertex> verts = model.verts;
+	std::vector<unsigned int> indices = model.indices;
+
+	OptimizeMesh(verts, indices);
+	printf("%s: %zu vertices, %zu triangles\n", model.name.c_str(), verts.size(), indices.size() / 3);
+
+	std::vector<unsigned int> lodIndices;
+	std::vector<MeshLod> lods;
+	auto start = std::chrono::high_resolution_clock::now();
+	BuildMeshLods(&verts[0], verts.size(), &indices[0], indices.size(), lodIndices, lods);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	MeshBounds bounds = CalculateMeshBounds(&verts[0], verts.size());
+	XMFLOAT3 extent(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z);
+	float diagonal = sqrtf(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		VertexCacheStats stats = AnalyzeVertexCache(&lodIndices[lods[i].firstIndex], lods[i].indexCount, verts.size());
+		printf("  LOD %zu %9u triangles  %6.2f%%  error %-10g (%.4f%% of size)  ACMR %.3f\n",
+			i,
+			lods[i].indexCount / 3,
+			100.0 * lods[i].indexCount / lods[0].indexCount,
+			lods[i].error,
+			diagonal > 0.0f ? 100.0f * lods[i].error / diagonal : 0.0f,
+			stats.acmr);
+	}
+
+	printf("Built %zu levels in %.2f ms, index buffer %.2fx the original\n",
+		lods.size(),
+		ms,
+		(double)lodIndices.size() / indices.size());
+
+	// The first level is the whole mesh, and each after it is smaller
+	bool ok = !lods.empty() && lods[0].indexCount == indices.size();
+	for (size_t i = 1; i < lods.size(); i++)
+		if (lods[i].indexCount >= lods[i - 1].indexCount) ok = false;
+	return ok ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// A left handed look-at view times a perspective projection,
+// matching XMMatrixLookAtLH() * XMMatrixPerspectiveFovLH()
+// --------------------------------------------------------
+static XMFLOAT4X4 MakeViewProjection(const XMFLOAT3& eye, const XMFLOAT3& target, float fieldOfView, float aspectRatio, float nearClip, float farClip)
+{
+	auto normalize = [](XMFLOAT3 v)
+	{
+		float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+		return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+	};
+	auto cross = [](const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	};
+	auto dot = [](const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+
+	XMFLOAT3 z = normalize(XMFLOAT3(target.x - eye.x, target.y - eye.y, target.z - eye.z));
+	XMFLOAT3 x = normalize(cross(XMFLOAT3(0, 1, 0), z));
+	XMFLOAT3 y = cross(z, x);
+
+	float view[4][4] = {
+		{ x.x, y.x, z.x, 0 },
+		{ x.y, y.y, z.y, 0 },
+		{ x.z, y.z, z.z, 0 },
+		{ -dot(x, eye), -dot(y, eye), -dot(z, eye), 1 } };
+
+	float h = 1.0f / tanf(fieldOfView * 0.5f);
+	float q = farClip / (farClip - nearClip);
+	float projection[4][4] = {
+		{ h / aspectRatio, 0, 0, 0 },
+		{ 0, h, 0, 0 },
+		{ 0, 0, q, 1 },
+		{ 0, 0, -q * nearClip, 0 } };
+
+	XMFLOAT4X4 result;
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			result.m[r][c] = 0.0f;
+			for (int k = 0; k < 4; k++)
+				result.m[r][c] += view[r][k] * projection[k][c];
+		}
+	}
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds meshlets for each model and culls them from a ring
+// of cameras close enough that parts of the model are off
+// screen.  Also checks that every culled meshlet really was
+// invisible (entirely outside a plane, or all back faces).
+// --------------------------------------------------------
+int BenchmarkMeshlets(const std::vector<TestModel>& models)
+{
+	const int views = 64;
+	const int iterations = 20;
+	int result = 0;
+
+	for (const TestModel& model : models)
+	{
+		std::vector<Vertex> verts = model.verts;
+		std::vector<unsigned int> indices = model.indices;
+		OptimizeMesh(verts, indices);
+
+		MeshletData meshlets;
+		auto start = std::chrono::high_resolution_clock::now();
+		BuildMeshlets(&verts[0], verts.size(), &indices[0], indices.size(), meshlets);
+		double buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		size_t withCones = 0;
+		for (const MeshletBounds& b : meshlets.bounds)
+			if (b.coneCutoff < 1.0f) withCones++;
+
+		printf("%s: %zu triangles -> %zu meshlets (%.1f vertices, %.1f triangles each, %.0f%% with cones) in %.2f ms\n",
+			model.name.c_str(),
+			indices.size() / 3,
+			meshlets.meshlets.size(),
+			(double)meshlets.vertices.size() / meshlets.meshlets.size(),
+			(double)meshlets.triangles.size() / 3 / meshlets.meshlets.size(),
+			100.0 * withCones / meshlets.meshlets.size(),
+			buildMs);
+
+		// Orbit just outside the model's bounds, looking slightly
+		// off center so some of it is always out of view
+		MeshBounds bounds = CalculateMeshBounds(&verts[0], verts.size());
+		const XMFLOAT3& center = bounds.center;
+		float radius = bounds.radius;
+
+		std::vector<uint32_t> visible;
+		MeshletCullStats totals = {};
+		size_t wronglyCulled = 0;
+		double bestMs = 0.0;
+		for (int i = 0; i < iterations; i++)
+		{
+			double ms = 0.0;
+			for (int v = 0; v < views; v++)
+			{
+				float angle = 2.0f * XM_PI * v / views;
+				XMFLOAT3 eye(center.x + cosf(angle) * radius * 1.5f, center.y + radius * 0.5f * sinf(angle * 3.0f), center.z + sinf(angle) * radius * 1.5f);
+				XMFLOAT3 target(center.x + sinf(angle) * radius * 0.3f, center.y, center.z - cosf(angle) * radius * 0.3f);
+				MeshletFrustum frustum = ExtractMeshletFrustum(MakeViewProjection(eye, target, XM_PI / 4.0f, 16.0f / 9.0f, 0.01f, radius * 10.0f));
+
+				MeshletCullStats stats;
+				auto cullStart = std::chrono::high_resolution_clock::now();
+				CullMeshlets(meshlets, frustum, eye, visible, &stats);
+				ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+
+				if (i > 0)
+					continue;
+
+				totals.tested += stats.tested;
+				totals.frustumCulled += stats.frustumCulled;
+				totals.coneCulled += stats.coneCulled;
+
+				// Any culled meshlet with a front facing triangle
+				// inside the frustum was culled wrongly
+				std::vector<bool> kept(meshlets.meshlets.size(), false);
+				for (uint32_t m : visible)
+					kept[m] = true;
+
+				for (size_t m = 0; m < meshlets.meshlets.size(); m++)
+				{
+					if (kept[m])
+						continue;
+
+					const Meshlet& meshlet = meshlets.meshlets[m];
+					for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+					{
+						XMFLOAT3 p[3];
+						for (int c = 0; c < 3; c++)
+							p[c] = verts[meshlets.vertices[meshlet.vertexOffset + meshlets.triangles[meshlet.triangleOffset + t * 3 + c]]].Position;
+
+						bool outside = false;
+						for (int plane = 0; plane < 6 && !outside; plane++)
+						{
+							const XMFLOAT4& f = frustum.planes[plane];
+							outside = true;
+							for (int c = 0; c < 3; c++)
+								outside = outside && f.x * p[c].x + f.y * p[c].y + f.z * p[c].z + f.w < 1e-4f * radius;
+						}
+
+						XMFLOAT3 e1(p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z);
+						XMFLOAT3 e2(p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z);
+						XMFLOAT3 n(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+						float facing = n.x * (eye.x - p[0].x) + n.y * (eye.y - p[0].y) + n.z * (eye.z - p[0].z);
+						float nLength = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+
+						if (!outside && facing > 1e-4f * nLength * radius)
+						{
+							wronglyCulled++;
+							break;
+						}
+					}
+				}
+			}
+
+			if (i == 0 || ms < bestMs) bestMs = ms;
+		}
+
+		printf("  %d views: %.1f%% frustum culled, %.1f%% cone culled, %.1f ns per meshlet, %zu wrongly culled\n",
+			views,
+			100.0 * totals.frustumCulled / totals.tested,
+			100.0 * totals.coneCulled / totals.tested,
+			bestMs * 1e6 / ((double)views * meshlets.meshlets.size()),
+			wronglyCulled);
+
+		if (wronglyCulled > 0)
+			result = 1;
+	}
+
+	return result;
+}
@@ -0,0 +1,520 @@
+#include "EngineTests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "TextureCache.h"
+#include "TextureProcessing.h"
+
+namespace fs = std::filesystem;
+
+// --------------------------------------------------------
+// Checks the SIMD downsample against the scalar one over
+// awkward sizes (odd, 1 wide or tall, not a multiple of the
+// vector width), for both channel counts textures use
+// --------------------------------------------------------
+static size_t CheckDownsampleEdgeCases()
+{
+	const uint32_t sizes[][2] = { { 1, 1 }, { 2, 2 }, { 1, 9 }, { 13, 1 }, { 7, 5 }, { 33, 17 }, { 34, 3 }, { 127, 64 } };
+	std::mt19937 random(3);
+	size_t mismatches = 0;
+
+	for (uint32_t channels : { 1u, 4u })
+	{
+		for (const auto& size : sizes)
+		{
+			std::vector<uint8_t> source((size_t)size[0] * size[1] * channels);
+			for (uint8_t& b : source)
+				b = (uint8_t)random();
+
+			size_t outSize = (size_t)std::max(1u, size[0] / 2) * std::max(1u, size[1] / 2) * channels;
+			std::vector<uint8_t> scalar(outSize);
+			std::vector<uint8_t> simd(outSize);
+			DownsampleBox(source.data(), size[0], size[1], channels, scalar.data(), MipKernel_Scalar);
+			DownsampleBox(source.data(), size[0], size[1], channels, simd.data(), MipKernel_Auto);
+			if (scalar != simd)
+				mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+// --------------------------------------------------------
+// Every PNG directly inside a folder, sorted by name
+// --------------------------------------------------------
+static std::vector<fs::path> ListPngFiles(const fs::path& folder)
+{
+	std::vector<fs::path> paths;
+	std::error_code error;
+	for (const fs::directory_entry& entry : fs::directory_iterator(folder, error))
+	{
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (entry.is_regular_file() && extension == ".png")
+			paths.push_back(entry.path());
+	}
+	if (paths.empty())
+		printf("No PNG files in %s\n", folder.string().c_str());
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+int BenchmarkTextures(const fs::path& folder)
+{
+	std::vector<fs::path> paths = ListPngFiles(folder);
+	if (paths.empty())
+		return 1;
+
+	std::vector<const fs::path::value_type*> files;
+	for (const fs::path& path : paths)
+		files.push_back(path.c_str());
+
+	unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	printf("%s: %zu textures\n", folder.string().c_str(), files.size());
+
+	// One thread, then every core, which must give the same textures
+	std::vector<CookedTexture> sequential;
+	std::vector<CookedTexture> parallel;
+	TextureCookStats sequentialStats;
+	TextureCookStats parallelStats;
+	CookTextureFiles(files.data(), files.size(), sequential, true, TextureCache_Off, &sequentialStats, 1);
+	CookTextureFiles(files.data(), files.size(), parallel, true, TextureCache_Off, &parallelStats, hardwareThreads);
+
+	size_t errors = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (!sequential[i].IsValid())
+			printf("  Could not decode %s\n", paths[i].filename().string().c_str());
+		if (sequential[i].pixels != parallel[i].pixels || sequential[i].mips.size() != parallel[i].mips.size())
+			errors++;
+	}
+
+	printf("  %.1f MB of PNG, %.1f MB decoded with mips, %zu failed\n",
+		sequentialStats.fileBytes / (1024.0 * 1024.0),
+		sequentialStats.pixelBytes / (1024.0 * 1024.0),
+		sequentialStats.failed);
+	printf("  Decode %.1f ms, mips %.1f ms (added up over threads)\n",
+		sequentialStats.decodeMilliseconds,
+		sequentialStats.mipMilliseconds);
+	printf("  1 thread: %8.1f ms\n", sequentialStats.totalMilliseconds);
+	printf("  Threaded: %8.1f ms on %u threads (%.2fx)\n",
+		parallelStats.totalMilliseconds,
+		parallelStats.threads,
+		sequentialStats.totalMilliseconds / parallelStats.totalMilliseconds);
+
+	// Each downsample kernel over every texture's chain, checked against scalar
+	const MipKernel kernels[] = { MipKernel_Scalar, MipKernel_SSE2 };
+	const char* names[] = { "Scalar", "SSE2" };
+	std::vector<CookedTexture> scalarMips;
+	for (int k = 0; k < 2; k++)
+	{
+		if (!IsMipKernelSupported(kernels[k]))
+		{
+			printf("  %-6s  not supported\n", names[k]);
+			continue;
+		}
+
+		std::vector<CookedTexture> work;
+		for (const CookedTexture& texture : sequential)
+		{
+			if (!texture.IsValid())
+				continue;
+
+			CookedTexture top;
+			top.format = texture.format;
+			top.channels = texture.channels;
+			top.mips.push_back(texture.mips[0]);
+			top.pixels.assign(texture.pixels.begin(), texture.pixels.begin() + texture.mips[0].width * texture.mips[0].height * texture.channels);
+			work.push_back(std::move(top));
+		}
+
+		uint64_t bytes = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (CookedTexture& texture : work)
+		{
+			bytes += texture.pixels.size();
+			GenerateMips(texture, kernels[k]);
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		size_t mismatches = 0;
+		if (scalarMips.empty())
+			scalarMips = std::move(work);
+		else
+			for (size_t i = 0; i < work.size(); i++)
+				if (work[i].pixels != scalarMips[i].pixels)
+					mismatches++;
+		errors += mismatches;
+
+		printf("  %-6s  mips %7.1f ms (%.0f MB/s of level 0), %zu mismatches\n",
+			names[k], ms, bytes / (1024.0 * 1024.0) / (ms / 1000.0), mismatches);
+	}
+
+	size_t edgeMismatches = CheckDownsampleEdgeCases();
+	errors += edgeMismatches;
+	printf("  Odd sizes: %zu mismatches\n", edgeMismatches);
+
+	return errors == 0 ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// Peak signal to noise ratio between two RGBA images over
+// the first few channels (infinite when they match)
+// --------------------------------------------------------
+static double MeasurePsnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, uint32_t channels)
+{
+	double squaredError = 0;
+	for (size_t i = 0; i < a.size(); i += 4)
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			double difference = (double)a[i + c] - b[i + c];
+			squaredError += difference * difference;
+		}
+
+	double meanSquaredError = squaredError / ((a.size() / 4) * channels);
+	return meanSquaredError == 0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+}
+
+int BenchmarkBlockCompression(const fs::path& folder)
+{
+	std::vector<fs::path> paths = ListPngFiles(folder);
+	if (paths.empty())
+		return 1;
+
+	std::vector<const fs::path::value_type*> files;
+	for (const fs::path& path : paths)
+		files.push_back(path.c_str());
+
+	// Level 0 of each, uncompressed
+	std::vector<CookedTexture> textures;
+	CookTextureFiles(files.data(), files.size(), textures, false);
+	printf("%s: %zu textures\n", folder.string().c_str(), files.size());
+
+	// Anything lower than this is visibly broken rather than just lossy
+	const double minimumPsnr = 30.0;
+	const char* formatNames[] = { "BC4", "BC5", "BC7" };
+	const uint32_t formatChannels[] = { 1, 2, 4 };
+
+	struct FormatResults
+	{
+		size_t textures;
+		uint64_t pixels;
+		double milliseconds;
+		double psnrTotal;
+		double worstPsnr;
+		std::string worstFile;
+	};
+	FormatResults results[3] = {};
+	for (FormatResults& result : results)
+		result.worstPsnr = INFINITY;
+
+	size_t errors = 0;
+	size_t skipped = 0;
+	uint64_t sourceBytes = 0;
+	uint64_t compressedBytes = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		const CookedTexture& texture = textures[i];
+		std::string name = paths[i].filename().string();
+		if (!texture.IsValid())
+		{
+			printf("  Could not decode %s\n", name.c_str());
+			errors++;
+			continue;
+		}
+
+		uint32_t width = texture.mips[0].width;
+		uint32_t height = texture.mips[0].height;
+		if (width % 4 != 0 || height % 4 != 0)
+		{
+			skipped++;
+			continue;
+		}
+
+		BlockFormat format = GetCookedBlockFormat(GuessTextureUsage(name.c_str()));
+		int f = format == BlockFormat_BC4 ? 0 : format == BlockFormat_BC5 ? 1 : 2;
+
+		std::vector<uint8_t> blocks(GetCompressedSize(format, width, height));
+		auto start = std::chrono::high_resolution_clock::now();
+		CompressBlocks(texture.pixels.data(), width, height, texture.channels, format, blocks.data());
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Compare against the source as the GPU would see it (gray spread to RGB)
+		std::vector<uint8_t> original((size_t)width * height * 4);
+		for (size_t p = 0; p < (size_t)width * height; p++)
+			for (uint32_t c = 0; c < 4; c++)
+				original[p * 4 + c] = texture.channels == 4 ? texture.pixels[p * 4 + c] :
+					c < 3 ? texture.pixels[p] : 255;
+
+		std::vector<uint8_t> decoded(original.size());
+		double psnr = 0;
+		if (!DecompressBlocks(blocks.data(), width, height, format, decoded.data()))
+			printf("  %s: could not decompress\n", name.c_str());
+		else
+			psnr = MeasurePsnr(original, decoded, formatChannels[f]);
+
+		if (psnr < minimumPsnr)
+		{
+			printf("  %s: %s PSNR %.2f dB is below %.0f dB\n", name.c_str(), formatNames[f], psnr, minimumPsnr);
+			errors++;
+		}
+
+		FormatResults& result = results[f];
+		result.textures++;
+		result.pixels += (uint64_t)width * height;
+		result.milliseconds += ms;
+		result.psnrTotal += std::min(psnr, 99.0);
+		if (psnr < result.worstPsnr)
+		{
+			result.worstPsnr = psnr;
+			result.worstFile = name;
+		}
+		sourceBytes += (uint64_t)width * height * texture.channels;
+		compressedBytes += blocks.size();
+	}
+
+	for (int f = 0; f < 3; f++)
+	{
+		const FormatResults& result = results[f];
+		if (result.textures == 0)
+			continue;
+
+		printf("  %s  %3zu textures  %7.2f MPix/s  PSNR average %5.2f dB, worst %5.2f dB (%s)\n",
+			formatNames[f],
+			result.textures,
+			result.pixels / 1000000.0 / (result.milliseconds / 1000.0),
+			result.psnrTotal / result.textures,
+			result.worstPsnr,
+			result.worstFile.c_str());
+	}
+	printf("  %.1f MB decoded -> %.1f MB compressed, %zu left uncompressed (not whole blocks)\n",
+		sourceBytes / (1024.0 * 1024.0), compressedBytes / (1024.0 * 1024.0), skipped);
+
+	// A cooked texture must come back from the cache exactly, and only for its own source
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		if (!textures[i].IsValid())
+			continue;
+
+		CookedTexture cooked = textures[i];
+		GenerateMips(cooked);
+		if (!CompressTexture(cooked, GetCookedBlockFormat(GuessTextureUsage(paths[i].filename().string().c_str()))))
+			continue;
+
+		std::string cacheFile = GetCookedTexturePath((fs::temp_directory_path() / "NubixTextureCheck.png").string());
+		CookedTexture loaded;
+		CookedTexture stale;
+		bool roundTrip = WriteCookedTexture(cacheFile.c_str(), cooked, 1234) &&
+			ReadCookedTexture(cacheFile.c_str(), 1234, true, loaded) &&
+			loaded.format == cooked.format && loaded.pixels == cooked.pixels && loaded.mips.size() == cooked.mips.size() &&
+			!ReadCookedTexture(cacheFile.c_str(), 4321, true, stale) &&
+			!ReadCookedTexture(cacheFile.c_str(), 1234, false, stale);
+		remove(cacheFile.c_str());
+
+		printf("  Cache round trip (%s, %zu mips): %s\n", paths[i].filename().string().c_str(), cooked.mips.size(), roundTrip ? "ok" : "FAILED");
+		if (!roundTrip)
+			errors++;
+		break;
+	}
+
+	return errors == 0 ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// A roughness map and the metal map beside it with the same
+// name ("X_roughness.png" and "X_metal.png" or
+// "X_metallic.png", in any case), packed into one texture
+// --------------------------------------------------------
+struct RoughnessMetalPair
+{
+	fs::path roughness;
+	fs::path metal;
+};
+
+static std::vector<RoughnessMetalPair> ListRoughnessMetalPairs(const std::vector<fs::path>& paths)
+{
+	auto lower = [](std::string name)
+	{
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		return name;
+	};
+
+	const std::string suffix = "_roughness.png";
+	std::vector<RoughnessMetalPair> pairs;
+	for (const fs::path& path : paths)
+	{
+		std::string name = lower(path.filename().string());
+		if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+
+		std::string prefix = name.substr(0, name.size() - suffix.size());
+		for (const fs::path& metal : paths)
+		{
+			std::string metalName = lower(metal.filename().string());
+			if (metalName == prefix + "_metal.png" || metalName == prefix + "_metallic.png")
+			{
+				RoughnessMetalPair pair = { path, metal };
+				pairs.push_back(pair);
+				break;
+			}
+		}
+	}
+	return pairs;
+}
+
+// --------------------------------------------------------
+// Packs each roughness map in a folder with its metal map,
+// checks both channels against their sources and compares
+// the packed BC5 texture with the two maps as separate BC4
+// textures (which is what they'd otherwise be cooked to)
+// --------------------------------------------------------
+int BenchmarkRoughnessMetalPacking(const fs::path& folder)
+{
+	std::vector<fs::path> paths = ListPngFiles(folder);
+	std::vector<RoughnessMetalPair> pairs = ListRoughnessMetalPairs(paths);
+	if (pairs.empty())
+	{
+		printf("No roughness maps with metal maps in %s\n", folder.string().c_str());
+		return 1;
+	}
+	printf("%s: %zu packed textures\n", folder.string().c_str(), pairs.size());
+
+	const double minimumPsnr = 30.0;
+	const BlockFormat packedFormat = GetCookedBlockFormat(TextureUsage_RoughnessMetal);
+	double packedPsnrTotal = 0;
+	double worstPackedPsnr = INFINITY;
+	uint64_t packedBytes = 0;
+	double separatePsnrTotal = 0;
+	size_t separateMaps = 0;
+	uint64_t separateBytes = 0;
+	double packMilliseconds = 0;
+
+	size_t errors = 0;
+	size_t packed = 0;
+	size_t compared = 0;
+	size_t resampled = 0;
+	for (const RoughnessMetalPair& pair : pairs)
+	{
+		std::string roughnessName = pair.roughness.filename().string();
+		const fs::path* maps[] = { &pair.roughness, &pair.metal };
+
+		auto start = std::chrono::high_resolution_clock::now();
+		CookedTexture texture;
+		TextureSource<fs::path::value_type> source = { pair.roughness.c_str(), pair.metal.c_str() };
+		bool cooked = CookTexture(source, texture, false);
+		packMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		if (!cooked || texture.format != TextureFormat_RGBA8)
+		{
+			printf("  Could not pack %s\n", roughnessName.c_str());
+			errors++;
+			continue;
+		}
+		packed++;
+
+		uint32_t width = texture.mips[0].width;
+		uint32_t height = texture.mips[0].height;
+		size_t pixelCount = (size_t)width * height;
+		bool wholeBlocks = width % 4 == 0 && height % 4 == 0;
+
+		// Red and green must hold exactly their maps, blue 0 and alpha 1
+		std::vector<uint8_t> expected(texture.pixels.size(), 255);
+		for (size_t i = 0; i < pixelCount; i++)
+			expected[i * 4 + 2] = 0;
+
+		bool separateCompared = wholeBlocks;
+		uint64_t pairSeparateBytes = 0;
+		for (int c = 0; c < 2; c++)
+		{
+			CookedTexture map;
+			if (!CookTextureFile(maps[c]->c_str(), map, false))
+			{
+				printf("  Could not decode %s\n", maps[c]->filename().string().c_str());
+				errors++;
+				separateCompared = false;
+				continue;
+			}
+
+			if (map.mips[0].width != width || map.mips[0].height != height)
+			{
+				// Resampled, so just make sure there's something there
+				resampled++;
+				separateCompared = false;
+				for (size_t i = 0; i < pixelCount; i++)
+					expected[i * 4 + c] = texture.pixels[i * 4 + c];
+				continue;
+			}
+
+			for (size_t i = 0; i < pixelCount; i++)
+				expected[i * 4 + c] = map.pixels[i * map.channels];
+
+			// What the same map costs, and how it looks, as its own BC4 texture
+			if (wholeBlocks)
+			{
+				std::vector<uint8_t> blocks(GetCompressedSize(BlockFormat_BC4, width, height));
+				std::vector<uint8_t> single(pixelCount * 4, 255);
+				std::vector<uint8_t> decoded(pixelCount * 4);
+				CompressBlocks(map.pixels.data(), width, height, map.channels, BlockFormat_BC4, blocks.data());
+				DecompressBlocks(blocks.data(), width, height, BlockFormat_BC4, decoded.data());
+				for (size_t i = 0; i < pixelCount; i++)
+					single[i * 4] = map.pixels[i * map.channels];
+
+				separatePsnrTotal += std::min(MeasurePsnr(single, decoded, 1), 99.0);
+				separateMaps++;
+				separateBytes += blocks.size();
+				pairSeparateBytes += blocks.size();
+			}
+		}
+
+		if (texture.pixels != expected)
+		{
+			printf("  %s: channels don't match their maps\n", roughnessName.c_str());
+			errors++;
+		}
+
+		if (!wholeBlocks)
+			continue;
+
+		std::vector<uint8_t> blocks(GetCompressedSize(packedFormat, width, height));
+		std::vector<uint8_t> decoded(texture.pixels.size());
+		CompressBlocks(texture.pixels.data(), width, height, 4, packedFormat, blocks.data());
+		double psnr = DecompressBlocks(blocks.data(), width, height, packedFormat, decoded.data()) ?
+			MeasurePsnr(texture.pixels, decoded, 2) : 0;
+
+		packedPsnrTotal += std::min(psnr, 99.0);
+		worstPackedPsnr = std::min(worstPackedPsnr, psnr);
+		packedBytes += blocks.size();
+		compared++;
+
+		if (psnr < minimumPsnr)
+		{
+			printf("  %s: BC5 PSNR %.2f dB is below %.0f dB\n", roughnessName.c_str(), psnr, minimumPsnr);
+			errors++;
+		}
+
+		// Packing saves a texture and a sample, not memory: both
+		// maps as BC4 take exactly as much as one BC5
+		if (separateCompared && pairSeparateBytes != blocks.size())
+		{
+			printf("  %s: packed BC5 takes %zu bytes, separate BC4 maps %llu\n", roughnessName.c_str(), blocks.size(), (unsigned long long)pairSeparateBytes);
+			errors++;
+		}
+	}
+
+	printf("  Packed %zu (%zu maps resampled) in %.1f ms\n", packed, resampled, packMilliseconds);
+	if (separateMaps > 0)
+		printf("  Separate BC4  %6.2f MB  %zu textures  PSNR average %5.2f dB\n",
+			separateBytes / (1024.0 * 1024.0), separateMaps, separatePsnrTotal / separateMaps);
+	if (compared > 0)
+		printf("  Packed BC5    %6.2f MB  %zu textures  PSNR average %5.2f dB, worst %5.2f dB\n",
+			packedBytes / (1024.0 * 1024.0), compared, packedPsnrTotal / compared, worstPackedPsnr);
+
+	return errors == 0 ? 0 : 1;
+}
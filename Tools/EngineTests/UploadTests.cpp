@@ -0,0 +1,376 @@
+#include "EngineTests.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MeshProcessing.h"
+#include "UploadBatch.h"
+#include "UploadStreamer.h"
+
+
+// --------------------------------------------------------
+// Stands in for a GPU: copies are only carried out once the
+// frame they were recorded in completes, reading whatever is
+// in the staging memory at that point.  So if the streamer
+// ever reused staging space too early, the data would arrive
+// corrupted.  Destinations are byte vectors.
+// --------------------------------------------------------
+class SimulatedUploadBackend : public UploadBackend
+{
+public:
+	explicit SimulatedUploadBackend(size_t stagingSize) : staging(stagingSize) {}
+
+	uint8_t* GetStagingMemory() override { return staging.data(); }
+
+	void RecordCopy(void* destination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) override
+	{
+		Copy copy = { (std::vector<uint8_t>*)destination, destinationOffset, stagingOffset, size };
+		recorded.push_back(copy);
+	}
+
+	void RecordFinished(void* destination) override { finished.push_back((std::vector<uint8_t>*)destination); }
+
+	// Hands the recorded copies to the "GPU" as one frame
+	void Submit(uint64_t fenceValue)
+	{
+		Frame frame = { fenceValue, recorded };
+		frames.push_back(frame);
+		recorded.clear();
+	}
+
+	// Carries out every frame up to the given fence value
+	void Complete(uint64_t fenceValue)
+	{
+		while (!frames.empty() && frames.front().fenceValue <= fenceValue)
+		{
+			for (const Copy& copy : frames.front().copies)
+			{
+				if (copy.destinationOffset + copy.size > copy.destination->size())
+					outOfBounds++;
+				else
+					memcpy(copy.destination->data() + copy.destinationOffset, staging.data() + copy.stagingOffset, (size_t)copy.size);
+			}
+			frames.erase(frames.begin());
+		}
+	}
+
+	std::vector<std::vector<uint8_t>*> finished;
+	size_t outOfBounds = 0;
+
+private:
+	struct Copy
+	{
+		std::vector<uint8_t>* destination;
+		uint64_t destinationOffset;
+		uint64_t stagingOffset;
+		uint64_t size;
+	};
+
+	struct Frame
+	{
+		uint64_t fenceValue;
+		std::vector<Copy> copies;
+	};
+
+	std::vector<uint8_t> staging;
+	std::vector<Copy> recorded;
+	std::vector<Frame> frames;
+};
+
+// --------------------------------------------------------
+// Queues every model's vertex and index buffers at once and
+// streams them with a small ring and budget, so big buffers
+// are split across frames and the ring wraps many times.
+// --------------------------------------------------------
+int SimulateStreaming(const std::vector<TestModel>& models)
+{
+	const uint64_t ringSize = 1024 * 1024;
+	const uint64_t budgetPerFrame = 256 * 1024;
+	const uint64_t gpuLatencyInFrames = 2;
+
+	struct Upload
+	{
+		std::string name;
+		std::shared_ptr<std::vector<uint8_t>> source;
+		std::vector<uint8_t> destination;
+		UploadTicket ticket;
+		uint64_t completedFrame;
+	};
+	std::vector<Upload> uploads;
+	uploads.reserve(models.size() * 2);
+
+	for (const TestModel& model : models)
+	{
+		std::vector<Vertex> verts = model.verts;
+		std::vector<unsigned int> indices = model.indices;
+		OptimizeMesh(verts, indices);
+
+		const uint8_t* vertexBytes = (const uint8_t*)verts.data();
+		const uint8_t* indexBytes = (const uint8_t*)indices.data();
+		Upload vb = { model.name + " vertices", std::make_shared<std::vector<uint8_t>>(vertexBytes, vertexBytes + verts.size() * sizeof(Vertex)), std::vector<uint8_t>(), 0, 0 };
+		Upload ib = { model.name + " indices", std::make_shared<std::vector<uint8_t>>(indexBytes, indexBytes + indices.size() * sizeof(unsigned int)), std::vector<uint8_t>(), 0, 0 };
+		uploads.push_back(vb);
+		uploads.push_back(ib);
+	}
+
+	SimulatedUploadBackend backend((size_t)ringSize);
+	UploadStreamer streamer(backend, ringSize, budgetPerFrame);
+
+	uint64_t totalBytes = 0;
+	for (Upload& upload : uploads)
+	{
+		upload.destination.assign(upload.source->size(), 0);
+		upload.ticket = streamer.Queue(&upload.destination, 0, upload.source->data(), upload.source->size(), upload.source);
+		upload.completedFrame = 0;
+		totalBytes += upload.source->size();
+	}
+
+	// Frame f signals fence value f, and the GPU finishes it a few frames later
+	uint64_t frame = 0;
+	uint64_t peakRingUsed = 0;
+	uint64_t peakBytesPerFrame = 0;
+	size_t corrupted = 0;
+	while (!streamer.IsIdle() && frame < 100000)
+	{
+		frame++;
+		uint64_t completed = frame > gpuLatencyInFrames ? frame - gpuLatencyInFrames : 0;
+		backend.Complete(completed);
+
+		streamer.RecordUploads(completed, frame);
+		backend.Submit(frame);
+
+		peakRingUsed = std::max(peakRingUsed, streamer.GetStats().ringUsed);
+		peakBytesPerFrame = std::max(peakBytesPerFrame, streamer.GetStats().bytesThisFrame);
+
+		// A buffer reported complete must already hold all of its data
+		for (Upload& upload : uploads)
+		{
+			if (upload.completedFrame == 0 && streamer.IsComplete(upload.ticket))
+			{
+				upload.completedFrame = frame;
+				if (upload.destination != *upload.source)
+					corrupted++;
+			}
+		}
+	}
+
+	for (const Upload& upload : uploads)
+	{
+		printf("  %-28s %10zu bytes  ready at frame %llu\n",
+			upload.name.c_str(),
+			upload.source->size(),
+			(unsigned long long)upload.completedFrame);
+	}
+
+	bool finishedOnce = backend.finished.size() == uploads.size();
+	printf("%llu bytes in %llu frames (%llu KB ring, %llu KB budget, GPU %llu frames behind)\n",
+		(unsigned long long)totalBytes,
+		(unsigned long long)frame,
+		(unsigned long long)(ringSize / 1024),
+		(unsigned long long)(budgetPerFrame / 1024),
+		(unsigned long long)gpuLatencyInFrames);
+	printf("Peak ring use %llu bytes, peak frame %llu bytes, %zu corrupted, %zu out of bounds, %zu finish records\n",
+		(unsigned long long)peakRingUsed,
+		(unsigned long long)peakBytesPerFrame,
+		corrupted,
+		backend.outOfBounds,
+		backend.finished.size());
+
+	return (streamer.IsIdle() && corrupted == 0 && backend.outOfBounds == 0 && finishedOnce && peakBytesPerFrame <= budgetPerFrame) ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// Stands in for a GPU for upload batches.  Arenas are heap
+// memory, and submitted copies are only carried out when
+// the fake GPU catches up, so copying out of an arena that
+// was already released gets caught.
+// --------------------------------------------------------
+class SimulatedBatchBackend : public UploadBatchBackend
+{
+public:
+	void* CreateArena(uint64_t size, uint8_t*& memory) override
+	{
+		std::vector<uint8_t>* arena = new std::vector<uint8_t>((size_t)size);
+		memory = arena->data();
+		liveArenas++;
+		return arena;
+	}
+
+	void ReleaseArena(void* arena) override
+	{
+		// Anything still waiting to copy from this arena was released too early
+		for (const Copy& copy : recorded)
+			if (copy.arena == arena) earlyReleases++;
+		for (const Copy& copy : submitted)
+			if (copy.arena == arena) earlyReleases++;
+
+		delete (std::vector<uint8_t>*)arena;
+		liveArenas--;
+	}
+
+	void RecordCopy(void* destination, uint64_t destinationOffset, void* arena, uint64_t arenaOffset, uint64_t size) override
+	{
+		Copy copy = { (std::vector<uint8_t>*)destination, destinationOffset, (std::vector<uint8_t>*)arena, arenaOffset, size };
+		recorded.push_back(copy);
+	}
+
+	void RecordFinished(void*) override { finished++; }
+
+	uint64_t Submit() override
+	{
+		submitted.insert(submitted.end(), recorded.begin(), recorded.end());
+		recorded.clear();
+		submissions++;
+		return ++lastSubmitted;
+	}
+
+	uint64_t GetCompletedFenceValue() override { return completed; }
+
+	// The fake GPU finishes everything submitted so far
+	void CatchUp()
+	{
+		for (const Copy& copy : submitted)
+			memcpy(copy.destination->data() + copy.destinationOffset, copy.arena->data() + copy.arenaOffset, (size_t)copy.size);
+		submitted.clear();
+		completed = lastSubmitted;
+	}
+
+	size_t liveArenas = 0;
+	size_t earlyReleases = 0;
+	size_t finished = 0;
+	size_t submissions = 0;
+
+private:
+	struct Copy
+	{
+		std::vector<uint8_t>* destination;
+		uint64_t destinationOffset;
+		std::vector<uint8_t>* arena;
+		uint64_t arenaOffset;
+		uint64_t size;
+	};
+
+	std::vector<Copy> recorded;
+	std::vector<Copy> submitted;
+	uint64_t lastSubmitted = 0;
+	uint64_t completed = 0;
+};
+
+// --------------------------------------------------------
+// Stages every model's vertex and index buffers in one
+// batch (each model in a nested batch of its own, the way
+// Mesh does it) with small arenas, so some buffers share an
+// arena and big ones get their own.  That happens three
+// times: a second batch while the GPU is still busy with the
+// first must create new arenas, and a third after it catches
+// up must reuse pooled ones, creating only the oversized.
+// --------------------------------------------------------
+int SimulateBatch(const std::vector<TestModel>& models)
+{
+	const uint64_t arenaSize = 1024 * 1024;
+	const size_t maxPooledArenas = 8;
+	const int rounds = 3;
+
+	std::vector<std::vector<uint8_t>> data;
+	std::vector<std::vector<uint8_t>> destinations;
+	for (const TestModel& model : models)
+	{
+		std::vector<Vertex> verts = model.verts;
+		std::vector<unsigned int> indices = model.indices;
+		OptimizeMesh(verts, indices);
+
+		const uint8_t* vertexBytes = (const uint8_t*)verts.data();
+		const uint8_t* indexBytes = (const uint8_t*)indices.data();
+		data.emplace_back(vertexBytes, vertexBytes + verts.size() * sizeof(Vertex));
+		data.emplace_back(indexBytes, indexBytes + indices.size() * sizeof(unsigned int));
+	}
+
+	size_t oversized = 0;
+	for (const std::vector<uint8_t>& buffer : data)
+		if (buffer.size() > arenaSize) oversized++;
+
+	// The backend holds on to destination pointers, so they can't move
+	destinations.reserve(data.size() * rounds);
+
+	SimulatedBatchBackend backend;
+	size_t arenasBeforeCatchUp = 0;
+	size_t pooledAfterCatchUp = 0;
+	UploadBatchStats stats[rounds] = {};
+	{
+		UploadBatch batch(backend, arenaSize, maxPooledArenas);
+
+		for (int round = 0; round < rounds; round++)
+		{
+			// The GPU catches up before the last round
+			if (round == rounds - 1)
+			{
+				arenasBeforeCatchUp = batch.GetLiveArenaCount();
+				backend.CatchUp();
+				batch.ReleaseCompleted();
+				pooledAfterCatchUp = batch.GetPooledArenaCount();
+			}
+
+			batch.Begin();
+			for (size_t i = 0; i < data.size(); i += 2)
+			{
+				batch.Begin();
+				for (size_t j = i; j < i + 2; j++)
+				{
+					destinations.emplace_back(data[j].size(), 0);
+					batch.Stage(&destinations.back(), 0, data[j].data(), data[j].size());
+				}
+				batch.End();
+			}
+			batch.End();
+			stats[round] = batch.GetStats();
+		}
+
+		backend.CatchUp();
+		batch.ReleaseCompleted();
+	}
+
+	size_t corrupted = 0;
+	for (size_t i = 0; i < destinations.size(); i++)
+		if (destinations[i] != data[i % data.size()])
+			corrupted++;
+
+	printf("%zu buffers, %llu bytes in %zu arenas of %llu KB (or bigger), %zu submissions\n",
+		stats[0].buffers,
+		(unsigned long long)stats[0].bytes,
+		stats[0].arenas,
+		(unsigned long long)(arenaSize / 1024),
+		backend.submissions);
+	printf("Arenas created per batch: %zu, %zu while the GPU was busy, %zu after it caught up (%zu pooled, %zu oversized)\n",
+		stats[0].createdArenas,
+		stats[1].createdArenas,
+		stats[2].createdArenas,
+		pooledAfterCatchUp,
+		oversized);
+	printf("%zu arenas live until the GPU caught up, %zu left after, %zu released early, %zu corrupted\n",
+		arenasBeforeCatchUp,
+		backend.liveArenas,
+		backend.earlyReleases,
+		corrupted);
+
+	// Every regular arena of the first two batches comes back, up to the pool's limit
+	size_t regularArenas = stats[2].arenas - oversized;
+	size_t expectedPooled = std::min((stats[0].arenas - oversized) * 2, maxPooledArenas);
+	size_t expectedCreated = oversized + (regularArenas > expectedPooled ? regularArenas - expectedPooled : 0);
+
+	bool ok =
+		backend.submissions == rounds &&
+		backend.finished == data.size() * rounds &&
+		stats[0].createdArenas == stats[0].arenas &&
+		stats[1].createdArenas == stats[1].arenas &&
+		arenasBeforeCatchUp == stats[0].arenas + stats[1].arenas &&
+		pooledAfterCatchUp == expectedPooled &&
+		stats[2].createdArenas == expectedCreated &&
+		backend.liveArenas == 0 &&
+		backend.earlyReleases == 0 &&
+		corrupted == 0;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,407 @@
+// --------------------------------------------------------
+// MeshCooker
+//
+// Offline tool that walks a models folder and converts every
+// OBJ into the engine's cooked mesh format (see MeshCache.h),
+// so the engine can map the final vertices and indices
+// straight into GPU buffers.  Uses the exact same parsing and
+// processing code as Mesh.cpp, and never touches the GPU.
+// It also cooks textures.  Tests and benchmarks for this code
+// are in Tools/EngineTests.
+//
+// Usage: MeshCooker [folder] [--threads N] [--force] [--compact-report]
+//        MeshCooker --cook-textures folder [--force]
+//
+//        MeshCooker [folder] [--threads N] [--force] [--compact-report]
+//   Cooks every OBJ under a folder
+//   folder     - Root folder to search (default: Assets/Models)
+//   --threads  - Files cooked at once (default: all cores)
+//   --force    - Re-cook even if the cooked file is up to date
+//   --compact-report - Also report the size and error of each
+//                      mesh in the CompactVertex layout
+//
+//        MeshCooker --cook-textures folder [--force]
+//   Compresses every PNG in a folder, and the packed textures
+//   its roughness and metal maps make, into the cooked texture
+//   cache the engine loads from, skipping any that are up to
+//   date unless forced
+// --------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CompactVertex.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshProcessing.h"
+#include "MeshSimplify.h"
+#include "ObjParser.h"
+#include "TextureCache.h"
+#include "TextureProcessing.h"
+
+namespace fs = std::filesystem;
+using namespace DirectX;
+
+enum CookResult
+{
+	CookResult_Cooked,
+	CookResult_UpToDate,
+	CookResult_Failed
+};
+
+// --------------------------------------------------------
+// Checks for a ".obj" extension, ignoring case
+// --------------------------------------------------------
+static bool IsObjFile(const fs::path& path)
+{
+	std::string extension = path.extension().string();
+	for (char& c : extension)
+		c = (char)tolower((unsigned char)c);
+
+	return extension == ".obj";
+}
+
+// --------------------------------------------------------
+// Describes how a mesh would fare in the CompactVertex layout
+// --------------------------------------------------------
+static std::string DescribeCompactVertices(const std::vector<Vertex>& verts)
+{
+	CompactVertexBounds bounds = CalculateCompactVertexBounds(&verts[0], verts.size());
+	std::vector<CompactVertex> compact(verts.size());
+	EncodeCompactVertices(&verts[0], verts.size(), bounds, &compact[0]);
+	CompactVertexError error = MeasureCompactVertexError(&verts[0], &compact[0], verts.size(), bounds);
+
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), "\n       compact: %.1f KB -> %.1f KB, position %g (%.4f%%), uv %g, normal %.3f deg, tangent %.3f deg, %zu sign flips",
+		verts.size() * sizeof(Vertex) / 1024.0,
+		compact.size() * sizeof(CompactVertex) / 1024.0,
+		error.maxPosition,
+		error.maxPositionRelative * 100.0f,
+		error.maxUV,
+		error.maxNormalDegrees,
+		error.maxTangentDegrees,
+		error.signMismatches);
+	return buffer;
+}
+
+// --------------------------------------------------------
+// Cooks a single OBJ file, unless its cooked version was
+// already made from the same source bytes
+//
+// source - The OBJ file to cook
+// force - Whether to ignore an up to date cooked file
+// compactReport - Whether to add CompactVertex stats to the summary
+// summary - Receives a line describing what happened
+// --------------------------------------------------------
+static CookResult CookMesh(const fs::path& source, bool force, bool compactReport, std::string& summary)
+{
+	MappedFile file;
+	if (!file.Open(source.c_str()))
+	{
+		summary = "could not open source";
+		return CookResult_Failed;
+	}
+
+	uint64_t sourceHash = HashBytes(file.GetData(), file.GetSize());
+	auto cookedFile = GetCookedMeshPath(source.native());
+
+	// Skip anything already cooked from this exact source with
+	// the same processing this tool applies
+	if (!force)
+	{
+		CookedMesh cooked;
+		if (cooked.Open(cookedFile.c_str(), sourceHash) &&
+			(cooked.GetHeader()->flags & CookedMeshFlag_VertexCacheOptimized))
+		{
+			summary = "up to date";
+			return CookResult_UpToDate;
+		}
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Files are already spread across threads, so each one is parsed serially
+	ObjData obj;
+	ParseObjMemory(file.GetData(), file.GetSize(), obj, 0, 1);
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	BuildObjVertices(obj, verts, indices);
+	if (verts.empty() || indices.empty())
+	{
+		summary = "no faces";
+		return CookResult_Failed;
+	}
+
+	VertexCacheStats before = AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+	OptimizeMesh(verts, indices);
+	VertexCacheStats after = AnalyzeVertexCache(&indices[0], indices.size(), verts.size());
+
+	CalculateTangents(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), TangentKernel_Auto, 1);
+
+	std::vector<unsigned int> lodIndices;
+	std::vector<MeshLod> lods;
+	BuildMeshLods(&verts[0], verts.size(), &indices[0], indices.size(), lodIndices, lods);
+
+	if (!WriteCookedMesh(cookedFile.c_str(), &verts[0], (unsigned int)verts.size(), &lodIndices[0], (unsigned int)lodIndices.size(), &lods[0], (unsigned int)lods.size(), sourceHash, CookedMeshFlag_VertexCacheOptimized))
+	{
+		summary = "could not write cooked mesh";
+		return CookResult_Failed;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), "%zu corners -> %zu vertices, %zu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%.2f ms)",
+		obj.corners.size(),
+		verts.size(),
+		indices.size() / 3,
+		before.acmr,
+		after.acmr,
+		before.atvr,
+		after.atvr,
+		ms);
+	summary = buffer;
+
+	if (obj.malformedLines > 0)
+	{
+		snprintf(buffer, sizeof(buffer), "\n       Skipped %zu malformed lines (later indices may be off)", obj.malformedLines);
+		summary += buffer;
+	}
+
+	summary += "\n       LODs:";
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		snprintf(buffer, sizeof(buffer), "%s %u (%g)", i > 0 ? "," : "", lods[i].indexCount / 3, lods[i].error);
+		summary += buffer;
+	}
+
+	if (compactReport)
+		summary += DescribeCompactVertices(verts);
+
+	return CookResult_Cooked;
+}
+
+// --------------------------------------------------------
+// Every PNG directly inside a folder, sorted by name
+// --------------------------------------------------------
+static std::vector<fs::path> ListPngFiles(const fs::path& folder)
+{
+	std::vector<fs::path> paths;
+	std::error_code error;
+	for (const fs::directory_entry& entry : fs::directory_iterator(folder, error))
+	{
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (entry.is_regular_file() && extension == ".png")
+			paths.push_back(entry.path());
+	}
+	if (paths.empty())
+		printf("No PNG files in %s\n", folder.string().c_str());
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+// --------------------------------------------------------
+// A roughness map and the metal map beside it with the same
+// name ("X_roughness.png" and "X_metal.png" or
+// "X_metallic.png", in any case), packed into one texture
+// --------------------------------------------------------
+struct RoughnessMetalPair
+{
+	fs::path roughness;
+	fs::path metal;
+};
+
+static std::vector<RoughnessMetalPair> ListRoughnessMetalPairs(const std::vector<fs::path>& paths)
+{
+	auto lower = [](std::string name)
+	{
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		return name;
+	};
+
+	const std::string suffix = "_roughness.png";
+	std::vector<RoughnessMetalPair> pairs;
+	for (const fs::path& path : paths)
+	{
+		std::string name = lower(path.filename().string());
+		if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+
+		std::string prefix = name.substr(0, name.size() - suffix.size());
+		for (const fs::path& metal : paths)
+		{
+			std::string metalName = lower(metal.filename().string());
+			if (metalName == prefix + "_metal.png" || metalName == prefix + "_metallic.png")
+			{
+				RoughnessMetalPair pair = { path, metal };
+				pairs.push_back(pair);
+				break;
+			}
+		}
+	}
+	return pairs;
+}
+
+// --------------------------------------------------------
+// Fills the texture cache for a folder the same way the
+// engine does when it loads them, including the packed
+// texture of each roughness map with a matching metal map.
+// Materials that pack other maps together get theirs
+// cached the first time the engine loads them.
+// --------------------------------------------------------
+static int CookTextures(const fs::path& folder, bool force)
+{
+	std::vector<fs::path> paths = ListPngFiles(folder);
+	if (paths.empty())
+		return 1;
+
+	std::vector<TextureSource<fs::path::value_type>> sources;
+	for (const fs::path& path : paths)
+	{
+		TextureSource<fs::path::value_type> source = { path.c_str(), 0 };
+		sources.push_back(source);
+	}
+
+	// The packed textures too, which only exist once they're cooked
+	std::vector<RoughnessMetalPair> pairs = ListRoughnessMetalPairs(paths);
+	for (const RoughnessMetalPair& pair : pairs)
+	{
+		TextureSource<fs::path::value_type> source = { pair.roughness.c_str(), pair.metal.c_str() };
+		sources.push_back(source);
+	}
+
+	std::vector<CookedTexture> textures;
+	TextureCookStats stats;
+	CookTextures(sources.data(), sources.size(), textures, true, force ? TextureCache_Rebuild : TextureCache_Use, &stats);
+
+	size_t uncompressed = 0;
+	for (const CookedTexture& texture : textures)
+		if (texture.IsValid() && !IsBlockCompressed(texture.format))
+			uncompressed++;
+
+	printf("%s: %zu textures, %zu up to date, %zu left uncompressed, %zu failed\n",
+		folder.string().c_str(), stats.textures, stats.cacheHits, uncompressed, stats.failed);
+	printf("  Compress %.1f ms (added up over threads), %.1f ms total on %u threads\n",
+		stats.compressMilliseconds, stats.totalMilliseconds, stats.threads);
+	return stats.failed == 0 ? 0 : 1;
+}
+
+// --------------------------------------------------------
+// Lists every mode this tool has
+// --------------------------------------------------------
+static void PrintUsage(const char* program)
+{
+	printf("Usage: %s [folder] [--threads N] [--force] [--compact-report]\n", program);
+	printf("       %s --cook-textures folder [--force]\n", program);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc >= 2 && strcmp(argv[1], "--cook-textures") == 0)
+	{
+		bool force = false;
+		fs::path folder;
+		for (int i = 2; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--force") == 0) force = true;
+			else folder = argv[i];
+		}
+
+		if (folder.empty())
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+		return CookTextures(folder, force);
+	}
+
+	fs::path root = "Assets/Models";
+	unsigned int threadCount = std::thread::hardware_concurrency();
+	bool force = false;
+	bool compactReport = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--force") == 0)
+			force = true;
+		else if (strcmp(argv[i], "--compact-report") == 0)
+			compactReport = true;
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threadCount = (unsigned int)atoi(argv[++i]);
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+		else
+			root = argv[i];
+	}
+
+	std::error_code error;
+	if (!fs::is_directory(root, error))
+	{
+		printf("Folder not found: %s\n", root.string().c_str());
+		return 1;
+	}
+
+	// Gather every OBJ first so the work can be split evenly
+	std::vector<fs::path> sources;
+	for (fs::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error))
+	{
+		if (it->is_regular_file(error) && IsObjFile(it->path()))
+			sources.push_back(it->path());
+	}
+
+	if (threadCount == 0) threadCount = 1;
+	if (threadCount > sources.size()) threadCount = (unsigned int)sources.size();
+
+	printf("Cooking %zu meshes from %s on %u threads\n", sources.size(), root.string().c_str(), threadCount);
+
+	// Each thread grabs the next file until none are left
+	std::atomic<size_t> nextSource(0);
+	std::atomic<unsigned int> counts[3] = {};
+	std::mutex printLock;
+	auto worker = [&]()
+	{
+		for (size_t i = nextSource++; i < sources.size(); i = nextSource++)
+		{
+			std::string summary;
+			CookResult result = CookMesh(sources[i], force, compactReport, summary);
+			counts[result]++;
+
+			std::lock_guard<std::mutex> lock(printLock);
+			printf("%s %s: %s\n",
+				result == CookResult_Failed ? "[FAIL]" : "[ OK ]",
+				sources[i].string().c_str(),
+				summary.c_str());
+		}
+	};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> threads;
+	for (unsigned int t = 1; t < threadCount; t++)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& t : threads)
+		t.join();
+
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("Done in %.2f s: %u cooked, %u up to date, %u failed\n",
+		seconds,
+		counts[CookResult_Cooked].load(),
+		counts[CookResult_UpToDate].load(),
+		counts[CookResult_Failed].load());
+
+	return counts[CookResult_Failed] > 0 ? 1 : 0;
+}